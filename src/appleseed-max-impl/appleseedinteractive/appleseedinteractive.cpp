@@ -35,8 +35,19 @@
 #include "appleseedrenderer/appleseedrenderer.h"
 #include "utilities.h"
 
-// appleseed-max-common headers.
-#include "appleseed-max-common/iappleseedmtl.h"
+// appleseed.renderer headers.
+#include "renderer/api/bsdf.h"
+#include "renderer/api/bssrdf.h"
+#include "renderer/api/color.h"
+#include "renderer/api/edf.h"
+#include "renderer/api/light.h"
+#include "renderer/api/material.h"
+#include "renderer/api/object.h"
+#include "renderer/api/project.h"
+#include "renderer/api/scene.h"
+#include "renderer/api/surfaceshader.h"
+#include "renderer/api/texture.h"
+#include "renderer/api/volume.h"
 
 // Boost headers.
 #include "boost/thread/locks.hpp"
@@ -49,7 +60,11 @@
 #include "appleseed-max-common/_endmaxheaders.h"
 
 // Standard headers.
+#include <algorithm>
 #include <clocale>
+#include <set>
+#include <string>
+#include <utility>
 
 namespace asf = foundation;
 namespace asr = renderer;
@@ -59,137 +74,119 @@ namespace
     boost::mutex                g_current_interactive_mutex;
     AppleseedInteractiveRender* g_current_interactive;
 
-    void get_view_params_from_viewport(
-        ViewParams&             view_params,
-        ViewExp&                view_exp,
-        const TimeValue         time)
+    // Timer used to leave navigation mode once the camera or objects stop moving.
+    const UINT_PTR NavigationTimerId = 4765;
+    const UINT NavigationIdleDelay = 300;   // in milliseconds
+
+    VOID CALLBACK navigation_timer_proc(
+        _In_ HWND     hwnd,
+        _In_ UINT     msg,
+        _In_ UINT_PTR id,
+        _In_ DWORD    time)
     {
-        if (view_exp.IsAlive())
+        KillTimer(hwnd, id);
         {
-            Matrix3 v_mat;
-            ViewExp13* vp13 = reinterpret_cast<ViewExp13*>(view_exp.Execute(ViewExp::kEXECUTE_GET_VIEWEXP_13));
-            vp13->GetAffineTM(v_mat);
-            view_params.affineTM = v_mat;
-            view_params.prevAffineTM = view_params.affineTM;
-            view_params.projType = vp13->IsPerspView() ? PROJ_PERSPECTIVE : PROJ_PARALLEL;
-            view_params.zoom = vp13->GetZoom();
-            view_params.fov = vp13->GetFOV();
-            view_params.distance = vp13->GetFocalDist();
-            view_params.hither = vp13->GetHither();
-            view_params.yon = vp13->GetYon();
+            boost::mutex::scoped_lock lock(g_current_interactive_mutex);
+            if (g_current_interactive != nullptr)
+                g_current_interactive->end_navigation();
         }
     }
 
-    void get_view_params_from_view_node(
-        ViewParams&             view_params,
-        INode*                  view_node,
-        const TimeValue         time)
+    // Timer used to restart rendering once changes stop coming.
+    const UINT_PTR RestartTimerId = 4766;
+
+    VOID CALLBACK restart_timer_proc(
+        _In_ HWND     hwnd,
+        _In_ UINT     msg,
+        _In_ UINT_PTR id,
+        _In_ DWORD    time)
     {
-        const ObjectState& os = view_node->EvalWorldState(time);
-        switch (os.obj->SuperClassID())
+        KillTimer(hwnd, id);
         {
-          case CAMERA_CLASS_ID:
-            {
-                CameraObject* cam = static_cast<CameraObject*>(os.obj);
-
-                Interval validity_interval;
-                validity_interval.SetInfinite();
-
-                Matrix3 cam_to_world = view_node->GetObjTMAfterWSM(time, &validity_interval);
-                cam_to_world.NoScale();
-
-                view_params.affineTM = Inverse(cam_to_world);
-
-                CameraState cam_state;
-                cam->EvalCameraState(time, validity_interval, &cam_state);
-
-                view_params.projType = PROJ_PERSPECTIVE;
-                view_params.fov = cam_state.fov;
+            boost::mutex::scoped_lock lock(g_current_interactive_mutex);
+            if (g_current_interactive != nullptr)
+                g_current_interactive->restart();
+        }
+    }
 
-                if (cam_state.manualClip)
-                {
-                    view_params.hither = cam_state.hither;
-                    view_params.yon = cam_state.yon;
-                }
-                else
-                {
-                    view_params.hither = 0.001f;
-                    view_params.yon = 1.0e38f;
-                }
-            }
-            break;
+    // Timer used to add objects to the scene while rendering.
+    const UINT_PTR PopulateTimerId = 4767;
+    const UINT PopulateInterval = 50;       // in milliseconds
 
-          case LIGHT_CLASS_ID:
-            DbgAssert(!"Not implemented yet.");
-            break;
+    // Number of objects added by the first batch; each batch then doubles in size so that
+    // the assembly is only rebuilt a logarithmic number of times.
+    const size_t InitialPopulationBatchSize = 8;
 
-          default:
-            DbgAssert(!"Unexpected super class ID for camera.");
-        }
+    VOID CALLBACK populate_timer_proc(
+        _In_ HWND     hwnd,
+        _In_ UINT     msg,
+        _In_ UINT_PTR id,
+        _In_ DWORD    time)
+    {
+        boost::mutex::scoped_lock lock(g_current_interactive_mutex);
+        if (g_current_interactive != nullptr)
+            g_current_interactive->populate_scene();
     }
 
-    class RenderBeginProc
-      : public RefEnumProc
+    template <typename EntityContainer>
+    void collect_entity_names(
+        const EntityContainer&      entities,
+        std::set<std::string>&      names)
     {
-      public:
-        explicit RenderBeginProc(const TimeValue time)
-          : m_time(time)
-        {
-        }
-
-        int proc(ReferenceMaker* rm) override
-        {
-            rm->RenderBegin(m_time);
-            return REF_ENUM_CONTINUE;
-        }
-
-      private:
-        const TimeValue m_time;
-    };
+        for (const auto& entity : entities)
+            names.insert(entity.get_name());
+    }
 
-    class RenderEndProc
-      : public RefEnumProc
+    // Estimate how large an object appears in a view.
+    float get_screen_size(
+        INode*                  node,
+        const ViewParams&       view_params,
+        const TimeValue         time)
     {
-      public:
-        explicit RenderEndProc(const TimeValue time)
-          : m_time(time)
-        {
-        }
+        const ObjectState object_state = node->EvalWorldState(time);
+        if (object_state.obj == nullptr)
+            return 0.0f;
 
-        int proc(ReferenceMaker* rm) override
-        {
-            rm->RenderEnd(m_time);
-            return REF_ENUM_CONTINUE;
-        }
+        Matrix3 tm = node->GetObjTMAfterWSM(time);
+        Box3 bbox;
+        object_state.obj->GetDeformBBox(time, bbox, &tm);
+        if (bbox.IsEmpty())
+            return 0.0f;
 
-      private:
-        const TimeValue m_time;
-    };
+        const float size = Length(bbox.Width());
 
-    void render_begin(
-        std::vector<INode*>&    nodes,
-        const TimeValue         time)
-    {
-        RenderBeginProc proc(time);
-        proc.BeginEnumeration();
+        if (view_params.projType == PROJ_PARALLEL)
+            return size;
 
-        for (auto node : nodes)
-            node->EnumRefHierarchy(proc);
+        // Angular size, from the distance between the camera and the center of the bounding box.
+        const Point3 center = bbox.Center() * view_params.affineTM;
+        return size / std::max(Length(center), 1.0e-3f);
+    }
 
-        proc.EndEnumeration();
+    Texmap* get_environment_map()
+    {
+        return GetCOREInterface()->GetUseEnvironmentMap() ? GetCOREInterface()->GetEnvironmentMap() : nullptr;
     }
 
-    void render_end(
-        std::vector<INode*>&    nodes,
+    void get_view_params_from_viewport(
+        ViewParams&             view_params,
+        ViewExp&                view_exp,
         const TimeValue         time)
     {
-        RenderEndProc proc(time);
-        proc.BeginEnumeration();
-
-        for (auto node : nodes)
-            node->EnumRefHierarchy(proc);
-
-        proc.EndEnumeration();
+        if (view_exp.IsAlive())
+        {
+            Matrix3 v_mat;
+            ViewExp13* vp13 = reinterpret_cast<ViewExp13*>(view_exp.Execute(ViewExp::kEXECUTE_GET_VIEWEXP_13));
+            vp13->GetAffineTM(v_mat);
+            view_params.affineTM = v_mat;
+            view_params.prevAffineTM = view_params.affineTM;
+            view_params.projType = vp13->IsPerspView() ? PROJ_PERSPECTIVE : PROJ_PARALLEL;
+            view_params.zoom = vp13->GetZoom();
+            view_params.fov = vp13->GetFOV();
+            view_params.distance = vp13->GetFocalDist();
+            view_params.hither = vp13->GetHither();
+            view_params.yon = vp13->GetYon();
+        }
     }
 
     class SceneChangeCallback
@@ -214,6 +211,7 @@ namespace
                 return;
 
             std::vector<INode*> updated_nodes;
+            std::vector<INode*> updated_lights;
             for (int i = 0, e = nodes.Count(); i < e; ++i)
             {
                 INode* node = NodeEventNamespace::GetNodeByKey(nodes[i]);
@@ -233,12 +231,16 @@ namespace
 
                 if (os.obj && os.obj->SuperClassID() == LIGHT_CLASS_ID)
                 {
-                    // TODO: update lights here
+                    updated_lights.push_back(node);
                 }
             }
 
-            m_renderer->update_object_instance(updated_nodes);
-            m_renderer->get_render_session()->reininitialize_render();
+            // Only geometry changes require rebuilding the assembly's acceleration structures.
+            if (!updated_nodes.empty())
+                m_renderer->update_object_instance(updated_nodes);
+            if (!updated_lights.empty())
+                m_renderer->update_lights(updated_lights);
+            m_renderer->schedule_restart();
         }
         
         void MaterialStructured(NodeKeyTab& nodes)
@@ -254,7 +256,7 @@ namespace
             }
 
             m_renderer->update_object_instance(updated_nodes);
-            m_renderer->get_render_session()->reininitialize_render();
+            m_renderer->schedule_restart();
         }
 
         void MaterialOtherEvent(NodeKeyTab& nodes) override
@@ -270,12 +272,15 @@ namespace
             }
 
             m_renderer->update_material(updated_nodes);
-            m_renderer->get_render_session()->reininitialize_render();
+            m_renderer->schedule_restart();
         }
 
         void ControllerOtherEvent(NodeKeyTab& nodes) override 
         {
+            m_renderer->begin_navigation();
+
             std::vector<INode*> transformed_nodes;
+            std::vector<INode*> transformed_lights;
             for (int i = 0, e = nodes.Count(); i < e; ++i)
             {
                 INode* node = NodeEventNamespace::GetNodeByKey(nodes[i]);
@@ -284,14 +289,23 @@ namespace
                 {
                     transformed_nodes.push_back(node);
                 }
+
+                if (os.obj && os.obj->SuperClassID() == LIGHT_CLASS_ID)
+                {
+                    transformed_lights.push_back(node);
+                }
             }
-            m_renderer->update_object_instance(transformed_nodes);
-            m_renderer->get_render_session()->reininitialize_render();
+            if (!transformed_nodes.empty())
+                m_renderer->update_object_instance(transformed_nodes);
+            if (!transformed_lights.empty())
+                m_renderer->update_lights(transformed_lights);
+            m_renderer->schedule_restart();
         }
 
         void Added(NodeKeyTab& nodes) override 
         {
             std::vector<INode*> added_nodes;
+            std::vector<INode*> added_lights;
             for (int i = 0, e = nodes.Count(); i < e; ++i)
             {
                 INode* node = NodeEventNamespace::GetNodeByKey(nodes[i]);
@@ -300,9 +314,17 @@ namespace
                 {
                     added_nodes.push_back(node);
                 }
+
+                if (os.obj && os.obj->SuperClassID() == LIGHT_CLASS_ID)
+                {
+                    added_lights.push_back(node);
+                }
             }
-            m_renderer->add_object_instance(added_nodes);
-            m_renderer->get_render_session()->reininitialize_render();
+            if (!added_nodes.empty())
+                m_renderer->add_object_instance(added_nodes);
+            if (!added_lights.empty())
+                m_renderer->update_lights(added_lights);
+            m_renderer->schedule_restart();
         }
 
         void Deleted(NodeKeyTab& nodes) override 
@@ -313,7 +335,8 @@ namespace
                 removed_nodes.push_back(NodeEventNamespace::GetNodeByKey(nodes[i]));
             }
             m_renderer->remove_object_instance(removed_nodes);
-            m_renderer->get_render_session()->reininitialize_render();
+            m_renderer->remove_lights(removed_nodes);
+            m_renderer->schedule_restart();
         }
 
       private:
@@ -329,8 +352,6 @@ namespace
         ViewportCallback()
           : m_current_view(nullptr)
           , m_last_fov(0.0f)
-          , m_last_timer(0)
-          , m_max_hwnd(GetCOREInterface()->GetMAXHWnd())
         {
             m_last_mat.IdentityMatrix();
 
@@ -342,26 +363,16 @@ namespace
             GetCOREInterface()->UnRegisterRedrawViewsCallback(this);
         }
 
-        static VOID CALLBACK timer_proc(
-            _In_ HWND     hwnd,
-            _In_ UINT     msg,
-            _In_ UINT_PTR id,
-            _In_ DWORD    time
-        )
+        void proc(Interface* ip) override
         {
-            KillTimer(hwnd, id);
+            // There is no notification for changes made in the Environment dialog, but
+            // viewports are redrawn after them.
             {
                 boost::mutex::scoped_lock lock(g_current_interactive_mutex);
                 if (g_current_interactive != nullptr)
-                {
-                    g_current_interactive->update_render_view();
-                    g_current_interactive->get_render_session()->reininitialize_render();
-                }
+                    g_current_interactive->check_environment();
             }
-        }
 
-        void proc(Interface* ip) override
-        {
             ViewExp& view_exp = ip->GetActiveViewExp();
             if (m_current_view == nullptr)
                 m_current_view = &view_exp;
@@ -379,10 +390,14 @@ namespace
                 {
                     m_last_mat = curr_mat;
                     m_last_fov = curr_fov;
-                    if (m_last_timer == 0)
-                        m_last_timer = SetTimer(m_max_hwnd, 0, 100, timer_proc);
-                    else
-                        SetTimer(m_max_hwnd, m_last_timer, 100, timer_proc);
+
+                    boost::mutex::scoped_lock lock(g_current_interactive_mutex);
+                    if (g_current_interactive != nullptr)
+                    {
+                        g_current_interactive->begin_navigation();
+                        g_current_interactive->update_render_view();
+                        g_current_interactive->schedule_restart();
+                    }
                 }
             }
         }
@@ -391,12 +406,69 @@ namespace
         ViewExp*    m_current_view;
         float       m_last_fov;
         Matrix3     m_last_mat;
-        UINT_PTR    m_last_timer;
-        HWND        m_max_hwnd;
     };
 }
 
 
+//
+// EnvironmentMapWatcher class implementation.
+//
+
+// Follow changes to the parameters of the environment map and of its sub-maps.
+class EnvironmentMapWatcher
+  : public ReferenceMaker
+{
+  public:
+    explicit EnvironmentMapWatcher(AppleseedInteractiveRender* renderer)
+      : m_renderer(renderer)
+      , m_env_map(nullptr)
+    {
+    }
+
+    ~EnvironmentMapWatcher() override
+    {
+        DeleteAllRefs();
+    }
+
+    void watch(Texmap* env_map)
+    {
+        ReplaceReference(0, env_map);
+    }
+
+    int NumRefs() override
+    {
+        return 1;
+    }
+
+    RefTargetHandle GetReference(int i) override
+    {
+        return m_env_map;
+    }
+
+    void SetReference(int i, RefTargetHandle rtarg) override
+    {
+        m_env_map = static_cast<Texmap*>(rtarg);
+    }
+
+    RefResult NotifyRefChanged(
+        const Interval&     changeInt,
+        RefTargetHandle     hTarget,
+        PartID&             partID,
+        RefMessage          message,
+        BOOL                propagate) override
+    {
+        if (message == REFMSG_CHANGE)
+            m_renderer->update_environment();
+
+        return REF_SUCCEED;
+    }
+
+  private:
+    AppleseedInteractiveRender* m_renderer;
+    Texmap*                     m_env_map;
+};
+
+
 //
 // AppleseedInteractiveRender class implementation.
 //
@@ -407,6 +479,15 @@ AppleseedInteractiveRender::AppleseedInteractiveRender()
   , m_irender_manager(nullptr)
   , m_scene_inode(nullptr)
   , m_use_view_inode(false)
+  , m_navigating(false)
+  , m_restart_pending(false)
+  , m_first_restart_request_time(0)
+  , m_env_map(nullptr)
+  , m_environment_changed(false)
+  , m_renderer_settings(RendererSettings::defaults())
+  , m_settings_changed(false)
+  , m_population_batch_size(InitialPopulationBatchSize)
+  , m_population_restart_count(0)
   , m_view_inode(nullptr)
   , m_view_exp(nullptr)
   , m_progress_cb(nullptr)
@@ -431,7 +512,7 @@ asf::auto_release_ptr<asr::Project> AppleseedInteractiveRender::prepare_project(
     RendParams rend_params;
     rend_params.inMtlEdit = false;
     rend_params.rendType = RENDTYPE_NORMAL;
-    rend_params.envMap = GetCOREInterface()->GetUseEnvironmentMap() ? GetCOREInterface()->GetEnvironmentMap() : nullptr;
+    rend_params.envMap = get_environment_map();
 
     FrameRendParams frame_rend_params;
     frame_rend_params.background = Color(GetCOREInterface()->GetBackGround(time, FOREVER));
@@ -450,13 +531,17 @@ asf::auto_release_ptr<asr::Project> AppleseedInteractiveRender::prepare_project(
     // Call RenderBegin() on all object instances.
     render_begin(m_entities.m_objects, time);
 
-    // Build the project.
+    // Build the project with the camera, the lights and the environment only. Objects are
+    // added while rendering.
     if (m_progress_cb)
         m_progress_cb->SetTitle(L"Building Project...");
 
+    MaxSceneEntities initial_entities;
+    initial_entities.m_lights = m_entities.m_lights;
+
     asf::auto_release_ptr<asr::Project> project(
         build_project(
-            m_entities,
+            initial_entities,
             m_default_lights,
             camera_node,
             view_params,
@@ -470,7 +555,8 @@ asf::auto_release_ptr<asr::Project> AppleseedInteractiveRender::prepare_project(
             get_render_session()->m_object_inst_map,
             get_render_session()->m_material_map,
             get_render_session()->m_assembly_map,
-            get_render_session()->m_assembly_inst_map));
+            get_render_session()->m_assembly_inst_map,
+            get_render_session()->m_light_map));
 
     std::setlocale(LC_ALL, previous_locale.c_str());
 
@@ -479,8 +565,181 @@ asf::auto_release_ptr<asr::Project> AppleseedInteractiveRender::prepare_project(
     return project;
 }
 
+void AppleseedInteractiveRender::queue_objects(
+    const ViewParams&           view_params,
+    const TimeValue             time)
+{
+    std::vector<std::pair<float, INode*>> objects;
+    objects.reserve(m_entities.m_objects.size());
+
+    for (INode* node : m_entities.m_objects)
+        objects.emplace_back(get_screen_size(node, view_params, time), node);
+
+    // Most visible objects last, since batches are taken from the back.
+    std::stable_sort(
+        objects.begin(),
+        objects.end(),
+        [](const std::pair<float, INode*>& lhs, const std::pair<float, INode*>& rhs)
+        {
+            return lhs.first < rhs.first;
+        });
+
+    m_pending_objects.clear();
+    for (const auto& object : objects)
+        m_pending_objects.push_back(object.second);
+
+    m_population_batch_size = InitialPopulationBatchSize;
+    m_population_restart_count = 0;
+}
+
+void AppleseedInteractiveRender::populate_scene()
+{
+    if (m_render_session == nullptr)
+        return;
+
+    if (m_pending_objects.empty() && m_pending_lights.empty())
+    {
+        KillTimer(GetCOREInterface()->GetMAXHWnd(), PopulateTimerId);
+        return;
+    }
+
+    // The scene and the entity maps of the session are only stable while the render thread
+    // has no updates to apply; otherwise try again on the next tick.
+    boost::unique_lock<boost::mutex> lock(m_render_session->get_scene_update_mutex(), boost::try_to_lock);
+    if (!lock.owns_lock() || m_render_session->has_scheduled_updates())
+        return;
+
+    // Changed lights are applied without waiting for the next batch of objects, which is
+    // staged on a later tick, once the lights have been moved into the scene.
+    if (!m_pending_lights.empty())
+    {
+        stage_lights(m_pending_lights);
+        m_pending_lights.clear();
+        schedule_restart();
+        return;
+    }
+
+    // Wait until the objects added so far have been rendered once.
+    const size_t restart_count = m_render_session->get_rendered_restart_count();
+    if (restart_count == m_population_restart_count)
+        return;
+
+    m_population_restart_count = restart_count;
+
+    const size_t count = std::min(m_population_batch_size, m_pending_objects.size());
+    const std::vector<INode*> batch(m_pending_objects.end() - count, m_pending_objects.end());
+    m_pending_objects.resize(m_pending_objects.size() - count);
+    m_population_batch_size *= 2;
+
+    stage_objects(batch);
+    schedule_restart();
+}
+
+void AppleseedInteractiveRender::stage_objects(const std::vector<INode*>& nodes)
+{
+    asr::Project& project = *m_render_session->m_project;
+    const asr::Assembly& assembly = *project.get_scene()->assemblies().get_by_name("assembly");
+
+    // Names given to the converted entities must not clash with the ones of the scene.
+    std::set<std::string> reserved_names;
+    collect_entity_names(assembly.colors(), reserved_names);
+    collect_entity_names(assembly.textures(), reserved_names);
+    collect_entity_names(assembly.texture_instances(), reserved_names);
+    collect_entity_names(assembly.shader_groups(), reserved_names);
+    collect_entity_names(assembly.bsdfs(), reserved_names);
+    collect_entity_names(assembly.bssrdfs(), reserved_names);
+    collect_entity_names(assembly.edfs(), reserved_names);
+    collect_entity_names(assembly.surface_shaders(), reserved_names);
+    collect_entity_names(assembly.volumes(), reserved_names);
+    collect_entity_names(assembly.materials(), reserved_names);
+    collect_entity_names(assembly.lights(), reserved_names);
+    collect_entity_names(assembly.objects(), reserved_names);
+    collect_entity_names(assembly.object_instances(), reserved_names);
+    collect_entity_names(assembly.assemblies(), reserved_names);
+    collect_entity_names(assembly.assembly_instances(), reserved_names);
+    ScopedNameReservation name_reservation(reserved_names);
+
+    // Objects and materials already in the scene are referred to rather than converted again.
+    ObjectMap object_map = m_render_session->m_object_map;
+    ObjectInstanceMap object_inst_map;
+    MaterialMap material_map = m_render_session->m_material_map;
+    AssemblyMap assembly_map = m_render_session->m_assembly_map;
+    AssemblyInstanceMap assembly_inst_map;
+
+    asf::auto_release_ptr<asr::Assembly> staging_assembly(
+        asr::AssemblyFactory().create("staging"));
+
+    for (INode* node : nodes)
+    {
+        add_object(
+            project,
+            staging_assembly.ref(),
+            node,
+            RenderType::Default,
+            m_render_session->m_renderer_settings,
+            GetCOREInterface()->GetTime(),
+            object_map,
+            object_inst_map,
+            material_map,
+            assembly_map,
+            assembly_inst_map);
+    }
+
+    m_render_session->schedule_add_staged_objects(
+        staging_assembly,
+        object_map,
+        object_inst_map,
+        material_map,
+        assembly_map,
+        assembly_inst_map);
+}
+
+void AppleseedInteractiveRender::stage_lights(const std::vector<INode*>& nodes)
+{
+    const asr::Assembly& assembly =
+        *m_render_session->m_project->get_scene()->assemblies().get_by_name("assembly");
+
+    // Lights about to be replaced still hold their names when the staged lights are named.
+    std::set<std::string> reserved_names;
+    collect_entity_names(assembly.colors(), reserved_names);
+    collect_entity_names(assembly.lights(), reserved_names);
+    ScopedNameReservation name_reservation(reserved_names);
+
+    RendParams rend_params;
+    rend_params.inMtlEdit = false;
+    rend_params.rendType = RENDTYPE_NORMAL;
+    rend_params.envMap = get_environment_map();     // needed to recognize the sun light
+
+    const TimeValue time = GetCOREInterface()->GetTime();
+
+    asf::auto_release_ptr<asr::Assembly> staging_assembly(
+        asr::AssemblyFactory().create("staging"));
+    LightMap light_map;
+
+    for (INode* node : nodes)
+    {
+        const ObjectState object_state = node->EvalWorldState(time);
+        if (object_state.obj == nullptr || object_state.obj->SuperClassID() != LIGHT_CLASS_ID)
+            continue;
+
+        // Disabled lights are only removed.
+        if (static_cast<LightObject*>(object_state.obj)->GetUseLight())
+            add_light(staging_assembly.ref(), rend_params, node, time, light_map);
+    }
+
+    m_render_session->schedule_light_update(staging_assembly, nodes, light_map);
+}
+
 void AppleseedInteractiveRender::remove_object_instance(const std::vector<INode*>& nodes)
 {
+    // Objects deleted before they were added to the scene must not be added anymore.
+    for (INode* node : nodes)
+    {
+        m_pending_objects.erase(
+            std::remove(m_pending_objects.begin(), m_pending_objects.end(), node),
+            m_pending_objects.end());
+    }
+
     get_render_session()->schedule_remove_object_instance(nodes);
 }
 
@@ -494,6 +753,35 @@ void AppleseedInteractiveRender::update_object_instance(const std::vector<INode*
     get_render_session()->schedule_udpate_object_instance(nodes);
 }
 
+void AppleseedInteractiveRender::update_lights(const std::vector<INode*>& nodes)
+{
+    // Lights are converted on this thread, once the render thread has applied earlier changes.
+    for (INode* node : nodes)
+    {
+        if (std::find(m_pending_lights.begin(), m_pending_lights.end(), node) == m_pending_lights.end())
+            m_pending_lights.push_back(node);
+    }
+
+    SetTimer(GetCOREInterface()->GetMAXHWnd(), PopulateTimerId, PopulateInterval, populate_timer_proc);
+}
+
+void AppleseedInteractiveRender::remove_lights(const std::vector<INode*>& nodes)
+{
+    // Lights deleted before they were converted must not be converted anymore.
+    for (INode* node : nodes)
+    {
+        m_pending_lights.erase(
+            std::remove(m_pending_lights.begin(), m_pending_lights.end(), node),
+            m_pending_lights.end());
+    }
+
+    // Lights are removed by looking them up in the light map, nothing needs to be converted.
+    get_render_session()->schedule_light_update(
+        asf::auto_release_ptr<asr::Assembly>(asr::AssemblyFactory().create("staging")),
+        nodes,
+        LightMap());
+}
+
 void AppleseedInteractiveRender::update_material(const std::vector<INode*>& nodes)
 {
     std::vector<Mtl*> materials;
@@ -518,20 +806,8 @@ void AppleseedInteractiveRender::update_material(const std::vector<INode*>& node
         }
     }
 
-    IAppleseedMtlMap updated_materials;
-    for (const auto& mtl : materials)
-    {
-        IAppleseedMtl* appleseed_mtl =
-            static_cast<IAppleseedMtl*>(mtl->GetInterface(IAppleseedMtl::interface_id()));
-        if (appleseed_mtl == nullptr)
-            continue;
-
-        if (get_render_session()->m_material_map.count(mtl) > 0)
-            continue;
-        updated_materials[appleseed_mtl] = get_render_session()->m_material_map[mtl];
-    }
-
-    get_render_session()->schedule_material_update(updated_materials);
+    // The material map of the session belongs to the render thread, materials are looked up there.
+    get_render_session()->schedule_material_update(materials);
 }
 
 void AppleseedInteractiveRender::update_camera_object(INode* camera)
@@ -571,6 +847,136 @@ InteractiveSession* AppleseedInteractiveRender::get_render_session()
     return m_render_session.get();
 }
 
+bool AppleseedInteractiveRender::begin_navigation()
+{
+    if (m_render_session == nullptr || !m_render_session->m_renderer_settings.m_enable_navigation_mode)
+        return false;
+
+    if (!m_navigating)
+    {
+        m_navigating = true;
+        m_render_session->schedule_navigation_mode(true);
+    }
+
+    // Restart the idle delay.
+    SetTimer(GetCOREInterface()->GetMAXHWnd(), NavigationTimerId, NavigationIdleDelay, navigation_timer_proc);
+
+    return true;
+}
+
+void AppleseedInteractiveRender::end_navigation()
+{
+    if (!m_navigating)
+        return;
+
+    m_navigating = false;
+
+    if (m_render_session != nullptr)
+    {
+        m_render_session->schedule_navigation_mode(false);
+        schedule_restart();
+    }
+}
+
+void AppleseedInteractiveRender::schedule_restart()
+{
+    if (m_render_session == nullptr)
+        return;
+
+    const DWORD now = GetTickCount();
+    if (!m_restart_pending)
+    {
+        m_restart_pending = true;
+        m_first_restart_request_time = now;
+    }
+
+    // Wait for further changes about as long as a restart takes, but don't hold changes
+    // back for more than twice that while they keep coming.
+    const DWORD delay = static_cast<DWORD>(m_render_session->get_restart_delay() * 1000.0);
+    if (delay == 0 || now - m_first_restart_request_time >= 2 * delay)
+        restart();
+    else
+        SetTimer(GetCOREInterface()->GetMAXHWnd(), RestartTimerId, delay, restart_timer_proc);
+}
+
+void AppleseedInteractiveRender::restart()
+{
+    KillTimer(GetCOREInterface()->GetMAXHWnd(), RestartTimerId);
+    m_restart_pending = false;
+
+    if (m_render_session == nullptr)
+        return;
+
+    // Scheduled actions run in order: the environment is built with the new settings.
+    if (m_settings_changed)
+    {
+        m_settings_changed = false;
+        m_render_session->schedule_renderer_settings_update(m_renderer_settings);
+        m_environment_changed = true;   // background alpha and environment lighting settings
+    }
+
+    if (m_environment_changed)
+    {
+        m_environment_changed = false;
+
+        // Bake the environment map here rather than on the render thread: the environment
+        // map belongs to the UI thread, and the scene is only touched to swap the result in.
+        RendParams rend_params;
+        rend_params.inMtlEdit = false;
+        rend_params.rendType = RENDTYPE_NORMAL;
+        rend_params.envMap = m_env_map;
+
+        FrameRendParams frame_rend_params;
+        frame_rend_params.background = m_background;
+
+        m_render_session->schedule_environment_update(
+            build_environment(
+                rend_params,
+                frame_rend_params,
+                m_renderer_settings,
+                GetCOREInterface()->GetTime()));
+    }
+
+    m_render_session->reininitialize_render();
+}
+
+void AppleseedInteractiveRender::check_environment()
+{
+    if (m_render_session == nullptr)
+        return;
+
+    Texmap* env_map = get_environment_map();
+    const Color background = GetCOREInterface()->GetBackGround(m_time, FOREVER);
+
+    if (env_map != m_env_map || background != m_background)
+    {
+        m_env_map = env_map;
+        m_background = background;
+        m_envmap_watcher->watch(env_map);
+        update_environment();
+    }
+}
+
+void AppleseedInteractiveRender::update_environment()
+{
+    if (m_render_session == nullptr)
+        return;
+
+    m_environment_changed = true;
+    schedule_restart();
+}
+
+void AppleseedInteractiveRender::update_renderer_settings(const RendererSettings& settings)
+{
+    if (m_render_session == nullptr)
+        return;
+
+    m_renderer_settings = settings;
+    m_renderer_settings.m_output_mode = RendererSettings::OutputMode::RenderOnly;
+    m_settings_changed = true;
+    schedule_restart();
+}
+
 void AppleseedInteractiveRender::BeginSession()
 {
     DbgAssert(m_render_session == nullptr);
@@ -592,13 +998,22 @@ void AppleseedInteractiveRender::BeginSession()
     
     RendererSettings renderer_settings = appleseed_renderer->get_renderer_settings();
     renderer_settings.m_output_mode = RendererSettings::OutputMode::RenderOnly;
+    m_renderer_settings = renderer_settings;
     
     m_render_session.reset(new InteractiveSession(
         m_irender_manager,
         renderer_settings,
-        m_bitmap));
+        m_bitmap,
+        get_render_element_bitmaps()));
 
     m_project = prepare_project(renderer_settings, view_params, active_cam, m_time);
+    queue_objects(view_params, m_time);
+
+    // Remember the environment the project was built with and follow its changes.
+    m_env_map = get_environment_map();
+    m_background = GetCOREInterface()->GetBackGround(m_time, FOREVER);
+    m_envmap_watcher.reset(new EnvironmentMapWatcher(this));
+    m_envmap_watcher->watch(m_env_map);
 
     if (m_progress_cb)
         m_progress_cb->SetTitle(L"Rendering...");
@@ -612,6 +1027,8 @@ void AppleseedInteractiveRender::BeginSession()
     m_view_callback.reset(new ViewportCallback());
 
     m_render_session->start_render();
+
+    SetTimer(GetCOREInterface()->GetMAXHWnd(), PopulateTimerId, PopulateInterval, populate_timer_proc);
 }
 
 void AppleseedInteractiveRender::EndSession()
@@ -620,6 +1037,16 @@ void AppleseedInteractiveRender::EndSession()
     {
         m_node_callback.reset(nullptr);
         m_view_callback.reset(nullptr);
+        m_envmap_watcher.reset(nullptr);
+        KillTimer(GetCOREInterface()->GetMAXHWnd(), NavigationTimerId);
+        KillTimer(GetCOREInterface()->GetMAXHWnd(), RestartTimerId);
+        KillTimer(GetCOREInterface()->GetMAXHWnd(), PopulateTimerId);
+        m_pending_objects.clear();
+        m_pending_lights.clear();
+        m_navigating = false;
+        m_restart_pending = false;
+        m_environment_changed = false;
+        m_settings_changed = false;
         m_render_session->abort_render();
         
         {
@@ -51,6 +51,7 @@
 
 // Forward declarations.
 namespace renderer { class Project; }
+class EnvironmentMapWatcher;
 class InteractiveSession;
 class RendererSettings;
 class ViewParams;
@@ -100,13 +101,36 @@ class AppleseedInteractiveRender
     void remove_object_instance(const std::vector<INode*>&);
     void update_object_instance(const std::vector<INode*>&);
     void update_material(const std::vector<INode*>& nodes);
+    void update_lights(const std::vector<INode*>& nodes);
+    void remove_lights(const std::vector<INode*>& nodes);
     void update_render_view();
     InteractiveSession* get_render_session();
 
+    // Render at navigation quality until the scene has been left alone for a moment.
+    // Return false if navigation mode is disabled.
+    bool begin_navigation();
+
+    // Go back to full quality and restart rendering.
+    void end_navigation();
+
+    // Restart rendering with the changes scheduled so far, either now or once changes stop
+    // coming, depending on how long restarts take.
+    void schedule_restart();
+    void restart();
+
+    // Add the next batch of objects to the scene once the previous one has been rendered.
+    void populate_scene();
+
+    // Apply changes to the environment or to render settings at the next restart.
+    void check_environment();
+    void update_environment();
+    void update_renderer_settings(const RendererSettings& settings);
+
   private:
     std::unique_ptr<InteractiveSession>             m_render_session;
     std::unique_ptr<INodeEventCallback>             m_node_callback;
     std::unique_ptr<RedrawViewsCallback>            m_view_callback;
+    std::unique_ptr<EnvironmentMapWatcher>          m_envmap_watcher;
     foundation::auto_release_ptr<renderer::Project> m_project;
     Bitmap*                                         m_bitmap;
     std::vector<DefaultLight>                       m_default_lights;
@@ -120,10 +144,33 @@ class AppleseedInteractiveRender
     ViewExp*                                        m_view_exp;
     INode*                                          m_view_inode;
     bool                                            m_use_view_inode;
+    bool                                            m_navigating;
+    bool                                            m_restart_pending;
+    DWORD                                           m_first_restart_request_time;
+    Texmap*                                         m_env_map;              // null if the environment map is not used
+    Color                                           m_background;
+    bool                                            m_environment_changed;
+    RendererSettings                                m_renderer_settings;    // settings of the session once scheduled updates are applied
+    bool                                            m_settings_changed;
+    std::vector<INode*>                             m_pending_objects;      // objects not added to the scene yet, most visible last
+    std::vector<INode*>                             m_pending_lights;       // lights changed since they were last converted
+    size_t                                          m_population_batch_size;
+    size_t                                          m_population_restart_count;
 
     foundation::auto_release_ptr<renderer::Project> prepare_project(
         const RendererSettings&     renderer_settings,
         const ViewParams&           view_params,
         INode*                      camera_node,
         const TimeValue             time);
+
+    void queue_objects(
+        const ViewParams&           view_params,
+        const TimeValue             time);
+
+    // Convert objects into a staging assembly on this thread and schedule moving them into
+    // the scene. The caller must hold the scene update mutex of the session.
+    void stage_objects(const std::vector<INode*>& nodes);
+
+    // Same as stage_objects() for lights. The lights of the nodes are replaced in the scene.
+    void stage_lights(const std::vector<INode*>& nodes);
 };
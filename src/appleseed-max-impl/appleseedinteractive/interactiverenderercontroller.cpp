@@ -38,9 +38,40 @@
 #include <interactiverender.h>
 #include "appleseed-max-common/_endmaxheaders.h"
 
+// appleseed.renderer headers.
+#include "renderer/api/bsdf.h"
+#include "renderer/api/bssrdf.h"
+#include "renderer/api/color.h"
+#include "renderer/api/edf.h"
+#include "renderer/api/environment.h"
+#include "renderer/api/environmentedf.h"
+#include "renderer/api/environmentshader.h"
+#include "renderer/api/frame.h"
+#include "renderer/api/light.h"
+#include "renderer/api/log.h"
+#include "renderer/api/material.h"
+#include "renderer/api/object.h"
+#include "renderer/api/shadergroup.h"
+#include "renderer/api/surfaceshader.h"
+#include "renderer/api/texture.h"
+#include "renderer/api/volume.h"
+
+// appleseed.foundation headers.
+#include "foundation/utility/containers/dictionary.h"
+#include "foundation/utility/string.h"
+#include "foundation/utility/uid.h"
+
+// Boost headers.
+#include "boost/thread/locks.hpp"
+
 // Standard headers.
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <set>
 #include <utility>
 
+namespace asf = foundation;
 namespace asr = renderer;
 
 void CameraObjectUpdateAction::update()
@@ -49,25 +80,366 @@ void CameraObjectUpdateAction::update()
     m_project.get_scene()->cameras().insert(m_camera);
 }
 
+namespace
+{
+    asr::ShaderGroup* get_surface_shader_group(
+        asr::Assembly&          assembly,
+        const asr::Material&    material)
+    {
+        const asr::ParamArray& params = material.get_parameters();
+        return
+            params.strings().exist("osl_surface")
+                ? assembly.shader_groups().get_by_name(params.get("osl_surface"))
+                : nullptr;
+    }
+
+    bool have_same_topology(
+        const asr::ShaderGroup& lhs,
+        const asr::ShaderGroup& rhs)
+    {
+        if (lhs.shaders().size() != rhs.shaders().size() ||
+            lhs.shader_connections().size() != rhs.shader_connections().size())
+            return false;
+
+        for (size_t i = 0, e = lhs.shaders().size(); i < e; ++i)
+        {
+            const asr::Shader* a = lhs.shaders().get_by_index(i);
+            const asr::Shader* b = rhs.shaders().get_by_index(i);
+
+            if (strcmp(a->get_type(), b->get_type()) != 0 ||
+                strcmp(a->get_shader(), b->get_shader()) != 0 ||
+                strcmp(a->get_layer(), b->get_layer()) != 0)
+                return false;
+        }
+
+        for (size_t i = 0, e = lhs.shader_connections().size(); i < e; ++i)
+        {
+            const asr::ShaderConnection* a = lhs.shader_connections().get_by_index(i);
+            const asr::ShaderConnection* b = rhs.shader_connections().get_by_index(i);
+
+            if (strcmp(a->get_src_layer(), b->get_src_layer()) != 0 ||
+                strcmp(a->get_src_param(), b->get_src_param()) != 0 ||
+                strcmp(a->get_dst_layer(), b->get_dst_layer()) != 0 ||
+                strcmp(a->get_dst_param(), b->get_dst_param()) != 0)
+                return false;
+        }
+
+        return true;
+    }
+
+    void collect_entity_references(
+        const asr::Assembly&        assembly,
+        const asf::Dictionary&      params,
+        std::set<asf::UniqueID>&    uids);
+
+    template <typename EntityContainer>
+    void collect_entity_reference(
+        const asr::Assembly&        assembly,
+        const EntityContainer&      entities,
+        const char*                 name,
+        std::set<asf::UniqueID>&    uids)
+    {
+        const auto* entity = entities.get_by_name(name);
+        if (entity != nullptr && uids.insert(entity->get_uid()).second)
+            collect_entity_references(assembly, entity->get_parameters(), uids);
+    }
+
+    // Collect the entities of an assembly that a parameter value refers to by name.
+    void collect_entity_reference(
+        const asr::Assembly&        assembly,
+        const char*                 name,
+        std::set<asf::UniqueID>&    uids)
+    {
+        collect_entity_reference(assembly, assembly.colors(), name, uids);
+        collect_entity_reference(assembly, assembly.textures(), name, uids);
+        collect_entity_reference(assembly, assembly.shader_groups(), name, uids);
+        collect_entity_reference(assembly, assembly.bsdfs(), name, uids);
+        collect_entity_reference(assembly, assembly.bssrdfs(), name, uids);
+        collect_entity_reference(assembly, assembly.edfs(), name, uids);
+        collect_entity_reference(assembly, assembly.surface_shaders(), name, uids);
+        collect_entity_reference(assembly, assembly.volumes(), name, uids);
+
+        // Texture instances refer to their texture outside of their parameters.
+        const asr::TextureInstance* texture_instance = assembly.texture_instances().get_by_name(name);
+        if (texture_instance != nullptr && uids.insert(texture_instance->get_uid()).second)
+        {
+            collect_entity_references(assembly, texture_instance->get_parameters(), uids);
+            collect_entity_reference(assembly, assembly.textures(), texture_instance->get_texture_name(), uids);
+        }
+    }
+
+    // Collect the entities of an assembly that a set of parameters refers to, recursively.
+    void collect_entity_references(
+        const asr::Assembly&        assembly,
+        const asf::Dictionary&      params,
+        std::set<asf::UniqueID>&    uids)
+    {
+        for (auto it = params.strings().begin(), e = params.strings().end(); it != e; ++it)
+            collect_entity_reference(assembly, it.value(), uids);
+
+        for (auto it = params.dictionaries().begin(), e = params.dictionaries().end(); it != e; ++it)
+            collect_entity_references(assembly, it.value(), uids);
+    }
+
+    template <typename EntityContainer>
+    void collect_entity_references(
+        const asr::Assembly&        assembly,
+        const EntityContainer&      entities,
+        std::set<asf::UniqueID>&    uids)
+    {
+        for (const auto& entity : entities)
+            collect_entity_references(assembly, entity.get_parameters(), uids);
+    }
+
+    template <typename EntityContainer>
+    void remove_entities(
+        EntityContainer&                entities,
+        const std::set<asf::UniqueID>&  uids)
+    {
+        for (const asf::UniqueID uid : uids)
+        {
+            if (auto* entity = entities.get_by_uid(uid))
+                entities.remove(entity);
+        }
+    }
+
+    // Remove a material from an assembly along with the entities that only it refers to:
+    // its shader group, BSDFs, colors, textures, etc. These would otherwise pile up every
+    // time the material is rebuilt, and shader groups would be compiled on every restart.
+    void remove_material(
+        asr::Assembly&          assembly,
+        asr::Material&          material)
+    {
+        std::set<asf::UniqueID> material_uids;
+        collect_entity_references(assembly, material.get_parameters(), material_uids);
+
+        assembly.materials().remove(&material);
+
+        // Keep the entities still referred to by the rest of the assembly.
+        std::set<asf::UniqueID> used_uids;
+        collect_entity_references(assembly, assembly.materials(), used_uids);
+        collect_entity_references(assembly, assembly.lights(), used_uids);
+        collect_entity_references(assembly, assembly.objects(), used_uids);
+        collect_entity_references(assembly, assembly.object_instances(), used_uids);
+
+        std::set<asf::UniqueID> unused_uids;
+        std::set_difference(
+            material_uids.begin(), material_uids.end(),
+            used_uids.begin(), used_uids.end(),
+            std::inserter(unused_uids, unused_uids.begin()));
+
+        remove_entities(assembly.colors(), unused_uids);
+        remove_entities(assembly.textures(), unused_uids);
+        remove_entities(assembly.texture_instances(), unused_uids);
+        remove_entities(assembly.shader_groups(), unused_uids);
+        remove_entities(assembly.bsdfs(), unused_uids);
+        remove_entities(assembly.bssrdfs(), unused_uids);
+        remove_entities(assembly.edfs(), unused_uids);
+        remove_entities(assembly.surface_shaders(), unused_uids);
+        remove_entities(assembly.volumes(), unused_uids);
+    }
+
+    // Try to update a material from a new version of it built in a scratch assembly by only
+    // changing the parameter values of its existing shader group. Return false if the shader
+    // network or anything else than shader parameters changed. This keeps the entities of the
+    // material in place; it doesn't save any OSL work, see below.
+    bool patch_material(
+        asr::Assembly&          assembly,
+        asr::Material&          material,
+        asr::Assembly&          scratch_assembly,
+        const asr::Material&    new_material)
+    {
+        // The new material must only consist of a shader group.
+        if (scratch_assembly.shader_groups().size() != 1 ||
+            !scratch_assembly.materials().empty() ||
+            !scratch_assembly.colors().empty() ||
+            !scratch_assembly.textures().empty() ||
+            !scratch_assembly.texture_instances().empty())
+            return false;
+
+        if (strcmp(material.get_model(), new_material.get_model()) != 0)
+            return false;
+
+        asr::ShaderGroup* shader_group = get_surface_shader_group(assembly, material);
+        const asr::ShaderGroup* new_shader_group = get_surface_shader_group(scratch_assembly, new_material);
+        if (shader_group == nullptr || new_shader_group == nullptr)
+            return false;
+
+        // Apart from the name of the shader group, material parameters must not change.
+        asr::ParamArray params = material.get_parameters();
+        asr::ParamArray new_params = new_material.get_parameters();
+        params.strings().remove("osl_surface");
+        new_params.strings().remove("osl_surface");
+        if (params != new_params)
+            return false;
+
+        if (!have_same_topology(*shader_group, *new_shader_group))
+            return false;
+
+        // Find the shaders whose parameters changed.
+        size_t changed_shader_count = 0;
+        for (size_t i = 0, e = shader_group->shaders().size(); i < e; ++i)
+        {
+            if (shader_group->shaders().get_by_index(i)->get_parameters() !=
+                new_shader_group->shaders().get_by_index(i)->get_parameters())
+                ++changed_shader_count;
+        }
+
+        if (changed_shader_count > 0)
+        {
+            // Copy the new parameter values into the existing shader group. The material and
+            // the shader group entities are kept, along with everything that refers to them.
+            // Shaders parse their parameters when they are created and appleseed cannot change
+            // the values of an OSL shader group in place, so the shaders are recreated and OSL
+            // builds the group again at the next restart, as it would for a new material.
+            shader_group->clear();
+
+            for (const asr::Shader& shader : new_shader_group->shaders())
+            {
+                shader_group->add_shader(
+                    shader.get_type(),
+                    shader.get_shader(),
+                    shader.get_layer(),
+                    shader.get_parameters());
+            }
+
+            for (const asr::ShaderConnection& connection : new_shader_group->shader_connections())
+            {
+                shader_group->add_connection(
+                    connection.get_src_layer(),
+                    connection.get_src_param(),
+                    connection.get_dst_layer(),
+                    connection.get_dst_param());
+            }
+
+            RENDERER_LOG_DEBUG(
+                "patched parameters of %s shader%s of material \"%s\".",
+                asf::pretty_uint(changed_shader_count).c_str(),
+                changed_shader_count > 1 ? "s" : "",
+                material.get_name());
+        }
+
+        return true;
+    }
+}
+
 void MaterialUpdateAction::update()
 {
-    renderer::Assembly* assembly = m_project.get_scene()->assemblies().get_by_name("assembly");
+    renderer::Assembly* assembly = m_session->m_project->get_scene()->assemblies().get_by_name("assembly");
     DbgAssert(assembly);
 
-    for (const auto& mtl : m_material_map)
+    const TimeValue time = GetCOREInterface()->GetTime();
+
+    // Only rebuild materials that are part of the scene.
+    IAppleseedMtlMap material_map;
+    for (Mtl* mtl : m_materials)
+    {
+        const auto it = m_session->m_material_map.find(mtl);
+        if (it == m_session->m_material_map.end())
+            continue;
+
+        IAppleseedMtl* appleseed_mtl =
+            static_cast<IAppleseedMtl*>(mtl->GetInterface(IAppleseedMtl::interface_id()));
+        if (appleseed_mtl != nullptr)
+            material_map[appleseed_mtl] = it->second;
+    }
+
+    for (const auto& mtl : material_map)
     {
         renderer::Material* material = assembly->materials().get_by_name(mtl.second.c_str());
 
         if (material)
-            assembly->materials().remove(material);
+        {
+            // Build the new version of the material on the side and only patch parameter
+            // values when the shader network is unchanged, e.g. while dragging a slider,
+            // rather than replacing the material and all the entities it refers to.
+            asf::auto_release_ptr<asr::Assembly> scratch_assembly(
+                asr::AssemblyFactory().create("scratch"));
+            asf::auto_release_ptr<asr::Material> new_material(
+                mtl.first->create_material(
+                    scratch_assembly.ref(),
+                    mtl.second.c_str(),
+                    false,
+                    time));
+
+            if (patch_material(*assembly, *material, scratch_assembly.ref(), new_material.ref()))
+                continue;
+
+            remove_material(*assembly, *material);
+        }
 
         assembly->materials().insert(
             mtl.first->create_material(
                 *assembly,
                 mtl.second.c_str(),
                 false,
-                GetCOREInterface()->GetTime()));
+                time));
+    }
+}
+
+namespace
+{
+    template <typename EntityContainer>
+    void move_entities(
+        EntityContainer&        src,
+        EntityContainer&        dst,
+        const bool              shared = false)
+    {
+        while (!src.empty())
+        {
+            // Remove from the back, the remaining entities don't need to be reindexed.
+            auto entity = src.remove(src.get_by_index(src.size() - 1));
+
+            // Shared entities, such as textures, are named after what they hold and only
+            // need to be inserted once.
+            if (!shared || dst.get_by_name(entity->get_name()) == nullptr)
+                dst.insert(entity);
+        }
     }
+
+    void move_assemblies(
+        asr::AssemblyContainer& src,
+        asr::AssemblyContainer& dst)
+    {
+        while (!src.empty())
+            dst.insert(src.remove(&*src.begin()));
+    }
+}
+
+void AddStagedObjectsAction::update()
+{
+    renderer::Assembly* assembly = m_session->m_project->get_scene()->assemblies().get_by_name("assembly");
+    DbgAssert(assembly);
+
+    asr::Assembly& staging_assembly = m_staging_assembly.ref();
+
+    move_entities(staging_assembly.colors(), assembly->colors());
+    move_entities(staging_assembly.textures(), assembly->textures(), true);
+    move_entities(staging_assembly.texture_instances(), assembly->texture_instances(), true);
+    move_entities(staging_assembly.shader_groups(), assembly->shader_groups());
+    move_entities(staging_assembly.bsdfs(), assembly->bsdfs());
+    move_entities(staging_assembly.bssrdfs(), assembly->bssrdfs());
+    move_entities(staging_assembly.edfs(), assembly->edfs());
+    move_entities(staging_assembly.surface_shaders(), assembly->surface_shaders());
+    move_entities(staging_assembly.volumes(), assembly->volumes());
+    move_entities(staging_assembly.materials(), assembly->materials());
+    move_entities(staging_assembly.objects(), assembly->objects());
+    move_entities(staging_assembly.object_instances(), assembly->object_instances());
+    move_assemblies(staging_assembly.assemblies(), assembly->assemblies());
+    move_entities(staging_assembly.assembly_instances(), assembly->assembly_instances());
+
+    // The staging maps started as copies of the session's: existing entries are left alone.
+    m_session->m_object_map.insert(m_object_map.begin(), m_object_map.end());
+    m_session->m_material_map.insert(m_material_map.begin(), m_material_map.end());
+    m_session->m_assembly_map.insert(m_assembly_map.begin(), m_assembly_map.end());
+
+    for (const auto& entry : m_object_inst_map)
+        m_session->m_object_inst_map[entry.first] = entry.second;
+
+    for (const auto& entry : m_assembly_inst_map)
+        m_session->m_assembly_inst_map[entry.first] = entry.second;
+
+    assembly->bump_version_id();
 }
 
 void UpdateObjectInstanceAction::update()
@@ -171,18 +543,200 @@ void AddObjectInstanceAction::update()
     assembly->bump_version_id();
 }
 
+void LightUpdateAction::update()
+{
+    renderer::Assembly* assembly = m_session->m_project->get_scene()->assemblies().get_by_name("assembly");
+    DbgAssert(assembly);
+
+    for (INode* node : m_nodes)
+        remove_light(*assembly, node, m_session->m_light_map);
+
+    move_entities(m_staging_assembly->colors(), assembly->colors());
+    move_entities(m_staging_assembly->lights(), assembly->lights());
+
+    for (const auto& entry : m_light_map)
+        m_session->m_light_map[entry.first] = entry.second;
+}
+
+namespace
+{
+    // Reset the parameters of the master renderer from the interactive configuration.
+    void reset_master_renderer_parameters(InteractiveSession& session)
+    {
+        // The master renderer works on its own copy of the configuration parameters.
+        asr::ParamArray& params = session.m_master_renderer->get_parameters();
+        params = session.m_project->configurations().get_by_name("interactive")->get_inherited_parameters();
+
+        if (session.m_navigation_mode)
+        {
+            // Direct lighting only.
+            params.insert_path("pt.max_bounces", 0);
+            params.insert_path("pt.dl_light_samples", 1);
+            params.insert_path("pt.ibl_env_samples", 1);
+        }
+    }
+}
+
+void EnvironmentUpdateAction::update()
+{
+    asr::Scene& scene = *m_session->m_project->get_scene();
+
+    // Scene-level entities all belong to the environment.
+    scene.environment_edfs().clear();
+    scene.environment_shaders().clear();
+    scene.colors().clear();
+    scene.textures().clear();
+    scene.texture_instances().clear();
+
+    move_entities(m_environment->environment_edfs(), scene.environment_edfs());
+    move_entities(m_environment->environment_shaders(), scene.environment_shaders());
+    move_entities(m_environment->colors(), scene.colors());
+    move_entities(m_environment->textures(), scene.textures());
+    move_entities(m_environment->texture_instances(), scene.texture_instances());
+
+    // The environment itself can't be taken out of the scene it was built in.
+    scene.set_environment(
+        asr::EnvironmentFactory::create(
+            "environment",
+            m_environment->get_environment()->get_parameters()));
+}
+
+void RendererSettingsUpdateAction::update()
+{
+    asr::Project& project = *m_session->m_project;
+
+    m_session->m_renderer_settings = m_settings;
+
+    // Settings only add parameters: start again from the default configurations.
+    project.configurations().clear();
+    project.add_default_configurations();
+    m_settings.apply(project);
+
+    reset_master_renderer_parameters(*m_session);
+}
+
+void NavigationModeAction::update()
+{
+    asr::Project& project = *m_session->m_project;
+
+    m_session->m_navigation_mode = m_enabled;
+    reset_master_renderer_parameters(*m_session);
+
+    asf::Vector2i resolution = m_resolution;
+
+    if (m_enabled)
+    {
+        // Render a quarter of the pixels; the display upscales them.
+        resolution.x = std::max(m_resolution.x / 2, 1);
+        resolution.y = std::max(m_resolution.y / 2, 1);
+    }
+
+    recreate_frame(
+        project,
+        asr::ParamArray()
+            .insert("resolution", resolution));
+}
+
+namespace
+{
+    // Restarts cheaper than this happen immediately.
+    const double MinRestartDelay = 0.02;    // in seconds
+
+    // Never wait longer than this for further changes.
+    const double MaxRestartDelay = 1.0;     // in seconds
+}
+
 InteractiveRendererController::InteractiveRendererController()
   : m_status(ContinueRendering)
+  , m_measuring(false)
+  , m_scene_update_time(0.0)
+  , m_preparation_end_time(0.0)
+  , m_restart_cost(0.0)
+  , m_rendered_restart_count(0)
 {
 }
 
 void InteractiveRendererController::on_rendering_begin()
 {
-    for (auto& updater : m_scheduled_actions)
-        updater->update();
-    
-    m_scheduled_actions.clear();
-    m_status = ContinueRendering;
+    m_stopwatch.start();
+
+    {
+        boost::mutex::scoped_lock scene_lock(m_scene_update_mutex);
+
+        // Take the scheduled actions, further ones will be applied on the next restart.
+        std::vector<std::unique_ptr<ScheduledAction>> scheduled_actions;
+        {
+            boost::mutex::scoped_lock lock(m_scheduled_actions_mutex);
+            scheduled_actions.swap(m_scheduled_actions);
+            m_status = ContinueRendering;
+        }
+
+        for (auto& updater : scheduled_actions)
+            updater->update();
+    }
+
+    m_stopwatch.measure();
+    m_scene_update_time = m_stopwatch.get_seconds();
+    m_preparation_end_time = m_scene_update_time;
+    m_measuring = true;
+}
+
+void InteractiveRendererController::on_frame_begin()
+{
+    m_stopwatch.measure();
+    m_preparation_end_time = m_stopwatch.get_seconds();
+}
+
+void InteractiveRendererController::on_pass_rendered(const double pass_time)
+{
+    if (!m_measuring)
+        return;
+
+    m_measuring = false;
+
+    // Without a pass time, fall back to the time elapsed until this display update.
+    m_stopwatch.measure();
+    const double total_time =
+        pass_time >= 0.0
+            ? m_preparation_end_time + pass_time
+            : m_stopwatch.get_seconds();
+
+    {
+        boost::mutex::scoped_lock lock(m_restart_cost_mutex);
+
+        // Smooth the cost so that a single unusual restart does not swing the delay.
+        m_restart_cost =
+            m_restart_cost == 0.0
+                ? total_time
+                : 0.5 * (m_restart_cost + total_time);
+
+        ++m_rendered_restart_count;
+    }
+
+    RENDERER_LOG_INFO(
+        "interactive rendering restarted in %s (scene update %s, scene preparation %s, first pass %s), "
+        "waiting %s for further changes before restarting.",
+        asf::pretty_time(total_time).c_str(),
+        asf::pretty_time(m_scene_update_time).c_str(),
+        asf::pretty_time(m_preparation_end_time - m_scene_update_time).c_str(),
+        asf::pretty_time(total_time - m_preparation_end_time).c_str(),
+        asf::pretty_time(get_restart_delay()).c_str());
+}
+
+double InteractiveRendererController::get_restart_delay() const
+{
+    boost::mutex::scoped_lock lock(m_restart_cost_mutex);
+
+    return
+        m_restart_cost < MinRestartDelay
+            ? 0.0
+            : std::min(m_restart_cost, MaxRestartDelay);
+}
+
+size_t InteractiveRendererController::get_rendered_restart_count() const
+{
+    boost::mutex::scoped_lock lock(m_restart_cost_mutex);
+    return m_rendered_restart_count;
 }
 
 asr::IRendererController::Status InteractiveRendererController::get_status() const
@@ -197,5 +751,17 @@ void InteractiveRendererController::set_status(const Status status)
 
 void InteractiveRendererController::schedule_update(std::unique_ptr<ScheduledAction> updater)
 {
+    boost::mutex::scoped_lock lock(m_scheduled_actions_mutex);
     m_scheduled_actions.push_back(std::move(updater));
 }
+
+bool InteractiveRendererController::has_scheduled_updates() const
+{
+    boost::mutex::scoped_lock lock(m_scheduled_actions_mutex);
+    return !m_scheduled_actions.empty();
+}
+
+boost::mutex& InteractiveRendererController::get_scene_update_mutex()
+{
+    return m_scene_update_mutex;
+}
@@ -43,7 +43,13 @@
 #include "renderer/api/scene.h"
 
 // appleseed.foundation headers.
+#include "foundation/math/vector.h"
+#include "foundation/platform/defaulttimers.h"
 #include "foundation/utility/autoreleaseptr.h"
+#include "foundation/utility/stopwatch.h"
+
+// Boost headers.
+#include "boost/thread/mutex.hpp"
 
 // Standard headers.
 #include <memory>
@@ -79,23 +85,25 @@ class CameraObjectUpdateAction
     renderer::Project&                                m_project;
 };
 
+// Rebuild materials. Their appleseed names are looked up on the render thread, which owns
+// the material map of the session.
 class MaterialUpdateAction
   : public ScheduledAction
 {
   public:
     MaterialUpdateAction(
-        renderer::Project&      project,
-        const IAppleseedMtlMap& material_map)
-      : m_material_map(material_map)
-      , m_project(project)
+        const std::vector<Mtl*>&    materials,
+        InteractiveSession*         session)
+      : m_materials(materials)
+      , m_session(session)
     {
     }
 
     void update() override;
 
   private:
-    IAppleseedMtlMap        m_material_map;
-    renderer::Project&      m_project;
+    std::vector<Mtl*>       m_materials;
+    InteractiveSession*     m_session;
 };
 
 class RemoveObjectInstanceAction
@@ -136,6 +144,43 @@ class AddObjectInstanceAction
     InteractiveSession*     m_session;
 };
 
+// Move objects converted on the side into the scene's assembly. The conversion happens on the
+// UI thread, in a staging assembly whose entity names don't clash with the scene's, so that
+// only moving entities is left to the render thread.
+class AddStagedObjectsAction
+  : public ScheduledAction
+{
+  public:
+    AddStagedObjectsAction(
+        foundation::auto_release_ptr<renderer::Assembly>    staging_assembly,
+        const ObjectMap&                                    object_map,
+        const ObjectInstanceMap&                            object_inst_map,
+        const MaterialMap&                                  material_map,
+        const AssemblyMap&                                  assembly_map,
+        const AssemblyInstanceMap&                          assembly_inst_map,
+        InteractiveSession*                                 session)
+      : m_staging_assembly(staging_assembly)
+      , m_object_map(object_map)
+      , m_object_inst_map(object_inst_map)
+      , m_material_map(material_map)
+      , m_assembly_map(assembly_map)
+      , m_assembly_inst_map(assembly_inst_map)
+      , m_session(session)
+    {
+    }
+
+    void update() override;
+
+  private:
+    foundation::auto_release_ptr<renderer::Assembly>    m_staging_assembly;
+    ObjectMap                                           m_object_map;
+    ObjectInstanceMap                                   m_object_inst_map;
+    MaterialMap                                         m_material_map;
+    AssemblyMap                                         m_assembly_map;
+    AssemblyInstanceMap                                 m_assembly_inst_map;
+    InteractiveSession*                                 m_session;
+};
+
 class UpdateObjectInstanceAction
   : public ScheduledAction
 {
@@ -155,6 +200,107 @@ class UpdateObjectInstanceAction
     InteractiveSession*     m_session;
 };
 
+// Replace the appleseed lights of 3ds Max lights by the ones converted into a staging
+// assembly; lights of nodes missing from the staging light map are only removed. Lights
+// don't take part in the assembly's acceleration structures, so the assembly's version ID
+// is left alone.
+class LightUpdateAction
+  : public ScheduledAction
+{
+  public:
+    LightUpdateAction(
+        foundation::auto_release_ptr<renderer::Assembly>    staging_assembly,
+        const std::vector<INode*>&                          nodes,
+        const LightMap&                                     light_map,
+        InteractiveSession*                                 session)
+      : m_staging_assembly(staging_assembly)
+      , m_nodes(nodes)
+      , m_light_map(light_map)
+      , m_session(session)
+    {
+    }
+
+    void update() override;
+
+  private:
+    foundation::auto_release_ptr<renderer::Assembly>    m_staging_assembly;
+    std::vector<INode*>                                 m_nodes;
+    LightMap                                            m_light_map;
+    InteractiveSession*                                 m_session;
+};
+
+// Replace the environment of the scene by one built with build_environment().
+class EnvironmentUpdateAction
+  : public ScheduledAction
+{
+  public:
+    EnvironmentUpdateAction(
+        foundation::auto_release_ptr<renderer::Scene>   environment,
+        InteractiveSession*                             session)
+      : m_environment(environment)
+      , m_session(session)
+    {
+    }
+
+    void update() override;
+
+  private:
+    foundation::auto_release_ptr<renderer::Scene>   m_environment;
+    InteractiveSession*                             m_session;
+};
+
+// Apply new render settings to the interactive configuration and to the renderer.
+class RendererSettingsUpdateAction
+  : public ScheduledAction
+{
+  public:
+    RendererSettingsUpdateAction(
+        const RendererSettings&     settings,
+        InteractiveSession*         session)
+      : m_settings(settings)
+      , m_session(session)
+    {
+    }
+
+    void update() override;
+
+  private:
+    RendererSettings        m_settings;
+    InteractiveSession*     m_session;
+};
+
+// Switch between navigation quality, with a reduced resolution and direct lighting only,
+// and full quality.
+class NavigationModeAction
+  : public ScheduledAction
+{
+  public:
+    NavigationModeAction(
+        const bool                  enabled,
+        const foundation::Vector2i& resolution,
+        InteractiveSession*         session)
+      : m_enabled(enabled)
+      , m_resolution(resolution)
+      , m_session(session)
+    {
+    }
+
+    void update() override;
+
+  private:
+    bool                    m_enabled;
+    foundation::Vector2i    m_resolution;   // full resolution
+    InteractiveSession*     m_session;
+};
+
+//
+// Besides applying scheduled scene changes when rendering restarts, the controller measures
+// what each restart costs: updating the scene, preparing it for rendering (which includes
+// rebuilding acceleration structures) and rendering the first pass. The measured cost sets
+// how long the UI waits for further changes before restarting, so that light scenes update
+// instantly while heavy scenes batch changes instead of restarting over and over.
+//
+
 class InteractiveRendererController
   : public renderer::DefaultRendererController
 {
@@ -162,13 +308,46 @@ class InteractiveRendererController
     InteractiveRendererController();
 
     void on_rendering_begin() override;
+    void on_frame_begin() override;
     Status get_status() const override;
 
     void set_status(const Status status);
 
+    // Thread-safe.
     void schedule_update(std::unique_ptr<ScheduledAction> updater);
 
+    // Return true if scheduled updates have not been applied yet. Thread-safe.
+    bool has_scheduled_updates() const;
+
+    // The render thread holds this mutex while it applies scheduled updates. Holding it on
+    // another thread with no scheduled updates pending guarantees that the scene, and the
+    // entity maps of the session, are not modified. Only ever try to lock it from the UI
+    // thread: updates call into 3ds Max, which may need the UI thread.
+    boost::mutex& get_scene_update_mutex();
+
+    // Called by the tile callback when a pass has been rendered, with the time the pass took
+    // in seconds, or a negative value if it is unknown.
+    void on_pass_rendered(const double pass_time);
+
+    // Return how long to wait for further changes before restarting rendering, in seconds.
+    // Zero means restart immediately. Thread-safe.
+    double get_restart_delay() const;
+
+    // Return the number of restarts whose first pass has been rendered. Thread-safe.
+    size_t get_rendered_restart_count() const;
+
   private:
+    mutable boost::mutex                            m_scheduled_actions_mutex;
     std::vector<std::unique_ptr<ScheduledAction>>   m_scheduled_actions;
+    boost::mutex                                    m_scene_update_mutex;
     Status                                          m_status;
+
+    foundation::Stopwatch<foundation::DefaultWallclockTimer> m_stopwatch;
+    bool                                            m_measuring;            // true until the first pass after a restart
+    double                                          m_scene_update_time;
+    double                                          m_preparation_end_time;
+
+    mutable boost::mutex                            m_restart_cost_mutex;
+    double                                          m_restart_cost;         // smoothed, in seconds
+    size_t                                          m_rendered_restart_count;
 };
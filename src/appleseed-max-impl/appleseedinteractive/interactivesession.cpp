@@ -48,22 +48,24 @@ namespace asr = renderer;
 InteractiveSession::InteractiveSession(
     IIRenderMgr*                irender_manager,
     const RendererSettings&     settings,
-    Bitmap*                     bitmap)
+    Bitmap*                     bitmap,
+    const AOVBitmapMap&         aov_bitmaps)
   : m_irender_manager(irender_manager)
   , m_renderer_settings(settings)
   , m_bitmap(bitmap)
-  , m_renderer_controller(nullptr)
+  , m_aov_bitmaps(aov_bitmaps)
+  , m_renderer_controller(new InteractiveRendererController())
+  , m_master_renderer(nullptr)
+  , m_navigation_mode(false)
 {
 }
 
 void InteractiveSession::render_thread()
 {
-    // Create the renderer controller.
-    m_renderer_controller.reset(new InteractiveRendererController());
-
     // Create the tile callback.
     InteractiveTileCallback m_tile_callback(
         m_bitmap,
+        m_aov_bitmaps,
         m_irender_manager,
         m_renderer_controller.get());
 
@@ -74,9 +76,12 @@ void InteractiveSession::render_thread()
             m_project->configurations().get_by_name("interactive")->get_inherited_parameters(),
             m_search_paths,
             &m_tile_callback));
+    m_master_renderer = renderer.get();
 
     // Render the frame.
     renderer->render(*m_renderer_controller);
+
+    m_master_renderer = nullptr;
 }
 
 void InteractiveSession::start_render()
@@ -94,6 +99,26 @@ void InteractiveSession::reininitialize_render()
     m_renderer_controller->set_status(asr::IRendererController::ReinitializeRendering);
 }
 
+double InteractiveSession::get_restart_delay() const
+{
+    return m_renderer_controller->get_restart_delay();
+}
+
+size_t InteractiveSession::get_rendered_restart_count() const
+{
+    return m_renderer_controller->get_rendered_restart_count();
+}
+
+bool InteractiveSession::has_scheduled_updates() const
+{
+    return m_renderer_controller->has_scheduled_updates();
+}
+
+boost::mutex& InteractiveSession::get_scene_update_mutex()
+{
+    return m_renderer_controller->get_scene_update_mutex();
+}
+
 void InteractiveSession::end_render()
 {
     if (m_render_thread.joinable())
@@ -108,11 +133,11 @@ void InteractiveSession::schedule_camera_update(
             new CameraObjectUpdateAction(*m_project, camera)));
 }
 
-void InteractiveSession::schedule_material_update(const IAppleseedMtlMap& material_map)
+void InteractiveSession::schedule_material_update(const std::vector<Mtl*>& materials)
 {
     m_renderer_controller->schedule_update(
         std::unique_ptr<ScheduledAction>(
-            new MaterialUpdateAction(*m_project, material_map)));
+            new MaterialUpdateAction(materials, this)));
 }
 
 void InteractiveSession::schedule_add_object_instance(const std::vector<INode*>& nodes)
@@ -122,6 +147,26 @@ void InteractiveSession::schedule_add_object_instance(const std::vector<INode*>&
             new AddObjectInstanceAction(nodes, this)));
 }
 
+void InteractiveSession::schedule_add_staged_objects(
+    asf::auto_release_ptr<asr::Assembly>    staging_assembly,
+    const ObjectMap&                        object_map,
+    const ObjectInstanceMap&                object_inst_map,
+    const MaterialMap&                      material_map,
+    const AssemblyMap&                      assembly_map,
+    const AssemblyInstanceMap&              assembly_inst_map)
+{
+    m_renderer_controller->schedule_update(
+        std::unique_ptr<ScheduledAction>(
+            new AddStagedObjectsAction(
+                staging_assembly,
+                object_map,
+                object_inst_map,
+                material_map,
+                assembly_map,
+                assembly_inst_map,
+                this)));
+}
+
 void InteractiveSession::schedule_remove_object_instance(const std::vector<INode*>& nodes)
 {
     m_renderer_controller->schedule_update(
@@ -135,3 +180,37 @@ void InteractiveSession::schedule_udpate_object_instance(const std::vector<INode
         std::unique_ptr<ScheduledAction>(
             new UpdateObjectInstanceAction(nodes, this)));
 }
+
+void InteractiveSession::schedule_light_update(
+    asf::auto_release_ptr<asr::Assembly>    staging_assembly,
+    const std::vector<INode*>&              nodes,
+    const LightMap&                         light_map)
+{
+    m_renderer_controller->schedule_update(
+        std::unique_ptr<ScheduledAction>(
+            new LightUpdateAction(staging_assembly, nodes, light_map, this)));
+}
+
+void InteractiveSession::schedule_navigation_mode(const bool enabled)
+{
+    m_renderer_controller->schedule_update(
+        std::unique_ptr<ScheduledAction>(
+            new NavigationModeAction(
+                enabled,
+                asf::Vector2i(m_bitmap->Width(), m_bitmap->Height()),
+                this)));
+}
+
+void InteractiveSession::schedule_environment_update(asf::auto_release_ptr<asr::Scene> environment)
+{
+    m_renderer_controller->schedule_update(
+        std::unique_ptr<ScheduledAction>(
+            new EnvironmentUpdateAction(environment, this)));
+}
+
+void InteractiveSession::schedule_renderer_settings_update(const RendererSettings& settings)
+{
+    m_renderer_controller->schedule_update(
+        std::unique_ptr<ScheduledAction>(
+            new RendererSettingsUpdateAction(settings, this)));
+}
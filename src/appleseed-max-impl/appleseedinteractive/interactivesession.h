@@ -40,13 +40,19 @@
 #include "foundation/utility/autoreleaseptr.h"
 #include "foundation/utility/searchpaths.h"
 
+// Boost headers.
+#include "boost/thread/mutex.hpp"
+
 // Standard headers.
 #include <memory>
 #include <thread>
 
 // Forward declarations.
+namespace renderer   { class Assembly; }
 namespace renderer   { class Camera; }
+namespace renderer   { class MasterRenderer; }
 namespace renderer   { class Project; }
+namespace renderer   { class Scene; }
 
 class Bitmap;
 class IIRenderMgr;
@@ -57,7 +63,8 @@ class InteractiveSession
     InteractiveSession(
         IIRenderMgr*                irender_manager,
         const RendererSettings&     settings,
-        Bitmap*                     bitmap);
+        Bitmap*                     bitmap,
+        const AOVBitmapMap&         aov_bitmaps);
 
     void start_render();
     void abort_render();
@@ -65,23 +72,53 @@ class InteractiveSession
     void end_render();
 
     void schedule_camera_update(foundation::auto_release_ptr<renderer::Camera> camera);
-    void schedule_material_update(const IAppleseedMtlMap& material_map);
+    void schedule_material_update(const std::vector<Mtl*>& materials);
     void schedule_remove_object_instance(const std::vector<INode*>&);
     void schedule_add_object_instance(const std::vector<INode*>&);
+    void schedule_add_staged_objects(
+        foundation::auto_release_ptr<renderer::Assembly>    staging_assembly,
+        const ObjectMap&                                    object_map,
+        const ObjectInstanceMap&                            object_inst_map,
+        const MaterialMap&                                  material_map,
+        const AssemblyMap&                                  assembly_map,
+        const AssemblyInstanceMap&                          assembly_inst_map);
     void schedule_udpate_object_instance(const std::vector<INode*>&);
+    void schedule_light_update(
+        foundation::auto_release_ptr<renderer::Assembly>    staging_assembly,
+        const std::vector<INode*>&                          nodes,
+        const LightMap&                                     light_map);
+    void schedule_navigation_mode(const bool enabled);
+    void schedule_environment_update(foundation::auto_release_ptr<renderer::Scene> environment);
+    void schedule_renderer_settings_update(const RendererSettings& settings);
+
+    // Return how long to wait for further changes before restarting rendering, in seconds.
+    double get_restart_delay() const;
+
+    // Return the number of restarts whose first pass has been rendered.
+    size_t get_rendered_restart_count() const;
+
+    // See InteractiveRendererController::has_scheduled_updates().
+    bool has_scheduled_updates() const;
+
+    // See InteractiveRendererController::get_scene_update_mutex().
+    boost::mutex& get_scene_update_mutex();
 
     renderer::Project*                              m_project;
+    renderer::MasterRenderer*                       m_master_renderer;  // only valid on the render thread
+    bool                                            m_navigation_mode;
     ObjectMap                                       m_object_map;
     ObjectInstanceMap                               m_object_inst_map;
     MaterialMap                                     m_material_map;
     RendererSettings                                m_renderer_settings;
     AssemblyMap                                     m_assembly_map;
     AssemblyInstanceMap                             m_assembly_inst_map;
+    LightMap                                        m_light_map;
 
   private:
     std::unique_ptr<InteractiveRendererController>  m_renderer_controller;
     std::thread                                     m_render_thread;
     Bitmap*                                         m_bitmap;
+    const AOVBitmapMap                              m_aov_bitmaps;
     IIRenderMgr*                                    m_irender_manager;
     foundation::SearchPaths                         m_search_paths;
 
@@ -29,6 +29,22 @@
 // Interface header.
 #include "interactivetilecallback.h"
 
+// appleseed-max headers.
+#include "appleseedinteractive/interactiverenderercontroller.h"
+
+// appleseed.renderer headers.
+#include "renderer/api/aov.h"
+#include "renderer/api/frame.h"
+
+// appleseed.foundation headers.
+#include "foundation/image/canvasproperties.h"
+#include "foundation/image/color.h"
+#include "foundation/image/image.h"
+
+// Boost headers.
+#include "boost/thread/locks.hpp"
+#include "boost/thread/mutex.hpp"
+
 // 3ds Max headers.
 #include "appleseed-max-common/_beginmaxheaders.h"
 #include <bitmap.h>
@@ -36,6 +52,13 @@
 #include <maxapi.h>
 #include "appleseed-max-common/_endmaxheaders.h"
 
+// Standard headers.
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace asf = foundation;
 namespace asr = renderer;
 
 
@@ -46,19 +69,131 @@ namespace asr = renderer;
 namespace
 {
     const UINT WM_TRIGGER_CALLBACK = WM_USER + 4764;
+
+    struct DisplayImage
+    {
+        size_t                      m_width;
+        size_t                      m_height;
+        std::vector<asf::Color4f>   m_pixels;
+
+        DisplayImage()
+          : m_width(0)
+          , m_height(0)
+        {
+        }
+
+        void resize(const asf::CanvasProperties& props)
+        {
+            m_width = props.m_canvas_width;
+            m_height = props.m_canvas_height;
+            m_pixels.resize(props.m_pixel_count);
+        }
+
+        void clear()
+        {
+            m_width = m_height = 0;
+            m_pixels.clear();
+        }
+    };
+
+    // Pixels of the beauty image and of the AOVs displayed in render element bitmaps.
+    struct DisplayFrame
+    {
+        DisplayImage                m_beauty;
+        std::vector<DisplayImage>   m_aovs;     // same order as DisplayBuffers::m_aov_bitmaps, empty if not rendered
+    };
+
+    void blit_pixels(
+        const DisplayImage&         image,
+        Bitmap*                     bitmap)
+    {
+        if (image.m_width == 0 || image.m_height == 0)
+            return;
+
+        const int width = bitmap->Width();
+        const int height = bitmap->Height();
+
+        if (image.m_width == static_cast<size_t>(width) && image.m_height == static_cast<size_t>(height))
+        {
+            // Bitmap::PutPixels() does not modify the pixels it's given.
+            for (int y = 0; y < height; ++y)
+            {
+                bitmap->PutPixels(
+                    0,
+                    y,
+                    width,
+                    const_cast<BMM_Color_fl*>(reinterpret_cast<const BMM_Color_fl*>(&image.m_pixels[y * width])));
+            }
+        }
+        else
+        {
+            // Frames rendered at a lower resolution (e.g. while navigating) are upscaled
+            // by pixel replication.
+            std::vector<BMM_Color_fl> row(width);
+            for (int y = 0; y < height; ++y)
+            {
+                const size_t src_y = static_cast<size_t>(y) * image.m_height / height;
+                const asf::Color4f* src_row = &image.m_pixels[src_y * image.m_width];
+
+                for (int x = 0; x < width; ++x)
+                {
+                    const asf::Color4f& c = src_row[static_cast<size_t>(x) * image.m_width / width];
+                    row[x] = BMM_Color_fl(c.r, c.g, c.b, c.a);
+                }
+
+                bitmap->PutPixels(0, y, width, row.data());
+            }
+        }
+    }
 }
 
+struct InteractiveTileCallback::DisplayBuffers
+{
+    boost::mutex                                    m_mutex;
+    DisplayFrame                                    m_frames[3];
+    DisplayFrame*                                   m_back;             // written by the render thread
+    DisplayFrame*                                   m_ready;            // latest published frame
+    DisplayFrame*                                   m_front;            // read by the UI thread
+    bool                                            m_ready_is_new;     // the ready frame was not displayed yet
+    bool                                            m_update_pending;   // a display update was posted and not handled yet
+    Bitmap*                                         m_bitmap;           // null once the callback is destroyed
+    std::vector<std::pair<std::string, Bitmap*>>    m_aov_bitmaps;
+    IIRenderMgr*                                    m_irender_manager;
+
+    DisplayBuffers(
+        Bitmap*                 bitmap,
+        const AOVBitmapMap&     aov_bitmaps,
+        IIRenderMgr*            irender_manager)
+      : m_back(&m_frames[0])
+      , m_ready(&m_frames[1])
+      , m_front(&m_frames[2])
+      , m_ready_is_new(false)
+      , m_update_pending(false)
+      , m_bitmap(bitmap)
+      , m_aov_bitmaps(aov_bitmaps.begin(), aov_bitmaps.end())
+      , m_irender_manager(irender_manager)
+    {
+    }
+};
+
 InteractiveTileCallback::InteractiveTileCallback(
-    Bitmap*                     bitmap,
-    IIRenderMgr*                irender_manager,
-    asr::IRendererController*   renderer_controller)
+    Bitmap*                         bitmap,
+    const AOVBitmapMap&             aov_bitmaps,
+    IIRenderMgr*                    irender_manager,
+    InteractiveRendererController*  renderer_controller)
   : TileCallback(bitmap, nullptr)
-  , m_bitmap(bitmap)
-  , m_irender_manager(irender_manager)
+  , m_display(std::make_shared<DisplayBuffers>(bitmap, aov_bitmaps, irender_manager))
   , m_renderer_controller(renderer_controller)
 {
 }
 
+InteractiveTileCallback::~InteractiveTileCallback()
+{
+    // Display updates still pending must no longer touch the bitmaps.
+    boost::mutex::scoped_lock lock(m_display->m_mutex);
+    m_display->m_bitmap = nullptr;
+}
+
 void InteractiveTileCallback::on_progressive_frame_update(
     const asr::Frame&           frame,
     const double                time,
@@ -66,32 +201,97 @@ void InteractiveTileCallback::on_progressive_frame_update(
     const double                samples_per_pixel,
     const std::uint64_t         samples_per_second)
 {
-    TileCallback::on_progressive_frame_update(
-        frame,
-        time,
-        samples,
-        samples_per_pixel,
-        samples_per_second);
-
-    // Wait until UI proc gets handled to ensure class object is valid.
-    m_ui_promise = std::promise<void>();
-    if (m_renderer_controller->get_status() == asr::IRendererController::ContinueRendering)
+    if (m_renderer_controller->get_status() != asr::IRendererController::ContinueRendering)
+        return;
+
+    // Display updates are throttled, so the time of this update is not the time the first pass
+    // took. Derive the latter from the sampling rate instead: a pass takes one sample per pixel.
+    const double pass_time =
+        samples_per_second > 0
+            ? static_cast<double>(frame.image().properties().m_pixel_count) / samples_per_second
+            : -1.0;
+    m_renderer_controller->on_pass_rendered(pass_time);
+
+    // Only the render thread swaps the back buffer, it can be written without locking.
+    DisplayFrame& back = *m_display->m_back;
+
+    back.m_beauty.resize(frame.image().properties());
+    copy_image(frame.image(), back.m_beauty.m_pixels.data());
+
+    back.m_aovs.resize(m_display->m_aov_bitmaps.size());
+    for (size_t i = 0, e = m_display->m_aov_bitmaps.size(); i < e; ++i)
+    {
+        back.m_aovs[i].clear();
+
+        for (const asr::AOV& aov : frame.aovs())
+        {
+            if (aov.get_name() == m_display->m_aov_bitmaps[i].first)
+            {
+                back.m_aovs[i].resize(aov.get_image().properties());
+                copy_image(aov.get_image(), back.m_aovs[i].m_pixels.data());
+                break;
+            }
+        }
+    }
+
+    // Publish the frame.
+    bool post_update;
     {
-        PostMessage(
-            GetCOREInterface()->GetMAXHWnd(),
-            WM_TRIGGER_CALLBACK,
-            reinterpret_cast<UINT_PTR>(update_caller),
-            reinterpret_cast<UINT_PTR>(this));
-        m_ui_promise.get_future().wait();
+        boost::mutex::scoped_lock lock(m_display->m_mutex);
+        std::swap(m_display->m_back, m_display->m_ready);
+        m_display->m_ready_is_new = true;
+        post_update = !m_display->m_update_pending;
+        m_display->m_update_pending = true;
+    }
+
+    // A display update that is already pending will pick up this frame.
+    if (post_update)
+    {
+        auto display = new std::shared_ptr<DisplayBuffers>(m_display);
+        if (!PostMessage(
+                GetCOREInterface()->GetMAXHWnd(),
+                WM_TRIGGER_CALLBACK,
+                reinterpret_cast<UINT_PTR>(update_caller),
+                reinterpret_cast<UINT_PTR>(display)))
+        {
+            delete display;
+            boost::mutex::scoped_lock lock(m_display->m_mutex);
+            m_display->m_update_pending = false;
+        }
     }
 }
 
 void InteractiveTileCallback::update_caller(UINT_PTR param_ptr)
 {
-    auto tile_callback = reinterpret_cast<InteractiveTileCallback*>(param_ptr);
-    
-    if (tile_callback->m_irender_manager->IsRendering())
-        tile_callback->m_irender_manager->UpdateDisplay();
+    const std::unique_ptr<std::shared_ptr<DisplayBuffers>> display_ptr(
+        reinterpret_cast<std::shared_ptr<DisplayBuffers>*>(param_ptr));
+    DisplayBuffers& display = **display_ptr;
+
+    Bitmap* bitmap;
+    {
+        boost::mutex::scoped_lock lock(display.m_mutex);
+        display.m_update_pending = false;
+
+        if (display.m_bitmap == nullptr || !display.m_ready_is_new)
+            return;
+
+        std::swap(display.m_front, display.m_ready);
+        display.m_ready_is_new = false;
+        bitmap = display.m_bitmap;
+    }
+
+    // The front buffer belongs to the UI thread until the next update. Bitmaps are only
+    // released by the UI thread after the render thread has ended, so they are still valid.
+    const DisplayFrame& front = *display.m_front;
+    blit_pixels(front.m_beauty, bitmap);
+
+    for (size_t i = 0, e = front.m_aovs.size(); i < e; ++i)
+    {
+        Bitmap* aov_bitmap = display.m_aov_bitmaps[i].second;
+        blit_pixels(front.m_aovs[i], aov_bitmap);
+        aov_bitmap->RefreshWindow();
+    }
 
-    tile_callback->m_ui_promise.set_value();
+    if (display.m_irender_manager->IsRendering())
+        display.m_irender_manager->UpdateDisplay();
 }
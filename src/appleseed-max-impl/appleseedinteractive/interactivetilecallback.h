@@ -40,13 +40,20 @@
 
 // Standard headers.
 #include <cstdint>
-#include <future>
+#include <memory>
 
 // Forward declarations.
 namespace renderer  { class Frame; }
-namespace renderer  { class IRendererController; }
 class Bitmap;
 class IIRenderMgr;
+class InteractiveRendererController;
+
+//
+// Render threads copy each progressive frame into a back buffer, publish it and return to
+// sampling without waiting for the UI. The UI thread displays the latest published frame
+// when it gets to it: a slow UI drops frames instead of slowing rendering down. How often
+// frames are published is capped by the max_fps parameter of the progressive frame renderer.
+//
 
 class InteractiveTileCallback
   : public TileCallback
@@ -54,8 +61,11 @@ class InteractiveTileCallback
   public:
     InteractiveTileCallback(
         Bitmap*                         bitmap,
+        const AOVBitmapMap&             aov_bitmaps,
         IIRenderMgr*                    irender_manager,
-        renderer::IRendererController*  renderer_controller);
+        InteractiveRendererController*  renderer_controller);
+
+    ~InteractiveTileCallback();
 
     void on_progressive_frame_update(
         const renderer::Frame&          frame,
@@ -65,10 +75,11 @@ class InteractiveTileCallback
         const std::uint64_t             samples_per_second) override;
 
   private:
-    Bitmap*                             m_bitmap;
-    IIRenderMgr*                        m_irender_manager;
-    renderer::IRendererController*      m_renderer_controller;
-    std::promise<void>                  m_ui_promise;
+    struct DisplayBuffers;
+
+    // Shared with the display updates posted to the UI thread, which may outlive the callback.
+    std::shared_ptr<DisplayBuffers>     m_display;
+    InteractiveRendererController*      m_renderer_controller;
 
     static void update_caller(UINT_PTR param_ptr);
 };
@@ -0,0 +1,772 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2015-2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Interface header.
+#include "appleseedproxyobj.h"
+
+// appleseed-max headers.
+#include "appleseedproxyobj/datachunks.h"
+#include "appleseedproxyobj/resource.h"
+#include "main.h"
+#include "utilities.h"
+#include "version.h"
+
+// Build options header.
+#include "foundation/core/buildoptions.h"
+
+// appleseed.renderer headers.
+#include "renderer/api/log.h"
+#include "renderer/api/object.h"
+#include "renderer/api/project.h"
+#include "renderer/api/utility.h"
+
+// appleseed.foundation headers.
+#include "foundation/core/exceptions/exception.h"
+#include "foundation/math/vector.h"
+#include "foundation/mesh/genericmeshfilereader.h"
+#include "foundation/mesh/imeshbuilder.h"
+#include "foundation/utility/searchpaths.h"
+
+// 3ds Max headers.
+#include "appleseed-max-common/_beginmaxheaders.h"
+#include <gfx.h>
+#include <maxapi.h>
+#include <mouseman.h>
+#include <paramtype.h>
+#include "appleseed-max-common/_endmaxheaders.h"
+
+// Standard headers.
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace asf = foundation;
+namespace asr = renderer;
+
+AppleseedProxyObjClassDesc g_appleseed_proxyobj_classdesc;
+
+
+//
+// AppleseedProxyObj class implementation.
+//
+
+namespace
+{
+    enum { ParamBlockIdProxyObj };
+    enum { ParamBlockRefProxyObj };
+
+    enum ParamMapId
+    {
+        ParamMapIdProxy
+    };
+
+    enum ParamId
+    {
+        // Changing these value WILL break compatibility.
+        ParamIdFilePath                     = 0,
+        ParamIdDisplayMode                  = 1
+    };
+
+    enum DisplayMode
+    {
+        DisplayModeBoundingBox              = 0,
+        DisplayModePointCloud               = 1
+    };
+
+    ParamBlockDesc2 g_block_desc(
+        // --- Required arguments ---
+        ParamBlockIdProxyObj,                       // parameter block's ID
+        L"appleseedProxyObjParams",                 // internal parameter block's name
+        0,                                          // ID of the localized name string
+        &g_appleseed_proxyobj_classdesc,            // class descriptor
+        P_AUTO_CONSTRUCT + P_MULTIMAP + P_AUTO_UI,  // block flags
+
+        // --- P_AUTO_CONSTRUCT arguments ---
+        ParamBlockRefProxyObj,                      // parameter block's reference number
+
+        // --- P_MULTIMAP arguments ---
+        1,                                          // number of rollups
+
+        // --- P_AUTO_UI arguments for Proxy rollup ---
+        ParamMapIdProxy,
+        IDD_FORMVIEW_PARAMS,                        // ID of the dialog template
+        IDS_FORMVIEW_PARAMS_TITLE,                  // ID of the dialog's title string
+        0,                                          // IParamMap2 creation/deletion flag mask
+        0,                                          // rollup creation flag
+        nullptr,                                    // user dialog procedure
+
+        // --- Parameters specifications ---
+
+        ParamIdFilePath, L"filepath", TYPE_FILENAME, 0, IDS_FILEPATH,
+            p_ui, ParamMapIdProxy, TYPE_FILEOPENBUTTON, IDC_BUTTON_FILEPATH,
+            p_caption, IDS_FILEPATH_CAPTION,
+            p_file_types, IDS_FILEPATH_TYPES,
+        p_end,
+        ParamIdDisplayMode, L"display_mode", TYPE_INT, 0, IDS_DISPLAY,
+            p_default, DisplayModeBoundingBox,
+            p_ui, ParamMapIdProxy, TYPE_RADIO, 2, IDC_RADIO_DISPLAY_BBOX, IDC_RADIO_DISPLAY_POINTS,
+        p_end,
+
+        // --- The end ---
+        p_end);
+
+    // Maximum number of vertices of the mesh file displayed in point cloud mode.
+    const size_t MaxDisplayedPoints = 10000;
+
+    // Half the size of the box displayed when no mesh file is referenced.
+    const float PlaceholderBoxHalfSize = 10.0f;
+
+    class ProxyObjCreateCallBack
+      : public CreateMouseCallBack
+    {
+      public:
+        int proc(ViewExp* vpt, int msg, int point, int flags, IPoint2 m, Matrix3& mat) override
+        {
+            switch (msg)
+            {
+              case MOUSE_POINT:
+              case MOUSE_MOVE:
+                mat.SetTrans(vpt->SnapPoint(m, m, nullptr, SNAP_IN_3D));
+                return msg == MOUSE_POINT ? CREATE_STOP : CREATE_CONTINUE;
+
+              case MOUSE_ABORT:
+                return CREATE_ABORT;
+
+              default:
+                return CREATE_CONTINUE;
+            }
+        }
+    };
+
+    ProxyObjCreateCallBack g_create_callback;
+
+    // Merge the meshes read from a mesh file into a single mesh object. Material slots with the same name are merged.
+    asf::auto_release_ptr<asr::MeshObject> merge_mesh_objects(
+        const char*                 name,
+        const asr::MeshObjectArray& objects)
+    {
+        asf::auto_release_ptr<asr::MeshObject> merged(
+            asr::MeshObjectFactory().create(name, asr::ParamArray()));
+
+        std::map<std::string, std::uint32_t> slot_indices;
+        const auto get_or_push_material_slot = [&merged, &slot_indices](const char* slot_name)
+        {
+            const auto it = slot_indices.find(slot_name);
+            if (it != slot_indices.end())
+                return it->second;
+
+            const auto slot_index = static_cast<std::uint32_t>(merged->push_material_slot(slot_name));
+            slot_indices.insert(std::make_pair(slot_name, slot_index));
+            return slot_index;
+        };
+
+        const auto offset_index = [](const std::uint32_t index, const std::uint32_t base)
+        {
+            return index == asr::Triangle::None ? index : index + base;
+        };
+
+        for (size_t i = 0, e = objects.size(); i < e; ++i)
+        {
+            const asr::MeshObject& object = *objects[i];
+
+            const auto vertex_base = static_cast<std::uint32_t>(merged->get_vertex_count());
+            const auto tex_coords_base = static_cast<std::uint32_t>(merged->get_tex_coords_count());
+            const auto normal_base = static_cast<std::uint32_t>(merged->get_vertex_normal_count());
+
+            std::vector<std::uint32_t> slot_remap;
+            for (size_t j = 0, je = object.get_material_slot_count(); j < je; ++j)
+                slot_remap.push_back(get_or_push_material_slot(object.get_material_slot(j)));
+            if (slot_remap.empty())
+                slot_remap.push_back(get_or_push_material_slot("default"));
+
+            for (size_t j = 0, je = object.get_vertex_count(); j < je; ++j)
+                merged->push_vertex(object.get_vertex(j));
+
+            for (size_t j = 0, je = object.get_tex_coords_count(); j < je; ++j)
+                merged->push_tex_coords(object.get_tex_coords(j));
+
+            for (size_t j = 0, je = object.get_vertex_normal_count(); j < je; ++j)
+                merged->push_vertex_normal(object.get_vertex_normal(j));
+
+            for (size_t j = 0, je = object.get_triangle_count(); j < je; ++j)
+            {
+                asr::Triangle triangle = object.get_triangle(j);
+                triangle.m_v0 += vertex_base;
+                triangle.m_v1 += vertex_base;
+                triangle.m_v2 += vertex_base;
+                triangle.m_n0 = offset_index(triangle.m_n0, normal_base);
+                triangle.m_n1 = offset_index(triangle.m_n1, normal_base);
+                triangle.m_n2 = offset_index(triangle.m_n2, normal_base);
+                triangle.m_a0 = offset_index(triangle.m_a0, tex_coords_base);
+                triangle.m_a1 = offset_index(triangle.m_a1, tex_coords_base);
+                triangle.m_a2 = offset_index(triangle.m_a2, tex_coords_base);
+                triangle.m_pa = slot_remap[triangle.m_pa < slot_remap.size() ? triangle.m_pa : 0];
+                merged->push_triangle(triangle);
+            }
+        }
+
+        return merged;
+    }
+
+    //
+    // Mesh builder only keeping what the viewport displays: the bounding box of the vertices
+    // and a subset of them. The number of vertices is unknown upfront, so every other kept
+    // vertex is dropped whenever the subset grows too large.
+    //
+
+    class PreviewMeshBuilder
+      : public asf::IMeshBuilder
+    {
+      public:
+        PreviewMeshBuilder(Box3& bbox, std::vector<Point3>& points)
+          : m_bbox(bbox)
+          , m_points(points)
+          , m_vertex_count(0)
+          , m_step(1)
+        {
+        }
+
+        void begin_mesh(const char* name) override {}
+
+        size_t push_vertex(const asf::Vector3d& v) override
+        {
+            const Point3 p(static_cast<float>(v.x), static_cast<float>(v.y), static_cast<float>(v.z));
+
+            m_bbox += p;
+
+            const size_t index = m_vertex_count++;
+            if (index % m_step == 0)
+            {
+                m_points.push_back(p);
+
+                if (m_points.size() > MaxDisplayedPoints)
+                {
+                    const size_t kept_count = (m_points.size() + 1) / 2;
+                    for (size_t i = 0; i < kept_count; ++i)
+                        m_points[i] = m_points[i * 2];
+                    m_points.resize(kept_count);
+                    m_step *= 2;
+                }
+            }
+
+            return index;
+        }
+
+        size_t push_vertex_normal(const asf::Vector3d& v) override { return 0; }
+        size_t push_tex_coords(const asf::Vector2d& v) override { return 0; }
+        size_t push_material_slot(const char* name) override { return 0; }
+        void begin_face(const size_t vertex_count) override {}
+        void set_face_vertices(const size_t vertices[]) override {}
+        void set_face_vertex_normals(const size_t vertex_normals[]) override {}
+        void set_face_vertex_tex_coords(const size_t tex_coords[]) override {}
+        void set_face_material(const size_t material) override {}
+        void end_face() override {}
+        void end_mesh() override {}
+
+      private:
+        Box3&                   m_bbox;
+        std::vector<Point3>&    m_points;
+        size_t                  m_vertex_count;
+        size_t                  m_step;
+    };
+
+    asf::auto_release_ptr<asr::MeshObject> read_mesh_file(
+        const asf::SearchPaths& search_paths,
+        const char*             name,
+        const std::string&      filepath)
+    {
+        asr::MeshObjectArray objects;
+        if (!asr::MeshObjectReader::read(
+                search_paths,
+                name,
+                asr::ParamArray().insert("filename", filepath),
+                objects) || objects.size() == 0)
+        {
+            // The objects read before the failure still belong to us.
+            for (size_t i = 0, e = objects.size(); i < e; ++i)
+                objects[i]->release();
+
+            RENDERER_LOG_ERROR("failed to read mesh file %s.", filepath.c_str());
+            return asf::auto_release_ptr<asr::MeshObject>();
+        }
+
+        if (objects.size() == 1)
+        {
+            asf::auto_release_ptr<asr::MeshObject> object(objects[0]);
+            object->set_name(name);
+            return object;
+        }
+
+        asf::auto_release_ptr<asr::MeshObject> merged = merge_mesh_objects(name, objects);
+
+        for (size_t i = 0, e = objects.size(); i < e; ++i)
+            objects[i]->release();
+
+        return merged;
+    }
+}
+
+Class_ID AppleseedProxyObj::get_class_id()
+{
+    return Class_ID(0x6ab3217c, 0x1c4e5f0a);
+}
+
+AppleseedProxyObj::AppleseedProxyObj()
+  : m_pblock(nullptr)
+{
+    m_bbox.Init();
+    g_appleseed_proxyobj_classdesc.MakeAutoParamBlocks(this);
+}
+
+void AppleseedProxyObj::DeleteThis()
+{
+    delete this;
+}
+
+void AppleseedProxyObj::GetClassName(TSTR& s)
+{
+    s = L"appleseedProxyObj";
+}
+
+SClass_ID AppleseedProxyObj::SuperClassID()
+{
+    return GEOMOBJECT_CLASS_ID;
+}
+
+Class_ID AppleseedProxyObj::ClassID()
+{
+    return get_class_id();
+}
+
+void AppleseedProxyObj::BeginEditParams(IObjParam* ip, ULONG flags, Animatable* prev)
+{
+    g_appleseed_proxyobj_classdesc.BeginEditParams(ip, this, flags, prev);
+}
+
+void AppleseedProxyObj::EndEditParams(IObjParam* ip, ULONG flags, Animatable* next)
+{
+    g_appleseed_proxyobj_classdesc.EndEditParams(ip, this, flags, next);
+}
+
+int AppleseedProxyObj::NumSubs()
+{
+    return NumRefs();
+}
+
+Animatable* AppleseedProxyObj::SubAnim(int i)
+{
+    return GetReference(i);
+}
+
+TSTR AppleseedProxyObj::SubAnimName(int i)
+{
+    return i == ParamBlockRefProxyObj ? L"Parameters" : L"";
+}
+
+int AppleseedProxyObj::SubNumToRefNum(int subNum)
+{
+    return subNum;
+}
+
+int AppleseedProxyObj::NumParamBlocks()
+{
+    return 1;
+}
+
+IParamBlock2* AppleseedProxyObj::GetParamBlock(int i)
+{
+    return i == ParamBlockRefProxyObj ? m_pblock : nullptr;
+}
+
+IParamBlock2* AppleseedProxyObj::GetParamBlockByID(BlockID id)
+{
+    return id == m_pblock->ID() ? m_pblock : nullptr;
+}
+
+BaseInterface* AppleseedProxyObj::GetInterface(Interface_ID id)
+{
+    return
+        id == IAppleseedGeometricObject::interface_id()
+            ? static_cast<IAppleseedGeometricObject*>(this)
+            : GeomObject::GetInterface(id);
+}
+
+int AppleseedProxyObj::NumRefs()
+{
+    return 1;
+}
+
+RefTargetHandle AppleseedProxyObj::GetReference(int i)
+{
+    return i == ParamBlockRefProxyObj ? m_pblock : nullptr;
+}
+
+void AppleseedProxyObj::SetReference(int i, RefTargetHandle rtarg)
+{
+    if (i == ParamBlockRefProxyObj)
+    {
+        if (IParamBlock2* pblock = dynamic_cast<IParamBlock2*>(rtarg))
+            m_pblock = pblock;
+    }
+}
+
+RefResult AppleseedProxyObj::NotifyRefChanged(
+    const Interval&     changeInt,
+    RefTargetHandle     hTarget,
+    PartID&             partID,
+    RefMessage          message,
+    BOOL                propagate)
+{
+    if (hTarget == m_pblock &&
+        message == REFMSG_CHANGE &&
+        m_pblock->LastNotifyParamID() == ParamIdFilePath)
+        update_preview();
+
+    return REF_SUCCEED;
+}
+
+IOResult AppleseedProxyObj::Save(ISave* isave)
+{
+    bool success = true;
+
+    isave->BeginChunk(ChunkFileFormatVersion);
+    success &= write(isave, FileFormatVersion);
+    isave->EndChunk();
+
+    isave->BeginChunk(ChunkBoundingBox);
+    success &= write(isave, m_bbox);
+    isave->EndChunk();
+
+    isave->BeginChunk(ChunkPoints);
+    success &= write(isave, static_cast<std::uint32_t>(m_points.size()));
+    if (!m_points.empty())
+        success &= write(isave, m_points.data(), m_points.size() * sizeof(Point3));
+    isave->EndChunk();
+
+    return success ? IO_OK : IO_ERROR;
+}
+
+IOResult AppleseedProxyObj::Load(ILoad* iload)
+{
+    IOResult result = IO_OK;
+
+    while (true)
+    {
+        result = iload->OpenChunk();
+        if (result == IO_END)
+            return IO_OK;
+        if (result != IO_OK)
+            break;
+
+        switch (iload->CurChunkID())
+        {
+          case ChunkFileFormatVersion:
+            {
+                USHORT version;
+                result = read<USHORT>(iload, &version);
+            }
+            break;
+
+          case ChunkBoundingBox:
+            result = read<Box3>(iload, &m_bbox);
+            break;
+
+          case ChunkPoints:
+            {
+                std::uint32_t point_count;
+                result = read<std::uint32_t>(iload, &point_count);
+                if (result == IO_OK && point_count > 0)
+                {
+                    m_points.resize(point_count);
+                    const ULONG size = static_cast<ULONG>(point_count * sizeof(Point3));
+                    ULONG read;
+                    result = iload->ReadVoid(m_points.data(), size, &read);
+                    if (read != size)
+                        result = IO_ERROR;
+                }
+            }
+            break;
+        }
+
+        if (result != IO_OK)
+            break;
+
+        result = iload->CloseChunk();
+        if (result != IO_OK)
+            break;
+    }
+
+    return result;
+}
+
+RefTargetHandle AppleseedProxyObj::Clone(RemapDir& remap)
+{
+    AppleseedProxyObj* clone = new AppleseedProxyObj();
+    clone->ReplaceReference(ParamBlockRefProxyObj, remap.CloneRef(m_pblock));
+    clone->m_bbox = m_bbox;
+    clone->m_points = m_points;
+    BaseClone(this, clone, remap);
+    return clone;
+}
+
+CreateMouseCallBack* AppleseedProxyObj::GetCreateMouseCallBack()
+{
+    return &g_create_callback;
+}
+
+const MCHAR* AppleseedProxyObj::GetObjectName()
+{
+    return L"appleseed Proxy";
+}
+
+bool AppleseedProxyObj::RequiresSupportForLegacyDisplayMode() const
+{
+    return true;
+}
+
+int AppleseedProxyObj::Display(TimeValue t, INode* inode, ViewExp* vpt, int flags)
+{
+    GraphicsWindow* gw = vpt->getGW();
+    const DWORD limits = gw->getRndLimits();
+
+    gw->setRndLimits(GW_WIREFRAME | GW_EDGES_ONLY | (limits & GW_Z_BUFFER));
+    gw->setTransform(inode->GetObjectTM(t));
+
+    if (inode->Selected())
+        gw->setColor(LINE_COLOR, GetSelColor());
+    else gw->setColor(LINE_COLOR, Color(inode->GetWireColor()));
+
+    draw(gw);
+
+    gw->setRndLimits(limits);
+
+    return 0;
+}
+
+int AppleseedProxyObj::HitTest(TimeValue t, INode* inode, int type, int crossing, int flags, IPoint2* p, ViewExp* vpt)
+{
+    HitRegion hit_region;
+    MakeHitRegion(hit_region, type, crossing, 4, p);
+
+    GraphicsWindow* gw = vpt->getGW();
+    const DWORD limits = gw->getRndLimits();
+
+    gw->setRndLimits((limits | GW_PICK) & ~GW_ILLUM);
+    gw->setHitRegion(&hit_region);
+    gw->clearHitCode();
+    gw->setTransform(inode->GetObjectTM(t));
+
+    draw(gw);
+
+    gw->setRndLimits(limits);
+
+    return gw->checkHitCode();
+}
+
+void AppleseedProxyObj::GetWorldBoundBox(TimeValue t, INode* inode, ViewExp* vpt, Box3& box)
+{
+    GetLocalBoundBox(t, inode, vpt, box);
+    box = box * inode->GetObjectTM(t);
+}
+
+void AppleseedProxyObj::GetLocalBoundBox(TimeValue t, INode* inode, ViewExp* vpt, Box3& box)
+{
+    if (m_bbox.IsEmpty())
+    {
+        const Point3 half_size(PlaceholderBoxHalfSize, PlaceholderBoxHalfSize, PlaceholderBoxHalfSize);
+        box = Box3(-half_size, half_size);
+    }
+    else box = m_bbox;
+}
+
+ObjectState AppleseedProxyObj::Eval(TimeValue t)
+{
+    return ObjectState(this);
+}
+
+Interval AppleseedProxyObj::ObjectValidity(TimeValue t)
+{
+    return FOREVER;
+}
+
+void AppleseedProxyObj::InitNodeName(TSTR& s)
+{
+    s = L"appleseedProxy";
+}
+
+int AppleseedProxyObj::CanConvertToType(Class_ID obtype)
+{
+    return obtype == get_class_id() ? TRUE : FALSE;
+}
+
+void AppleseedProxyObj::GetDeformBBox(TimeValue t, Box3& box, Matrix3* tm, BOOL useSel)
+{
+    GetLocalBoundBox(t, nullptr, nullptr, box);
+
+    if (tm != nullptr)
+        box = box * *tm;
+}
+
+Mesh* AppleseedProxyObj::GetRenderMesh(TimeValue t, INode* inode, View& view, BOOL& needDelete)
+{
+    // The geometry of proxies is only known to appleseed.
+    needDelete = FALSE;
+    return &m_render_mesh;
+}
+
+int AppleseedProxyObj::get_flags() const
+{
+    return 0;
+}
+
+asf::auto_release_ptr<asr::Object> AppleseedProxyObj::create_object(
+    asr::Project&       project,
+    asr::Assembly&      assembly,
+    const char*         name,
+    const TimeValue     t)
+{
+    const MCHAR* filepath = m_pblock->GetStr(ParamIdFilePath, t);
+    if (filepath == nullptr || filepath[0] == L'\0')
+    {
+        RENDERER_LOG_WARNING("proxy object \"%s\" does not reference any mesh file.", name);
+        return asf::auto_release_ptr<asr::Object>();
+    }
+
+    return asf::auto_release_ptr<asr::Object>(
+        read_mesh_file(project.search_paths(), name, wide_to_utf8(filepath)));
+}
+
+void AppleseedProxyObj::update_preview()
+{
+    m_bbox.Init();
+    m_points.clear();
+
+    const MCHAR* filepath = m_pblock->GetStr(ParamIdFilePath);
+    if (filepath == nullptr || filepath[0] == L'\0')
+        return;
+
+    // The mesh file is streamed through a builder that only keeps the displayed vertices,
+    // rather than read into mesh objects along with its faces, normals and texture coordinates.
+    const std::string mesh_filepath = wide_to_utf8(filepath);
+    PreviewMeshBuilder builder(m_bbox, m_points);
+
+    try
+    {
+        asf::GenericMeshFileReader reader(mesh_filepath.c_str());
+        reader.read(builder);
+    }
+    catch (const asf::Exception& e)
+    {
+        RENDERER_LOG_ERROR("failed to read mesh file %s: %s", mesh_filepath.c_str(), e.what());
+        m_bbox.Init();
+        m_points.clear();
+    }
+}
+
+void AppleseedProxyObj::draw(GraphicsWindow* gw)
+{
+    if (m_pblock->GetInt(ParamIdDisplayMode) == DisplayModePointCloud && !m_points.empty())
+    {
+        gw->startMarkers();
+        for (auto& p : m_points)
+            gw->marker(&p, POINT_MRKR);
+        gw->endMarkers();
+    }
+    else
+    {
+        Box3 box;
+        GetLocalBoundBox(0, nullptr, nullptr, box);
+
+        // Corner i of a Box3 has coordinates taken from the max corner for each bit set in i
+        // (bit 0 for x, bit 1 for y, bit 2 for z), so edges join corners differing by one bit.
+        static const int Edges[12][2] =
+        {
+            { 0, 1 }, { 2, 3 }, { 4, 5 }, { 6, 7 },
+            { 0, 2 }, { 1, 3 }, { 4, 6 }, { 5, 7 },
+            { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 }
+        };
+
+        gw->startSegments();
+        for (const auto& edge : Edges)
+        {
+            Point3 segment[2] = { box[edge[0]], box[edge[1]] };
+            gw->segment(segment, 1);
+        }
+        gw->endSegments();
+    }
+}
+
+
+//
+// AppleseedProxyObjClassDesc class implementation.
+//
+
+int AppleseedProxyObjClassDesc::IsPublic()
+{
+    return TRUE;
+}
+
+void* AppleseedProxyObjClassDesc::Create(BOOL loading)
+{
+    return new AppleseedProxyObj();
+}
+
+const MCHAR* AppleseedProxyObjClassDesc::ClassName()
+{
+    // Name that appears in the Create panel.
+    return L"appleseed Proxy";
+}
+
+SClass_ID AppleseedProxyObjClassDesc::SuperClassID()
+{
+    return GEOMOBJECT_CLASS_ID;
+}
+
+Class_ID AppleseedProxyObjClassDesc::ClassID()
+{
+    return AppleseedProxyObj::get_class_id();
+}
+
+const MCHAR* AppleseedProxyObjClassDesc::Category()
+{
+    return L"appleseed";
+}
+
+const MCHAR* AppleseedProxyObjClassDesc::InternalName()
+{
+    // Parsable name used by MAXScript.
+    return L"appleseedProxy";
+}
+
+HINSTANCE AppleseedProxyObjClassDesc::HInstance()
+{
+    return g_module;
+}
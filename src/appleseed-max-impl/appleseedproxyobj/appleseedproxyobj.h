@@ -0,0 +1,165 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2015-2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+// appleseed-max-common headers.
+#include "appleseed-max-common/iappleseedgeometricobject.h"
+
+// Build options header.
+#include "foundation/core/buildoptions.h"
+
+// appleseed.foundation headers.
+#include "foundation/utility/autoreleaseptr.h"
+
+// 3ds Max headers.
+#include "appleseed-max-common/_beginmaxheaders.h"
+#include <box3.h>
+#include <iparamb2.h>
+#include <maxtypes.h>
+#include <mesh.h>
+#include <object.h>
+#include <point3.h>
+#include <ref.h>
+#include <strbasic.h>
+#include <strclass.h>
+#include "appleseed-max-common/_endmaxheaders.h"
+
+// Standard headers.
+#include <vector>
+
+// Forward declarations.
+class GraphicsWindow;
+
+//
+// A proxy object referencing a mesh file (.binarymesh or .obj) that is loaded by appleseed
+// at render time, bypassing 3ds Max's Mesh. Only a bounding box or a subset of the vertices
+// of the mesh is displayed in the viewports.
+//
+
+class AppleseedProxyObj
+  : public GeomObject
+  , public IAppleseedGeometricObject
+{
+  public:
+    static Class_ID get_class_id();
+
+    // Constructor.
+    AppleseedProxyObj();
+
+    // Animatable methods.
+    void DeleteThis() override;
+    void GetClassName(TSTR& s) override;
+    SClass_ID SuperClassID() override;
+    Class_ID ClassID() override;
+    void BeginEditParams(IObjParam* ip, ULONG flags, Animatable* prev = nullptr) override;
+    void EndEditParams(IObjParam* ip, ULONG flags, Animatable* next = nullptr) override;
+    int NumSubs() override;
+    Animatable* SubAnim(int i) override;
+    TSTR SubAnimName(int i) override;
+    int SubNumToRefNum(int subNum) override;
+    int NumParamBlocks() override;
+    IParamBlock2* GetParamBlock(int i) override;
+    IParamBlock2* GetParamBlockByID(BlockID id) override;
+    BaseInterface* GetInterface(Interface_ID id) override;
+
+    // ReferenceMaker methods.
+    int NumRefs() override;
+    RefTargetHandle GetReference(int i) override;
+    void SetReference(int i, RefTargetHandle rtarg) override;
+    RefResult NotifyRefChanged(
+        const Interval&     changeInt,
+        RefTargetHandle     hTarget,
+        PartID&             partID,
+        RefMessage          message,
+        BOOL                propagate) override;
+    IOResult Save(ISave* isave) override;
+    IOResult Load(ILoad* iload) override;
+
+    // ReferenceTarget methods.
+    RefTargetHandle Clone(RemapDir& remap) override;
+
+    // BaseObject methods.
+    CreateMouseCallBack* GetCreateMouseCallBack() override;
+    const MCHAR* GetObjectName() override;
+    bool RequiresSupportForLegacyDisplayMode() const override;
+    int Display(TimeValue t, INode* inode, ViewExp* vpt, int flags) override;
+    int HitTest(TimeValue t, INode* inode, int type, int crossing, int flags, IPoint2* p, ViewExp* vpt) override;
+    void GetWorldBoundBox(TimeValue t, INode* inode, ViewExp* vpt, Box3& box) override;
+    void GetLocalBoundBox(TimeValue t, INode* inode, ViewExp* vpt, Box3& box) override;
+
+    // Object methods.
+    ObjectState Eval(TimeValue t) override;
+    Interval ObjectValidity(TimeValue t) override;
+    void InitNodeName(TSTR& s) override;
+    int CanConvertToType(Class_ID obtype) override;
+    void GetDeformBBox(TimeValue t, Box3& box, Matrix3* tm = nullptr, BOOL useSel = FALSE) override;
+
+    // GeomObject methods.
+    Mesh* GetRenderMesh(TimeValue t, INode* inode, View& view, BOOL& needDelete) override;
+
+    // IAppleseedGeometricObject methods.
+    int get_flags() const override;
+    foundation::auto_release_ptr<renderer::Object> create_object(
+        renderer::Project&  project,
+        renderer::Assembly& assembly,
+        const char*         name,
+        const TimeValue     t) override;
+
+  private:
+    IParamBlock2*           m_pblock;
+    Box3                    m_bbox;             // bounding box of the mesh file, in object space
+    std::vector<Point3>     m_points;           // subset of the vertices of the mesh file, for display
+    Mesh                    m_render_mesh;      // empty mesh returned to other renderers
+
+    // Read the mesh file and update the bounding box and the points used for display.
+    void update_preview();
+
+    void draw(GraphicsWindow* gw);
+};
+
+
+//
+// AppleseedProxyObj class descriptor.
+//
+
+class AppleseedProxyObjClassDesc
+  : public ClassDesc2
+{
+  public:
+    int IsPublic() override;
+    void* Create(BOOL loading) override;
+    const MCHAR* ClassName() override;
+    SClass_ID SuperClassID() override;
+    Class_ID ClassID() override;
+    const MCHAR* Category() override;
+    const MCHAR* InternalName() override;
+    HINSTANCE HInstance() override;
+};
+
+extern AppleseedProxyObjClassDesc g_appleseed_proxyobj_classdesc;
@@ -0,0 +1,28 @@
+//{{NO_DEPENDENCIES}}
+// Microsoft Visual C++ generated include file.
+// Used by appleseedproxyobj.rc
+//
+#define IDD_FORMVIEW_PARAMS                         15000
+#define IDS_FORMVIEW_PARAMS_TITLE                   15001
+
+#define IDC_STATIC_FILEPATH                         15010
+#define IDC_BUTTON_FILEPATH                         15011
+#define IDS_FILEPATH                                15012
+#define IDS_FILEPATH_CAPTION                        15013
+#define IDS_FILEPATH_TYPES                          15014
+
+#define IDC_STATIC_DISPLAY                          15020
+#define IDC_RADIO_DISPLAY_BBOX                      15021
+#define IDC_RADIO_DISPLAY_POINTS                    15022
+#define IDS_DISPLAY                                 15023
+
+// Next default values for new objects
+// 
+#ifdef APSTUDIO_INVOKED
+#ifndef APSTUDIO_READONLY_SYMBOLS
+#define _APS_NEXT_RESOURCE_VALUE        104
+#define _APS_NEXT_COMMAND_VALUE         40001
+#define _APS_NEXT_CONTROL_VALUE         1006
+#define _APS_NEXT_SYMED_VALUE           101
+#endif
+#endif
@@ -33,11 +33,15 @@
 #include "appleseedinteractive/appleseedinteractive.h"
 #include "appleseedrenderelement/appleseedrenderelement.h"
 #include "appleseedrenderer/appleseedrendererparamdlg.h"
+#include "appleseedrenderer/backgroundwriter.h"
 #include "appleseedrenderer/datachunks.h"
 #include "appleseedrenderer/dialoglogtarget.h"
+#include "appleseedrenderer/materialpreviewcache.h"
 #include "appleseedrenderer/projectbuilder.h"
+#include "appleseedrenderer/projectwriter.h"
 #include "appleseedrenderer/renderercontroller.h"
 #include "appleseedrenderer/tilecallback.h"
+#include "appleseedrenderer/tilestreamer.h"
 #include "main.h"
 #include "resource.h"
 #include "utilities.h"
@@ -47,7 +51,9 @@
 #include "foundation/core/buildoptions.h"
 
 // appleseed.renderer headers.
+#include "renderer/api/aov.h"
 #include "renderer/api/frame.h"
+#include "renderer/api/log.h"
 #include "renderer/api/project.h"
 #include "renderer/api/rendering.h"
 
@@ -59,6 +65,10 @@
 #include "foundation/utility/autoreleaseptr.h"
 #include "foundation/utility/kvpair.h"
 #include "foundation/utility/searchpaths.h"
+#include "foundation/utility/string.h"
+
+// Boost headers.
+#include "boost/filesystem.hpp"
 
 // 3ds Max headers.
 #include "appleseed-max-common/_beginmaxheaders.h"
@@ -75,11 +85,15 @@
 #include <clocale>
 #include <cstddef>
 #include <cstdint>
+#include <iomanip>
 #include <limits>
+#include <memory>
+#include <sstream>
 #include <string>
 
 namespace asf = foundation;
 namespace asr = renderer;
+namespace bf = boost::filesystem;
 
 namespace
 {
@@ -119,11 +133,14 @@ namespace
         ParamIdBackgroundAlphaValue                     = 15,
         ParamIdNoiseSeed                                = 76,
         ParamIdEnablePerFrameNoiseSeedVariation         = 77,
+        ParamIdTimeLimit                                = 90,
+        ParamIdTargetSamplesPerPixel                    = 91,
 
         ParamIdLightingAlgorithm                        = 52,
         ParamIdForceDefaultLightsOff                    = 13,
         ParamIdLightSamplingAlgorithm                   = 78,
         ParamIdEnableLightImportanceSampling            = 79,
+        ParamIdEnvMapBakeWidth                          = 86,
 
         ParamIdEnableGI                                 = 8,
         ParamIdEnableCaustics                           = 10,
@@ -185,6 +202,13 @@ namespace
         ParamIdEnableLowPriority                        = 20,
         ParamIdEnableEmbree                             = 24,
         ParamIdTextureCacheSize                         = 53,
+        ParamIdEnableTextureConversion                  = 84,
+        ParamIdTextureConversionPath                    = 85,
+        ParamIdOptimizeMeshes                           = 87,
+        ParamIdStreamTilesToDisk                        = 88,
+        ParamIdEnableCheckpoints                        = 89,
+        ParamIdInteractiveMaxFPS                        = 92,
+        ParamIdEnableNavigationMode                     = 93,
         
         ParamIdEnableOverrideMaterial                   = 80,
         ParamIdOverrideMaterial                         = 81,
@@ -381,6 +405,14 @@ void AppleseedRendererPBlockAccessor::Get(
         v.i = static_cast<int>(settings.m_enable_noise_seed);
         break;
 
+      case ParamIdTimeLimit:
+        v.i = settings.m_time_limit;
+        break;
+
+      case ParamIdTargetSamplesPerPixel:
+        v.i = settings.m_target_samples_per_pixel;
+        break;
+
       //
       // Adaptive Tile Renderer.
       //
@@ -437,6 +469,10 @@ void AppleseedRendererPBlockAccessor::Get(
         v.i = static_cast<int>(settings.m_enable_light_importance_sampling);
         break;
 
+      case ParamIdEnvMapBakeWidth:
+        v.i = settings.m_envmap_bake_width;
+        break;
+
       //
       // Path Tracer.
       //
@@ -677,6 +713,30 @@ void AppleseedRendererPBlockAccessor::Get(
         v.i = static_cast<int>(settings.m_texture_cache_size);
         break;
 
+      case ParamIdEnableTextureConversion:
+        v.i = static_cast<int>(settings.m_enable_texture_conversion);
+        break;
+
+      case ParamIdOptimizeMeshes:
+        v.i = static_cast<int>(settings.m_optimize_meshes);
+        break;
+
+      case ParamIdStreamTilesToDisk:
+        v.i = static_cast<int>(settings.m_stream_tiles_to_disk);
+        break;
+
+      case ParamIdEnableCheckpoints:
+        v.i = static_cast<int>(settings.m_enable_checkpoints);
+        break;
+
+      case ParamIdInteractiveMaxFPS:
+        v.i = settings.m_interactive_max_fps;
+        break;
+
+      case ParamIdEnableNavigationMode:
+        v.i = static_cast<int>(settings.m_enable_navigation_mode);
+        break;
+
       default:
         break;
     }
@@ -766,6 +826,14 @@ void AppleseedRendererPBlockAccessor::Set(
         settings.m_enable_noise_seed = v.i > 0;
         break;
 
+      case ParamIdTimeLimit:
+        settings.m_time_limit = v.i;
+        break;
+
+      case ParamIdTargetSamplesPerPixel:
+        settings.m_target_samples_per_pixel = v.i;
+        break;
+
       //
       // Adaptive Tile Renderer.
       //
@@ -822,6 +890,10 @@ void AppleseedRendererPBlockAccessor::Set(
         settings.m_enable_light_importance_sampling = v.i > 0;
         break;
 
+      case ParamIdEnvMapBakeWidth:
+        settings.m_envmap_bake_width = v.i;
+        break;
+
       //
       // Pathtracer.
       //
@@ -1066,9 +1138,41 @@ void AppleseedRendererPBlockAccessor::Set(
         settings.m_texture_cache_size = v.i;
         break;
 
+      case ParamIdEnableTextureConversion:
+        settings.m_enable_texture_conversion = v.i > 0;
+        break;
+
+      case ParamIdTextureConversionPath:
+        settings.m_texture_conversion_path = v.s;
+        break;
+
+      case ParamIdOptimizeMeshes:
+        settings.m_optimize_meshes = v.i > 0;
+        break;
+
+      case ParamIdStreamTilesToDisk:
+        settings.m_stream_tiles_to_disk = v.i > 0;
+        break;
+
+      case ParamIdEnableCheckpoints:
+        settings.m_enable_checkpoints = v.i > 0;
+        break;
+
+      case ParamIdInteractiveMaxFPS:
+        settings.m_interactive_max_fps = v.i;
+        break;
+
+      case ParamIdEnableNavigationMode:
+        settings.m_enable_navigation_mode = v.i > 0;
+        break;
+
       default:
         break;
     }
+
+    // Let a running ActiveShade session pick up the new settings.
+    if (renderer->m_interactive_renderer != nullptr)
+        renderer->m_interactive_renderer->update_renderer_settings(settings);
 }
 
 AppleseedRendererClassDesc g_appleseed_renderer_classdesc;
@@ -1306,6 +1410,20 @@ ParamBlockDesc2 g_param_block_desc(
         p_accessor, &g_pblock_accessor,
     p_end,
 
+    ParamIdTimeLimit, L"time_limit", TYPE_INT, P_TRANSIENT, 0,
+        p_ui, ParamMapIdImageSampling, TYPE_SPINNER, EDITTYPE_INT, IDC_TEXT_TIME_LIMIT, IDC_SPINNER_TIME_LIMIT, SPIN_AUTOSCALE,
+        p_default, 0,
+        p_range, 0, 1000000,
+        p_accessor, &g_pblock_accessor,
+    p_end,
+
+    ParamIdTargetSamplesPerPixel, L"target_samples_per_pixel", TYPE_INT, P_TRANSIENT, 0,
+        p_ui, ParamMapIdImageSampling, TYPE_SPINNER, EDITTYPE_INT, IDC_TEXT_TARGET_SAMPLES, IDC_SPINNER_TARGET_SAMPLES, SPIN_AUTOSCALE,
+        p_default, 0,
+        p_range, 0, 1000000,
+        p_accessor, &g_pblock_accessor,
+    p_end,
+
     // --- Parameters specifications for Lighting rollup ---
 
     ParamIdLightingAlgorithm, L"lighting_algorithm", TYPE_INT, P_TRANSIENT, 0,
@@ -1334,6 +1452,13 @@ ParamBlockDesc2 g_param_block_desc(
         p_accessor, &g_pblock_accessor,
      p_end,
 
+    ParamIdEnvMapBakeWidth, L"envmap_bake_width", TYPE_INT, P_TRANSIENT, 0,
+        p_ui, ParamMapIdLighting, TYPE_SPINNER, EDITTYPE_INT, IDC_TEXT_ENVMAP_BAKE_WIDTH, IDC_SPINNER_ENVMAP_BAKE_WIDTH, SPIN_AUTOSCALE,
+        p_default, 2048,
+        p_range, 64, 16384,
+        p_accessor, &g_pblock_accessor,
+    p_end,
+
     // --- Parameters specifications for Path Tracer rollup ---
 
     ParamIdEnableGI, L"enable_global_illumination", TYPE_BOOL, P_TRANSIENT, 0,
@@ -1727,6 +1852,49 @@ ParamBlockDesc2 g_param_block_desc(
         p_accessor, &g_pblock_accessor,
     p_end,
 
+    ParamIdEnableTextureConversion, L"enable_texture_conversion", TYPE_BOOL, P_TRANSIENT, 0,
+        p_ui, ParamMapIdSystem, TYPE_SINGLECHEKBOX, IDC_CHECK_TEXTURE_CONVERSION,
+        p_default, FALSE,
+        p_enable_ctrls, 1, ParamIdTextureConversionPath,
+        p_accessor, &g_pblock_accessor,
+    p_end,
+
+    ParamIdTextureConversionPath, L"texture_conversion_path", TYPE_STRING, P_TRANSIENT, 0,
+        p_ui, ParamMapIdSystem, TYPE_EDITBOX, IDC_TEXT_TEXTURE_CONVERSION_PATH,
+        p_accessor, &g_pblock_accessor,
+    p_end,
+
+    ParamIdOptimizeMeshes, L"optimize_meshes", TYPE_BOOL, P_TRANSIENT, 0,
+        p_ui, ParamMapIdSystem, TYPE_SINGLECHEKBOX, IDC_CHECK_OPTIMIZE_MESHES,
+        p_default, FALSE,
+        p_accessor, &g_pblock_accessor,
+    p_end,
+
+    ParamIdStreamTilesToDisk, L"stream_tiles_to_disk", TYPE_BOOL, P_TRANSIENT, 0,
+        p_ui, ParamMapIdSystem, TYPE_SINGLECHEKBOX, IDC_CHECK_STREAM_TILES_TO_DISK,
+        p_default, FALSE,
+        p_accessor, &g_pblock_accessor,
+    p_end,
+
+    ParamIdEnableCheckpoints, L"enable_checkpoints", TYPE_BOOL, P_TRANSIENT, 0,
+        p_ui, ParamMapIdSystem, TYPE_SINGLECHEKBOX, IDC_CHECK_ENABLE_CHECKPOINTS,
+        p_default, FALSE,
+        p_accessor, &g_pblock_accessor,
+    p_end,
+
+    ParamIdInteractiveMaxFPS, L"interactive_max_fps", TYPE_INT, P_TRANSIENT, 0,
+        p_ui, ParamMapIdSystem, TYPE_SPINNER, EDITTYPE_INT, IDC_TEXT_INTERACTIVE_MAX_FPS, IDC_SPINNER_INTERACTIVE_MAX_FPS, SPIN_AUTOSCALE,
+        p_default, 10,
+        p_range, 1, 60,
+        p_accessor, &g_pblock_accessor,
+    p_end,
+
+    ParamIdEnableNavigationMode, L"enable_navigation_mode", TYPE_BOOL, P_TRANSIENT, 0,
+        p_ui, ParamMapIdSystem, TYPE_SINGLECHEKBOX, IDC_CHECK_NAVIGATION_MODE,
+        p_default, TRUE,
+        p_accessor, &g_pblock_accessor,
+    p_end,
+
     p_end
 );
 
@@ -1962,124 +2130,139 @@ int AppleseedRenderer::Open(
 
 namespace
 {
-    void get_view_params_from_view_node(
-        ViewParams&             view_params,
-        INode*                  view_node,
-        const TimeValue         time)
+    // Let the frame save a checkpoint at the end of each pass, and resume from the checkpoint
+    // of a previous render if the project did not change since then. Checkpoints are named
+    // after a hash of the project, computed by the project writer if the project is written.
+    // Return the path of the checkpoint file, or an empty path.
+    std::wstring setup_checkpoint(
+        asr::Project&           project,
+        const RendererSettings& settings,
+        ProjectWriter*          project_writer)
     {
-        const ObjectState& os = view_node->EvalWorldState(time);
-        switch (os.obj->SuperClassID())
+        if (settings.m_passes < 2)
         {
-          case CAMERA_CLASS_ID:
-            {
-                CameraObject* cam = static_cast<CameraObject*>(os.obj);
+            RENDERER_LOG_WARNING("checkpoints are only saved when rendering more than one pass.");
+            return std::wstring();
+        }
 
-                Interval validity_interval;
-                validity_interval.SetInfinite();
+        if (settings.m_use_max_procedural_maps)
+        {
+            RENDERER_LOG_WARNING("checkpoints are not supported when using 3ds Max procedural maps.");
+            return std::wstring();
+        }
 
-                Matrix3 cam_to_world = view_node->GetObjTMAfterWSM(time, &validity_interval);
-                cam_to_world.NoScale();
+        std::wstring directory = GetCOREInterface()->GetDir(APP_TEMP_DIR);
+        directory += L"\\appleseed\\checkpoints";
 
-                view_params.affineTM = Inverse(cam_to_world);
+        try
+        {
+            bf::create_directories(directory);
+        }
+        catch (const bf::filesystem_error& e)
+        {
+            RENDERER_LOG_ERROR("failed to create checkpoint directory, error = %s.", e.what());
+            return std::wstring();
+        }
 
-                CameraState cam_state;
-                cam->EvalCameraState(time, validity_interval, &cam_state);
+        const std::uint64_t hash =
+            project_writer != nullptr
+                ? project_writer->compute_hash()
+                : compute_project_hash(project);
+        if (hash == 0)
+            return std::wstring();
 
-                view_params.projType = PROJ_PERSPECTIVE;
-                view_params.fov = cam_state.fov;
+        const std::wstring checkpoint_path =
+            directory + L"\\" + utf8_to_wide(asf::to_string(hash)) + L".exr";
+        const std::string checkpoint_filepath = wide_to_utf8(checkpoint_path);
 
-                if (cam_state.manualClip)
-                {
-                    view_params.hither = cam_state.hither;
-                    view_params.yon = cam_state.yon;
-                }
-                else
-                {
-                    view_params.hither = 0.001f;
-                    view_params.yon = 1.0e38f;
-                }
-            }
-            break;
-
-          case LIGHT_CLASS_ID:
-            {
-                DbgAssert(!"Not implemented yet.");
-            }
-            break;
-
-          default:
-            DbgAssert(!"Unexpected super class ID for camera.");
-        }
-    }
+        asr::ParamArray params;
+        params.insert("checkpoint_create_filename", checkpoint_filepath);
 
-    class RenderBeginProc
-      : public RefEnumProc
-    {
-      public:
-        explicit RenderBeginProc(const TimeValue time)
-          : m_time(time)
+        if (bf::exists(checkpoint_path))
         {
+            params.insert("checkpoint_resume_filename", checkpoint_filepath);
+            RENDERER_LOG_INFO("resuming render from checkpoint %s.", checkpoint_filepath.c_str());
         }
 
-        int proc(ReferenceMaker* rm) override
-        {
-            rm->RenderBegin(m_time);
-            return REF_ENUM_CONTINUE;
-        }
+        recreate_frame(project, params);
 
-      private:
-        const TimeValue m_time;
-    };
+        return checkpoint_path;
+    }
 
-    class RenderEndProc
-      : public RefEnumProc
+    // Streamed tiles are written next to the render output, or in 3ds Max's temporary directory.
+    std::string get_tile_stream_path_prefix(const TimeValue time)
     {
-      public:
-        explicit RenderEndProc(const TimeValue time)
-          : m_time(time)
+        std::wstring path;
+
+        if (GetCOREInterface()->GetRendSaveFile())
         {
+            path = GetCOREInterface()->GetRendFileBI().Name();
+
+            const size_t dot = path.find_last_of(L'.');
+            const size_t separator = path.find_last_of(L"\\/");
+            if (dot != std::wstring::npos && (separator == std::wstring::npos || dot > separator))
+                path.erase(dot);
         }
 
-        int proc(ReferenceMaker* rm) override
+        if (path.empty())
         {
-            rm->RenderEnd(m_time);
-            return REF_ENUM_CONTINUE;
+            path = GetCOREInterface()->GetDir(APP_TEMP_DIR);
+            path += L"\\appleseed";
         }
 
-      private:
-        const TimeValue m_time;
-    };
+        std::wstringstream sstr;
+        sstr << path << L'.' << std::setw(4) << std::setfill(L'0') << time / GetTicksPerFrame();
+        return wide_to_utf8(sstr.str());
+    }
 
-    void render_begin(
-        std::vector<INode*>&    nodes,
-        const TimeValue         time)
+    std::uint64_t get_image_memory_size(const asf::Image& image)
     {
-        RenderBeginProc proc(time);
-        proc.BeginEnumeration();
-
-        for (auto node : nodes)
-            node->EnumRefHierarchy(proc);
-
-        proc.EndEnumeration();
+        const asf::CanvasProperties& props = image.properties();
+        return static_cast<std::uint64_t>(props.m_pixel_count) * props.m_pixel_size;
     }
 
-    void render_end(
-        std::vector<INode*>&    nodes,
-        const TimeValue         time)
+    // Report the memory held by the images of a frame before rendering allocates anything else.
+    void report_frame_memory(const asr::Frame& frame)
     {
-        RenderEndProc proc(time);
-        proc.BeginEnumeration();
+        const std::uint64_t beauty_size = get_image_memory_size(frame.image());
 
-        for (auto node : nodes)
-            node->EnumRefHierarchy(proc);
+        std::uint64_t aov_size = 0;
+        size_t aov_count = 0;
+        for (const asr::AOV& aov : frame.aovs())
+        {
+            aov_size += get_image_memory_size(aov.get_image());
+            ++aov_count;
+        }
 
-        proc.EndEnumeration();
+        const std::uint64_t total_size = beauty_size + aov_size;
+
+        RENDERER_LOG_INFO(
+            "frame memory:\n"
+            "  beauty           %s\n"
+            "  aovs             %s (%s aov%s)\n"
+            "  total            %s",
+            asf::pretty_size(beauty_size).c_str(),
+            asf::pretty_size(aov_size).c_str(),
+            asf::pretty_uint(aov_count).c_str(),
+            aov_count > 1 ? "s" : "",
+            asf::pretty_size(total_size).c_str());
+
+        const std::uint64_t physical_memory_size = asf::System::get_total_physical_memory_size();
+        if (total_size > physical_memory_size / 2)
+        {
+            RENDERER_LOG_WARNING(
+                "frame and aov images use more than half of the physical memory (%s); "
+                "consider lowering the resolution or removing render elements.",
+                asf::pretty_size(physical_memory_size).c_str());
+        }
     }
 
     asr::IRendererController::Status render(
         asr::Project&           project,
         const RendererSettings& settings,
         Bitmap*                 bitmap,
+        const AOVBitmapMap&     aov_bitmaps,
+        TileStreamer*           tile_streamer,
         RendProgressCallback*   progress_cb)
     {
         // Number of rendered tiles, shared counter accessed atomically.
@@ -2092,10 +2275,11 @@ namespace
         RendererController renderer_controller(
             progress_cb,
             &rendered_tile_count,
-            total_tile_count);
+            total_tile_count,
+            settings);
 
         // Create the tile callback.
-        TileCallback tile_callback(bitmap, &rendered_tile_count);
+        TileCallback tile_callback(bitmap, &rendered_tile_count, aov_bitmaps, tile_streamer);
 
         // Create the master renderer.
         asf::SearchPaths search_paths;
@@ -2152,6 +2336,8 @@ int AppleseedRenderer::Render(
         renderer_settings.m_dl_light_samples = 1;
         renderer_settings.m_dl_low_light_threshold = 0.0f;  // low light clamping disabled
         renderer_settings.m_ibl_env_samples = 1;
+        renderer_settings.m_time_limit = 0;                 // no render budget
+        renderer_settings.m_target_samples_per_pixel = 0;
 
         if (renderer_settings.m_rendering_threads == 0)
             renderer_settings.m_rendering_threads = -1;     // keep one logical core free for UI tasks
@@ -2189,55 +2375,96 @@ int AppleseedRenderer::Render(
     if (progress_cb)
         progress_cb->SetTitle(L"Building Project...");
 
-    MaterialMap material_map;
-    ObjectMap object_map;
-    ObjectInstanceMap object_inst_map;
-    AssemblyMap assembly_map;
-    AssemblyInstanceMap assembly_inst_map;
-    asf::auto_release_ptr<asr::Project> project(
-        build_project(
-            m_entities,
-            m_default_lights,
-            m_view_node,
-            m_view_params,
-            m_rend_params,
-            frame_rend_params,
-            renderer_settings,
-            bitmap,
-            time,
-            progress_cb,
-            object_map,
-            object_inst_map,
-            material_map,
-            assembly_map,
-            assembly_inst_map));
-
     if (m_rend_params.inMtlEdit)
     {
+        // Preview scenes are kept between swatches, only their materials are replaced.
+        asr::Project& project =
+            g_material_preview_cache.get_project(
+                m_entities,
+                m_default_lights,
+                m_view_params,
+                m_rend_params,
+                frame_rend_params,
+                renderer_settings,
+                bitmap,
+                time,
+                progress_cb);
+
         // Write the project to disk, useful to debug material previews.
-        // asr::ProjectFileWriter::write(project.ref(), "appleseed-max-material-editor.appleseed");
+        // asr::ProjectFileWriter::write(project, "appleseed-max-material-editor.appleseed");
 
-        // Render the project.
-        if (progress_cb)
-            progress_cb->SetTitle(L"Rendering...");
-        render(project.ref(), m_settings, bitmap, progress_cb);
+        // Render the project, unless it was rendered before.
+        if (!g_material_preview_cache.read_render(bitmap))
+        {
+            if (progress_cb)
+                progress_cb->SetTitle(L"Rendering...");
+
+            const auto render_status =
+                render(project, renderer_settings, bitmap, AOVBitmapMap(), nullptr, progress_cb);
+
+            if (render_status != asr::IRendererController::Status::AbortRendering)
+                g_material_preview_cache.write_render();
+        }
     }
     else
     {
-        // Write the project to disk.
-        if (!m_settings.m_use_max_procedural_maps)
+        MaterialMap material_map;
+        ObjectMap object_map;
+        ObjectInstanceMap object_inst_map;
+        AssemblyMap assembly_map;
+        AssemblyInstanceMap assembly_inst_map;
+        LightMap light_map;
+        asf::auto_release_ptr<asr::Project> project(
+            build_project(
+                m_entities,
+                m_default_lights,
+                m_view_node,
+                m_view_params,
+                m_rend_params,
+                frame_rend_params,
+                renderer_settings,
+                bitmap,
+                time,
+                progress_cb,
+                object_map,
+                object_inst_map,
+                material_map,
+                assembly_map,
+                assembly_inst_map,
+                light_map));
+
+        // The project is shared with the background writer, which writes it to disk while it is
+        // being rendered and writes its images once it is rendered, so that the next frame can be
+        // built and rendered in the meantime. The last owner of the project releases it.
+        const std::shared_ptr<asr::Project> shared_project(
+            project.release(),
+            [](asr::Project* p) { p->release(); });
+
+        // Naming the geometry files modifies the project, so it must happen before rendering.
+        std::shared_ptr<ProjectWriter> project_writer;
+        if (!m_settings.m_use_max_procedural_maps &&
+            (m_settings.m_output_mode == RendererSettings::OutputMode::SaveProjectOnly ||
+             m_settings.m_output_mode == RendererSettings::OutputMode::SaveProjectAndRender))
         {
-            if (m_settings.m_output_mode == RendererSettings::OutputMode::SaveProjectOnly ||
-                m_settings.m_output_mode == RendererSettings::OutputMode::SaveProjectAndRender)
-            {
-                if (progress_cb)
-                    progress_cb->SetTitle(L"Writing Project To Disk...");
-                asr::ProjectFileWriter::write(
-                    project.ref(),
+            if (progress_cb)
+                progress_cb->SetTitle(L"Writing Project To Disk...");
+
+            project_writer =
+                std::make_shared<ProjectWriter>(
+                    *shared_project,
                     wide_to_utf8(m_settings.m_project_file_path).c_str());
-            }
         }
 
+        // Checkpoints are set up before the project is written since they modify the project.
+        std::wstring checkpoint_path;
+        if (m_settings.m_enable_checkpoints &&
+            m_settings.m_output_mode != RendererSettings::OutputMode::SaveProjectOnly)
+            checkpoint_path = setup_checkpoint(*shared_project, m_settings, project_writer.get());
+
+        // Write the project to disk.
+        if (project_writer && m_settings.m_output_mode == RendererSettings::OutputMode::SaveProjectOnly)
+            project_writer->write();
+
         // Render the project.
         if (m_settings.m_output_mode == RendererSettings::OutputMode::RenderOnly ||
             m_settings.m_output_mode == RendererSettings::OutputMode::SaveProjectAndRender)
@@ -2254,6 +2481,25 @@ int AppleseedRenderer::Render(
 
             auto render_status = asr::IRendererController::Status::ContinueRendering;
 
+            // AOV tiles are streamed into the bitmaps of their render elements.
+            const AOVBitmapMap aov_bitmaps = get_render_element_bitmaps();
+
+            report_frame_memory(*shared_project->get_frame());
+
+            // Tiles can only be streamed once they are final, that is when there is a single pass.
+            std::unique_ptr<TileStreamer> tile_streamer;
+            if (m_settings.m_stream_tiles_to_disk)
+            {
+                if (m_settings.m_passes == 1)
+                {
+                    tile_streamer.reset(
+                        new TileStreamer(
+                            *shared_project->get_frame(),
+                            get_tile_stream_path_prefix(time)));
+                }
+                else RENDERER_LOG_WARNING("tiles are not streamed to disk when rendering more than one pass.");
+            }
+
             if (progress_cb)
                 progress_cb->SetTitle(L"Rendering...");
 
@@ -2262,19 +2508,53 @@ int AppleseedRenderer::Render(
                 asf::ProcessPriorityContext background_context(
                     asf::ProcessPriority::ProcessPriorityLow,
                     &asr::global_logger());
-                render_status = render(project.ref(), m_settings, bitmap, progress_cb);
+                render_status = render(*shared_project, m_settings, bitmap, aov_bitmaps, tile_streamer.get(), progress_cb);
             }
             else
             {
-                render_status = render(project.ref(), m_settings, bitmap, progress_cb);
+                render_status = render(*shared_project, m_settings, bitmap, aov_bitmaps, tile_streamer.get(), progress_cb);
             }
 
             if (render_status != asr::IRendererController::Status::AbortRendering &&
                 !GetCOREInterface14()->GetRendUseIterative())
-                project->get_frame()->write_main_and_aov_images();
+            {
+                g_background_writer.schedule(
+                    [shared_project]()
+                    {
+                        shared_project->get_frame()->write_main_and_aov_images();
+                    });
+            }
+
+            // Checkpoints of completed renders are no longer needed.
+            if (render_status != asr::IRendererController::Status::AbortRendering &&
+                !checkpoint_path.empty())
+            {
+                boost::system::error_code ec;
+                bf::remove(checkpoint_path, ec);
+            }
+
+            // Neither are the partial images of completed renders.
+            if (render_status != asr::IRendererController::Status::AbortRendering &&
+                tile_streamer != nullptr)
+                tile_streamer->remove_files();
 
             BroadcastNotification(NOTIFY_POST_RENDERFRAME, &render_context);
         }
+
+        // Handling asset files updates texture paths that the renderer reads, so the project is
+        // only written once it is rendered, while the next frame is being built.
+        if (project_writer && m_settings.m_output_mode == RendererSettings::OutputMode::SaveProjectAndRender)
+        {
+            g_background_writer.schedule(
+                [shared_project, project_writer]()
+                {
+                    project_writer->write();
+                });
+        }
+
+        // Entities wrapping 3ds Max procedural maps must be destroyed from the main thread.
+        if (m_settings.m_use_max_procedural_maps)
+            g_background_writer.wait();
     }
 
     if (progress_cb)
@@ -515,6 +515,20 @@ namespace
                     }
                     break;
 
+                  case IDC_BUTTON_BROWSE_TEXTURE_CONVERSION_PATH:
+                    {
+                        MCHAR dir[MAX_PATH] = L"";
+                        GetCOREInterface()->ChooseDirectory(hwnd, L"Choose Texture Cache Directory", dir);
+                        if (dir[0] != L'\0')
+                        {
+                            map->GetParamBlock()->SetValueByName(L"texture_conversion_path", dir, 0);
+                            ICustEdit* conversion_path = GetICustEdit(GetDlgItem(hwnd, IDC_TEXT_TEXTURE_CONVERSION_PATH));
+                            conversion_path->SetText(dir);
+                            ReleaseICustEdit(conversion_path);
+                        }
+                    }
+                    break;
+
                   default:
                     return FALSE;
                 }
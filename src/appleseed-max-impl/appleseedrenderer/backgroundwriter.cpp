@@ -0,0 +1,141 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2015-2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Interface header.
+#include "backgroundwriter.h"
+
+// appleseed.renderer headers.
+#include "renderer/api/log.h"
+
+// Standard headers.
+#include <clocale>
+#include <exception>
+#include <utility>
+
+BackgroundWriter g_background_writer(2, 2);
+
+BackgroundWriter::BackgroundWriter(
+    const size_t                    thread_count,
+    const size_t                    max_pending_task_count)
+  : m_thread_count(thread_count)
+  , m_max_pending_task_count(max_pending_task_count)
+  , m_running_task_count(0)
+  , m_stopping(false)
+{
+}
+
+BackgroundWriter::~BackgroundWriter()
+{
+    stop();
+}
+
+void BackgroundWriter::schedule(Task task)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+
+    if (m_threads.empty())
+    {
+        m_stopping = false;
+
+        for (size_t i = 0; i < m_thread_count; ++i)
+            m_threads.emplace_back(&BackgroundWriter::run_tasks, this);
+    }
+
+    while (m_pending_tasks.size() >= m_max_pending_task_count)
+        m_task_completed.wait(lock);
+
+    m_pending_tasks.push_back(std::move(task));
+    m_task_scheduled.notify_one();
+}
+
+void BackgroundWriter::wait()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+
+    while (!m_pending_tasks.empty() || m_running_task_count > 0)
+        m_task_completed.wait(lock);
+}
+
+void BackgroundWriter::stop()
+{
+    wait();
+
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        m_stopping = true;
+        m_task_scheduled.notify_all();
+    }
+
+    for (auto& thread : m_threads)
+        thread.join();
+
+    m_threads.clear();
+}
+
+void BackgroundWriter::run_tasks()
+{
+    // Renders only switch to the C locale while they run, but numbers must be written in that
+    // locale whenever the tasks run.
+    _configthreadlocale(_ENABLE_PER_THREAD_LOCALE);
+    std::setlocale(LC_ALL, "C");
+
+    boost::mutex::scoped_lock lock(m_mutex);
+
+    while (true)
+    {
+        while (m_pending_tasks.empty() && !m_stopping)
+            m_task_scheduled.wait(lock);
+
+        if (m_pending_tasks.empty())
+            break;
+
+        Task task = std::move(m_pending_tasks.front());
+        m_pending_tasks.pop_front();
+        ++m_running_task_count;
+        m_task_completed.notify_all();
+
+        lock.unlock();
+
+        try
+        {
+            task();
+        }
+        catch (const std::exception& e)
+        {
+            RENDERER_LOG_ERROR("background write failed: %s", e.what());
+        }
+
+        // Destroy the task, and what it holds, before reporting its completion.
+        task = Task();
+
+        lock.lock();
+
+        --m_running_task_count;
+        m_task_completed.notify_all();
+    }
+}
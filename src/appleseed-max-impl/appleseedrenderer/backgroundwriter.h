@@ -0,0 +1,91 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2015-2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+// Build options header.
+#include "foundation/core/buildoptions.h"
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+
+// Boost headers.
+#include "boost/thread/condition_variable.hpp"
+#include "boost/thread/locks.hpp"
+#include "boost/thread/mutex.hpp"
+
+// Standard headers.
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <vector>
+
+//
+// Run file writing tasks on background threads so that renders do not wait for the disk.
+// Scheduling a task blocks while too many tasks are pending: this bounds the memory held
+// by the tasks waiting to be run, such as the projects whose images remain to be written.
+//
+
+class BackgroundWriter
+  : public foundation::NonCopyable
+{
+  public:
+    typedef std::function<void ()> Task;
+
+    BackgroundWriter(
+        const size_t                thread_count,
+        const size_t                max_pending_task_count);
+
+    ~BackgroundWriter();
+
+    // Schedule a task. Threads are started on first use.
+    void schedule(Task task);
+
+    // Wait until all scheduled tasks are complete.
+    void wait();
+
+    // Wait until all scheduled tasks are complete, then stop the threads.
+    void stop();
+
+  private:
+    const size_t                    m_thread_count;
+    const size_t                    m_max_pending_task_count;
+    boost::mutex                    m_mutex;
+    boost::condition_variable       m_task_scheduled;   // a task was scheduled or the threads must stop
+    boost::condition_variable       m_task_completed;   // a task was started or completed
+    std::deque<Task>                m_pending_tasks;
+    size_t                          m_running_task_count;
+    bool                            m_stopping;
+    std::vector<std::thread>        m_threads;
+
+    void run_tasks();
+};
+
+// Writer shared by all final renders.
+extern BackgroundWriter g_background_writer;
@@ -0,0 +1,336 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2015-2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Interface header.
+#include "camerabatchrenderer.h"
+
+// appleseed-max headers.
+#include "appleseedrenderer/appleseedrenderer.h"
+#include "appleseedrenderer/maxsceneentities.h"
+#include "appleseedrenderer/projectbuilder.h"
+#include "appleseedrenderer/renderercontroller.h"
+#include "appleseedrenderer/renderersettings.h"
+#include "appleseedrenderer/scriptedrender.h"
+#include "appleseedrenderer/tilecallback.h"
+#include "utilities.h"
+
+// Build options header.
+#include "foundation/core/buildoptions.h"
+
+// appleseed.renderer headers.
+#include "renderer/api/camera.h"
+#include "renderer/api/frame.h"
+#include "renderer/api/light.h"
+#include "renderer/api/log.h"
+#include "renderer/api/project.h"
+#include "renderer/api/rendering.h"
+#include "renderer/api/scene.h"
+
+// appleseed.foundation headers.
+#include "foundation/math/transform.h"
+#include "foundation/platform/defaulttimers.h"
+#include "foundation/utility/autoreleaseptr.h"
+#include "foundation/utility/searchpaths.h"
+#include "foundation/utility/stopwatch.h"
+#include "foundation/utility/string.h"
+
+// 3ds Max headers.
+#include "appleseed-max-common/_beginmaxheaders.h"
+#include <maxapi.h>
+#include <render.h>
+#include "appleseed-max-common/_endmaxheaders.h"
+
+// Standard headers.
+#include <clocale>
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <string>
+
+namespace asf = foundation;
+namespace asr = renderer;
+
+namespace
+{
+    // Return the lights of an assembly that don't come from scene lights, i.e. default lights.
+    std::vector<asr::Light*> get_default_light_entities(
+        asr::Assembly&          assembly,
+        const LightMap&         light_map)
+    {
+        std::set<std::string> scene_light_names;
+        for (const auto& entry : light_map)
+            scene_light_names.insert(entry.second.m_light_name);
+
+        std::vector<asr::Light*> lights;
+        for (asr::Light& light : assembly.lights())
+        {
+            if (scene_light_names.count(light.get_name()) == 0)
+                lights.push_back(&light);
+        }
+
+        return lights;
+    }
+}
+
+bool render_camera_batch(
+    const RendererSettings&             settings,
+    const std::vector<INode*>&          camera_nodes,
+    const std::vector<std::wstring>&    filepaths)
+{
+    Interface* max_interface = GetCOREInterface();
+    const TimeValue time = max_interface->GetTime();
+
+    if (camera_nodes.empty() || camera_nodes.size() != filepaths.size())
+    {
+        RENDERER_LOG_ERROR("camera batch rendering requires one output file per camera.");
+        return false;
+    }
+
+    for (INode* camera_node : camera_nodes)
+    {
+        if (!is_camera_node(camera_node, time))
+        {
+            RENDERER_LOG_ERROR("camera batch rendering only accepts cameras.");
+            return false;
+        }
+    }
+
+    SuspendAll suspend(TRUE, TRUE, TRUE, TRUE, TRUE, TRUE);
+
+    std::string previous_locale(std::setlocale(LC_ALL, "C"));
+
+    asf::Stopwatch<asf::DefaultWallclockTimer> stopwatch;
+    stopwatch.start();
+
+    // All cameras are rendered at the resolution of the render settings.
+    const ScriptedRenderParams params(time);
+    Bitmap* bitmap = params.m_bitmap;
+
+    // Collect the entities we're interested in.
+    MaxSceneEntities entities;
+    MaxSceneEntityCollector collector(entities);
+    collector.collect(max_interface->GetRootNode());
+
+    render_begin(entities.m_objects, time);
+
+    // Build the project once, seen from the first camera.
+    ViewParams view_params;
+    get_view_params_from_view_node(view_params, camera_nodes.front(), time);
+
+    ScriptedRenderProgressCallback progress_cb;
+    MaterialMap material_map;
+    ObjectMap object_map;
+    ObjectInstanceMap object_inst_map;
+    AssemblyMap assembly_map;
+    AssemblyInstanceMap assembly_inst_map;
+    LightMap light_map;
+    asf::auto_release_ptr<asr::Project> project(
+        build_project(
+            entities,
+            get_default_lights(camera_nodes.front(), time),
+            camera_nodes.front(),
+            view_params,
+            params.m_rend_params,
+            params.m_frame_rend_params,
+            settings,
+            bitmap,
+            time,
+            &progress_cb,
+            object_map,
+            object_inst_map,
+            material_map,
+            assembly_map,
+            assembly_inst_map,
+            light_map));
+
+    // Default lights follow the camera.
+    const std::vector<asr::Light*> default_lights =
+        get_default_light_entities(
+            *project->get_scene()->assemblies().get_by_name("assembly"),
+            light_map);
+
+    // Number of rendered tiles, shared counter accessed atomically.
+    volatile std::uint32_t rendered_tile_count = 0;
+
+    const size_t total_tile_count =
+          static_cast<size_t>(settings.m_passes)
+        * project->get_frame()->image().properties().m_tile_count;
+
+    // Create the tile callback and the master renderer shared by all cameras.
+    TileCallback tile_callback(bitmap, &rendered_tile_count);
+    asf::SearchPaths search_paths;
+    std::unique_ptr<asr::MasterRenderer> renderer(
+        new asr::MasterRenderer(
+            project.ref(),
+            project->configurations().get_by_name("final")->get_inherited_parameters(),
+            search_paths,   // don't pass a temporary because MasterRenderer only holds a const reference to the search paths
+            &tile_callback));
+
+    bool success = true;
+    size_t rendered_camera_count = 0;
+
+    // Don't render a partially built scene.
+    const size_t camera_count = progress_cb.is_aborted() ? 0 : camera_nodes.size();
+
+    for (size_t i = 0; i < camera_count; ++i)
+    {
+        INode* camera_node = camera_nodes[i];
+
+        // Only replace the camera and move the default lights: objects are left untouched so
+        // that the acceleration structures of the scene are not rebuilt when rendering starts.
+        if (i > 0)
+        {
+            get_view_params_from_view_node(view_params, camera_node, time);
+            project->get_scene()->cameras().clear();
+            project->get_scene()->cameras().insert(
+                build_camera(camera_node, view_params, bitmap, settings, time));
+
+            const asf::Transformd transform =
+                asf::Transformd::from_local_to_parent(
+                    to_matrix4d(camera_node->GetObjTMAfterWSM(time)));
+            for (asr::Light* light : default_lights)
+                light->set_transform(transform);
+        }
+
+        rendered_tile_count = 0;
+
+        RendererController renderer_controller(
+            &progress_cb,
+            &rendered_tile_count,
+            total_tile_count,
+            settings);
+
+        asf::Stopwatch<asf::DefaultWallclockTimer> camera_stopwatch;
+        camera_stopwatch.start();
+
+        renderer->render(renderer_controller);
+
+        if (renderer_controller.get_status() == asr::IRendererController::Status::AbortRendering)
+        {
+            success = false;
+            break;
+        }
+
+        camera_stopwatch.measure();
+
+        const std::string camera_name = wide_to_utf8(camera_node->GetName());
+        const std::string filepath = wide_to_utf8(filepaths[i]);
+        if (project->get_frame()->write_main_image(filepath.c_str()))
+        {
+            RENDERER_LOG_INFO(
+                "rendered camera \"%s\" to %s in %s.",
+                camera_name.c_str(),
+                filepath.c_str(),
+                asf::pretty_time(camera_stopwatch.get_seconds()).c_str());
+            ++rendered_camera_count;
+        }
+        else
+        {
+            RENDERER_LOG_ERROR("failed to write the image of camera \"%s\" to %s.", camera_name.c_str(), filepath.c_str());
+            success = false;
+        }
+    }
+
+    if (progress_cb.is_aborted())
+    {
+        RENDERER_LOG_INFO("camera batch rendering aborted.");
+        success = false;
+    }
+
+    // Make sure the master renderer is deleted before the project.
+    renderer.reset();
+
+    render_end(entities.m_objects, time);
+
+    stopwatch.measure();
+
+    RENDERER_LOG_INFO(
+        "rendered %s camera%s out of %s in %s.",
+        asf::pretty_uint(rendered_camera_count).c_str(),
+        rendered_camera_count > 1 ? "s" : "",
+        asf::pretty_uint(camera_nodes.size()).c_str(),
+        asf::pretty_time(stopwatch.get_seconds()).c_str());
+
+    std::setlocale(LC_ALL, previous_locale.c_str());
+
+    return success;
+}
+
+
+//
+// AppleseedBatchRenderInterface class implementation.
+//
+
+static AppleseedBatchRenderInterface g_appleseed_batch_render_interface(
+    APPLESEED_BATCH_RENDER_INTERFACE_ID,
+    L"appleseedBatchRender",            // internal name used by MAXScript
+    0,                                  // ID of the localized description string
+    &g_appleseed_renderer_classdesc,    // class descriptor
+    FP_CORE,                            // flags
+
+    // --- Functions ---
+
+    AppleseedBatchRenderInterface::FunctionIdRenderCameras, L"renderCameras", 0, TYPE_bool, 0, 2,
+        L"cameras", 0, TYPE_INODE_TAB_BR,
+        L"filepaths", 0, TYPE_FILENAME_TAB_BR,
+
+    // --- The end ---
+    p_end);
+
+bool AppleseedBatchRenderInterface::render_cameras(
+    Tab<INode*>&                camera_nodes,
+    Tab<const MCHAR*>&          filepaths)
+{
+    std::vector<INode*> camera_node_vector;
+    for (int i = 0, e = camera_nodes.Count(); i < e; ++i)
+        camera_node_vector.push_back(camera_nodes[i]);
+
+    std::vector<std::wstring> filepath_vector;
+    for (int i = 0, e = filepaths.Count(); i < e; ++i)
+    {
+        if (filepaths[i] == nullptr || filepaths[i][0] == L'\0')
+            return false;
+        filepath_vector.push_back(filepaths[i]);
+    }
+
+    // Use the settings of the appleseed renderer if it is the current renderer.
+    Renderer* renderer = GetCOREInterface()->GetCurrentRenderer(false);
+    const bool is_appleseed_renderer =
+        renderer != nullptr && renderer->ClassID() == AppleseedRenderer::get_class_id();
+
+    if (is_appleseed_renderer)
+        static_cast<AppleseedRenderer*>(renderer)->create_log_window();
+
+    return
+        render_camera_batch(
+            is_appleseed_renderer
+                ? static_cast<AppleseedRenderer*>(renderer)->get_renderer_settings()
+                : RendererSettings::defaults(),
+            camera_node_vector,
+            filepath_vector);
+}
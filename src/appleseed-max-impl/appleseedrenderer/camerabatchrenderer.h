@@ -0,0 +1,84 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2015-2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+// Build options header.
+#include "foundation/core/buildoptions.h"
+
+// 3ds Max headers.
+#include "appleseed-max-common/_beginmaxheaders.h"
+#include <ifnpub.h>
+#include <maxtypes.h>
+#include "appleseed-max-common/_endmaxheaders.h"
+
+// Standard headers.
+#include <string>
+#include <vector>
+
+// Forward declarations.
+class INode;
+class RendererSettings;
+
+// Render the current frame of the scene from several cameras, writing the image seen from
+// the i-th camera to the i-th file path. The scene is only built once: between two cameras,
+// only the camera entity is replaced and the same master renderer is reused, so that the
+// acceleration structures of the scene are built for the first camera only.
+bool render_camera_batch(
+    const RendererSettings&             settings,
+    const std::vector<INode*>&          camera_nodes,
+    const std::vector<std::wstring>&    filepaths);
+
+
+//
+// MAXScript interface, exposed as appleseedBatchRender:
+//
+//   appleseedBatchRender.renderCameras <cameras array> <filepaths array>
+//
+
+#define APPLESEED_BATCH_RENDER_INTERFACE_ID Interface_ID(0x5e2a7c41, 0x3d9f6b18)
+
+class AppleseedBatchRenderInterface
+  : public FPStaticInterface
+{
+  public:
+    enum FunctionId
+    {
+        FunctionIdRenderCameras
+    };
+
+    DECLARE_DESCRIPTOR(AppleseedBatchRenderInterface)
+
+    BEGIN_FUNCTION_MAP
+        FN_2(FunctionIdRenderCameras, TYPE_bool, render_cameras, TYPE_INODE_TAB_BR, TYPE_FILENAME_TAB_BR)
+    END_FUNCTION_MAP
+
+    bool render_cameras(
+        Tab<INode*>&            camera_nodes,
+        Tab<const MCHAR*>&      filepaths);
+};
@@ -56,6 +56,8 @@ const USHORT ChunkSettingsAdaptiveTileMaxSamples                    = 0x1163;
 const USHORT ChunkSettingsAdaptiveTileNoiseThreshold                = 0x1164;
 const USHORT ChunkSettingsNoiseSeed                                 = 0x1165;
 const USHORT ChunkSettingsEnableNoiseSeed                           = 0x1166;
+const USHORT ChunkSettingsTimeLimit                                 = 0x1167;
+const USHORT ChunkSettingsTargetSamplesPerPixel                     = 0x1168;
 
 const USHORT ChunkSettingsPathtracer                                = 0x1200;
 const USHORT ChunkSettingsPathtracerGI                              = 0x1210;
@@ -102,6 +104,13 @@ const USHORT ChunkSettingsSystemEnableRenderStamp                   = 0x1440;
 const USHORT ChunkSettingsSystemRenderStampString                   = 0x1450;
 const USHORT ChunkSettingsSystemEnableEmbree                        = 0x1460;
 const USHORT ChunkSettingsSystemTextureCacheSize                    = 0x1470;
+const USHORT ChunkSettingsSystemEnableTextureConversion             = 0x1480;
+const USHORT ChunkSettingsSystemTextureConversionPath               = 0x1490;
+const USHORT ChunkSettingsSystemOptimizeMeshes                      = 0x14A0;
+const USHORT ChunkSettingsSystemStreamTilesToDisk                   = 0x14B0;
+const USHORT ChunkSettingsSystemEnableCheckpoints                   = 0x14C0;
+const USHORT ChunkSettingsSystemInteractiveMaxFPS                   = 0x14D0;
+const USHORT ChunkSettingsSystemEnableNavigationMode                = 0x14E0;
 
 const USHORT ChunkSettingsPostprocessing                            = 0x1500;
 const USHORT ChunkSettingsPostprocessingDenoiseMode                 = 0x1501;
@@ -116,6 +125,7 @@ const USHORT ChunkSettingsLighting                                  = 0x1600;
 const USHORT ChunkSettingsLightingAlgorithm                         = 0x1601;
 const USHORT ChunkSettingsLightSamplingAlgorithm                    = 0x1602;
 const USHORT ChunkSettingsEnableLightImportanceSampling             = 0x1610;
+const USHORT ChunkSettingsLightingEnvMapBakeWidth                   = 0x1620;
 const USHORT ChunkSettingsLightingForceOffDefaultLights             = 0x1270;
 
 const USHORT ChunkSettingsSPPM                                      = 0x1700;
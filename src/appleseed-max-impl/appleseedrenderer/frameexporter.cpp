@@ -0,0 +1,432 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2015-2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Interface header.
+#include "frameexporter.h"
+
+// appleseed-max headers.
+#include "appleseedrenderer/appleseedrenderer.h"
+#include "appleseedrenderer/maxsceneentities.h"
+#include "appleseedrenderer/projectbuilder.h"
+#include "appleseedrenderer/projectwriter.h"
+#include "appleseedrenderer/renderersettings.h"
+#include "appleseedrenderer/scriptedrender.h"
+#include "appleseedscatterobj/appleseedscatterobj.h"
+#include "utilities.h"
+
+// Build options header.
+#include "foundation/core/buildoptions.h"
+
+// appleseed.renderer headers.
+#include "renderer/api/camera.h"
+#include "renderer/api/frame.h"
+#include "renderer/api/log.h"
+#include "renderer/api/project.h"
+#include "renderer/api/scene.h"
+
+// appleseed.foundation headers.
+#include "foundation/platform/defaulttimers.h"
+#include "foundation/utility/autoreleaseptr.h"
+#include "foundation/utility/stopwatch.h"
+#include "foundation/utility/string.h"
+
+// Boost headers.
+#include "boost/filesystem.hpp"
+
+// 3ds Max headers.
+#include "appleseed-max-common/_beginmaxheaders.h"
+#include <interval.h>
+#include <maxapi.h>
+#include <object.h>
+#include <render.h>
+#include "appleseed-max-common/_endmaxheaders.h"
+
+// Standard headers.
+#include <clocale>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <vector>
+
+namespace asf = foundation;
+namespace asr = renderer;
+namespace bf = boost::filesystem;
+
+namespace
+{
+    // Interval over which the transform and the object of a node are both valid.
+    Interval get_node_validity(INode* node, const TimeValue time)
+    {
+        Interval validity = FOREVER;
+        node->GetObjTMAfterWSM(time, &validity);
+        validity &= node->EvalWorldState(time).obj->ObjectValidity(time);
+        return validity;
+    }
+
+    Interval get_transform_validity(INode* node, const TimeValue time)
+    {
+        Interval validity = FOREVER;
+        node->GetObjTMAfterWSM(time, &validity);
+        return validity;
+    }
+
+    Interval get_geometry_validity(INode* node, const TimeValue time)
+    {
+        return node->EvalWorldState(time).obj->ObjectValidity(time);
+    }
+
+    std::wstring make_frame_filepath(const std::wstring& filepath, const int frame)
+    {
+        const bf::path path(filepath);
+
+        std::wstringstream sstr;
+        sstr << path.stem().wstring() << L'.' << std::setw(4) << std::setfill(L'0') << frame;
+        sstr << path.extension().wstring();
+
+        return (path.parent_path() / sstr.str()).wstring();
+    }
+
+    //
+    // Animated objects. Nodes referencing the same object share the appleseed objects
+    // created for it, so geometry changes are tracked per object.
+    //
+
+    struct AnimatedObject
+    {
+        std::vector<INode*>     m_nodes;
+        Interval                m_geometry_validity;
+        std::vector<Interval>   m_transform_validities;     // one per node
+    };
+
+    typedef std::map<Object*, AnimatedObject> AnimatedObjectMap;
+
+    void remove_assembly_instance(
+        asr::Assembly&          assembly,
+        INode*                  node,
+        AssemblyInstanceMap&    assembly_inst_map)
+    {
+        const auto it = assembly_inst_map.find(wide_to_utf8(node->GetName()));
+        if (it != assembly_inst_map.end())
+        {
+            assembly.assembly_instances().remove(it->second);
+            assembly_inst_map.erase(it);
+        }
+    }
+}
+
+bool export_frame_sequence(
+    const RendererSettings&     settings,
+    const std::wstring&         filepath,
+    INode*                      camera_node,
+    const int                   first_frame,
+    const int                   last_frame)
+{
+    if (!is_camera_node(camera_node, first_frame * GetTicksPerFrame()))
+    {
+        RENDERER_LOG_ERROR("frame sequence export requires a camera.");
+        return false;
+    }
+
+    SuspendAll suspend(TRUE, TRUE, TRUE, TRUE, TRUE, TRUE);
+
+    std::string previous_locale(std::setlocale(LC_ALL, "C"));
+
+    asf::Stopwatch<asf::DefaultWallclockTimer> stopwatch;
+    stopwatch.start();
+
+    Interface* max_interface = GetCOREInterface();
+    const TimeValue first_time = first_frame * GetTicksPerFrame();
+
+    // The bitmap only defines the resolution of the frame.
+    const ScriptedRenderParams params(first_time);
+    const RendParams& rend_params = params.m_rend_params;
+    Bitmap* bitmap = params.m_bitmap;
+
+    // Collect the entities we're interested in.
+    MaxSceneEntities entities;
+    MaxSceneEntityCollector collector(entities);
+    collector.collect(max_interface->GetRootNode());
+
+    render_begin(entities.m_objects, first_time);
+
+    // Nodes that stay unchanged over the whole frame range go through the regular path.
+    // The others are instantiated through assembly instances so that they can be replaced
+    // without touching the rest of the scene. Scatter objects are always considered static.
+    const Interval frame_range(first_time, last_frame * GetTicksPerFrame());
+    MaxSceneEntities static_entities;
+    static_entities.m_lights = entities.m_lights;
+    AnimatedObjectMap animated_objects;
+    for (INode* node : entities.m_objects)
+    {
+        const Interval validity = get_node_validity(node, first_time);
+        if ((validity & frame_range) == frame_range ||
+            node->EvalWorldState(first_time).obj->ClassID() == AppleseedScatterObj::get_class_id())
+        {
+            static_entities.m_objects.push_back(node);
+        }
+        else
+        {
+            AnimatedObject& animated_object = animated_objects[node->GetObjectRef()];
+            animated_object.m_nodes.push_back(node);
+            animated_object.m_geometry_validity = get_geometry_validity(node, first_time);
+            animated_object.m_transform_validities.push_back(get_transform_validity(node, first_time));
+        }
+    }
+
+    // Build the project with the static part of the scene.
+    ViewParams view_params;
+    get_view_params_from_view_node(view_params, camera_node, first_time);
+
+    ScriptedRenderProgressCallback progress_cb;
+    MaterialMap material_map;
+    ObjectMap object_map;
+    ObjectInstanceMap object_inst_map;
+    AssemblyMap assembly_map;
+    AssemblyInstanceMap assembly_inst_map;
+    LightMap light_map;
+    asf::auto_release_ptr<asr::Project> project(
+        build_project(
+            static_entities,
+            std::vector<DefaultLight>(),
+            camera_node,
+            view_params,
+            rend_params,
+            params.m_frame_rend_params,
+            settings,
+            bitmap,
+            first_time,
+            &progress_cb,
+            object_map,
+            object_inst_map,
+            material_map,
+            assembly_map,
+            assembly_inst_map,
+            light_map));
+
+    asr::Assembly* assembly = project->get_scene()->assemblies().get_by_name("assembly");
+
+    // Add the animated part of the scene.
+    for (const auto& entry : animated_objects)
+    {
+        for (INode* node : entry.second.m_nodes)
+        {
+            add_object_as_assembly_instance(
+                project.ref(),
+                *assembly,
+                node,
+                RenderType::Default,
+                settings,
+                first_time,
+                material_map,
+                assembly_map,
+                assembly_inst_map);
+        }
+    }
+
+    std::vector<Interval> light_validities;
+    for (const auto& light_info : entities.m_lights)
+        light_validities.push_back(get_node_validity(light_info.m_light, first_time));
+
+    Interval camera_validity = get_node_validity(camera_node, first_time);
+
+    bool success = true;
+    size_t updated_node_count = 0;
+    const int frame_count = last_frame - first_frame + 1;
+    int exported_frame_count = 0;
+
+    for (int frame = first_frame; frame <= last_frame; ++frame)
+    {
+        // Stop if the user pressed Escape, including while the scene was built.
+        if (progress_cb.Progress(frame - first_frame, frame_count) == RENDPROG_ABORT)
+        {
+            RENDERER_LOG_INFO("frame sequence export aborted at frame %d.", frame);
+            success = false;
+            break;
+        }
+
+        const TimeValue time = frame * GetTicksPerFrame();
+
+        if (frame > first_frame)
+        {
+            // Replace animated objects whose geometry changed, or only the assembly instances
+            // of the nodes that moved. Assemblies of unchanged objects are reused.
+            for (auto& entry : animated_objects)
+            {
+                AnimatedObject& animated_object = entry.second;
+                const bool geometry_changed = !animated_object.m_geometry_validity.InInterval(time);
+
+                if (geometry_changed)
+                {
+                    for (INode* node : animated_object.m_nodes)
+                        remove_assembly_instance(*assembly, node, assembly_inst_map);
+
+                    const auto it = assembly_map.find(entry.first);
+                    if (it != assembly_map.end())
+                    {
+                        if (asr::Assembly* object_assembly = assembly->assemblies().get_by_name(it->second.c_str()))
+                            assembly->assemblies().remove(object_assembly);
+                        assembly_map.erase(it);
+                    }
+
+                    animated_object.m_geometry_validity = get_geometry_validity(animated_object.m_nodes.front(), time);
+                }
+
+                for (size_t i = 0, e = animated_object.m_nodes.size(); i < e; ++i)
+                {
+                    INode* node = animated_object.m_nodes[i];
+
+                    if (!geometry_changed && animated_object.m_transform_validities[i].InInterval(time))
+                        continue;
+
+                    if (!geometry_changed)
+                        remove_assembly_instance(*assembly, node, assembly_inst_map);
+
+                    add_object_as_assembly_instance(
+                        project.ref(),
+                        *assembly,
+                        node,
+                        RenderType::Default,
+                        settings,
+                        time,
+                        material_map,
+                        assembly_map,
+                        assembly_inst_map);
+
+                    animated_object.m_transform_validities[i] = get_transform_validity(node, time);
+                    ++updated_node_count;
+                }
+            }
+
+            // Replace the lights that changed.
+            for (size_t i = 0, e = entities.m_lights.size(); i < e; ++i)
+            {
+                const auto& light_info = entities.m_lights[i];
+                if (!light_info.m_enabled || light_validities[i].InInterval(time))
+                    continue;
+
+                update_light(*assembly, rend_params, light_info.m_light, time, light_map);
+                light_validities[i] = get_node_validity(light_info.m_light, time);
+                ++updated_node_count;
+            }
+
+            // Replace the camera if it changed.
+            if (!camera_validity.InInterval(time))
+            {
+                get_view_params_from_view_node(view_params, camera_node, time);
+                project->get_scene()->cameras().clear();
+                project->get_scene()->cameras().insert(
+                    build_camera(camera_node, view_params, bitmap, settings, time));
+                camera_validity = get_node_validity(camera_node, time);
+            }
+        }
+
+        // Vary the noise seed per frame as done when rendering.
+        if (settings.m_enable_noise_seed)
+            project->get_frame()->get_parameters().insert("noise_seed", settings.m_noise_seed + frame);
+
+        const std::wstring frame_filepath = make_frame_filepath(filepath, frame);
+        if (write_project(project.ref(), wide_to_utf8(frame_filepath).c_str()))
+        {
+            ++exported_frame_count;
+        }
+        else
+        {
+            RENDERER_LOG_ERROR("failed to export frame %d.", frame);
+            success = false;
+        }
+    }
+
+    render_end(entities.m_objects, first_time);
+
+    stopwatch.measure();
+
+    RENDERER_LOG_INFO(
+        "exported %s frame%s in %s (%s static node%s, %s node%s updated over the sequence).",
+        asf::pretty_uint(static_cast<size_t>(exported_frame_count)).c_str(),
+        exported_frame_count > 1 ? "s" : "",
+        asf::pretty_time(stopwatch.get_seconds()).c_str(),
+        asf::pretty_uint(static_entities.m_objects.size()).c_str(),
+        static_entities.m_objects.size() > 1 ? "s" : "",
+        asf::pretty_uint(updated_node_count).c_str(),
+        updated_node_count > 1 ? "s" : "");
+
+    std::setlocale(LC_ALL, previous_locale.c_str());
+
+    return success;
+}
+
+
+//
+// AppleseedExportInterface class implementation.
+//
+
+static AppleseedExportInterface g_appleseed_export_interface(
+    APPLESEED_EXPORT_INTERFACE_ID,
+    L"appleseedExport",                 // internal name used by MAXScript
+    0,                                  // ID of the localized description string
+    &g_appleseed_renderer_classdesc,    // class descriptor
+    FP_CORE,                            // flags
+
+    // --- Functions ---
+
+    AppleseedExportInterface::FunctionIdExportFrames, L"exportFrames", 0, TYPE_bool, 0, 4,
+        L"filepath", 0, TYPE_FILENAME,
+        L"camera", 0, TYPE_INODE,
+        L"firstFrame", 0, TYPE_INT,
+        L"lastFrame", 0, TYPE_INT,
+
+    // --- The end ---
+    p_end);
+
+bool AppleseedExportInterface::export_frames(
+    const MCHAR*                filepath,
+    INode*                      camera_node,
+    const int                   first_frame,
+    const int                   last_frame)
+{
+    if (filepath == nullptr || filepath[0] == L'\0' || first_frame > last_frame)
+        return false;
+
+    // Use the settings of the appleseed renderer if it is the current renderer.
+    Renderer* renderer = GetCOREInterface()->GetCurrentRenderer(false);
+    const bool is_appleseed_renderer =
+        renderer != nullptr && renderer->ClassID() == AppleseedRenderer::get_class_id();
+
+    if (is_appleseed_renderer)
+        static_cast<AppleseedRenderer*>(renderer)->create_log_window();
+
+    return
+        export_frame_sequence(
+            is_appleseed_renderer
+                ? static_cast<AppleseedRenderer*>(renderer)->get_renderer_settings()
+                : RendererSettings::defaults(),
+            filepath,
+            camera_node,
+            first_frame,
+            last_frame);
+}
@@ -0,0 +1,88 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2015-2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+// Build options header.
+#include "foundation/core/buildoptions.h"
+
+// 3ds Max headers.
+#include "appleseed-max-common/_beginmaxheaders.h"
+#include <ifnpub.h>
+#include <maxtypes.h>
+#include "appleseed-max-common/_endmaxheaders.h"
+
+// Standard headers.
+#include <string>
+
+// Forward declarations.
+class INode;
+class RendererSettings;
+
+// Export frames [first_frame, last_frame] of the current scene as one project file per frame,
+// seen from a given camera. The frame number is inserted before the extension of the file path.
+// The scene is only built once: for each subsequent frame, only the objects, lights and camera
+// whose validity interval ended are updated before the project file is written. Geometry files
+// are shared by all frames, see write_project().
+bool export_frame_sequence(
+    const RendererSettings&     settings,
+    const std::wstring&         filepath,
+    INode*                      camera_node,
+    const int                   first_frame,
+    const int                   last_frame);
+
+
+//
+// MAXScript interface, exposed as appleseedExport:
+//
+//   appleseedExport.exportFrames <filepath> <camera> <first frame> <last frame>
+//
+
+#define APPLESEED_EXPORT_INTERFACE_ID Interface_ID(0x4c1f7a32, 0x2b8e5d07)
+
+class AppleseedExportInterface
+  : public FPStaticInterface
+{
+  public:
+    enum FunctionId
+    {
+        FunctionIdExportFrames
+    };
+
+    DECLARE_DESCRIPTOR(AppleseedExportInterface)
+
+    BEGIN_FUNCTION_MAP
+        FN_4(FunctionIdExportFrames, TYPE_bool, export_frames, TYPE_FILENAME, TYPE_INODE, TYPE_INT, TYPE_INT)
+    END_FUNCTION_MAP
+
+    bool export_frames(
+        const MCHAR*            filepath,
+        INode*                  camera_node,
+        const int               first_frame,
+        const int               last_frame);
+};
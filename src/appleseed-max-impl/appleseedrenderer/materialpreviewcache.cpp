@@ -0,0 +1,904 @@
+
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2015-2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Interface header.
+#include "materialpreviewcache.h"
+
+// appleseed-max headers.
+#include "appleseedrenderer/maxsceneentities.h"
+#include "appleseedrenderer/projectbuilder.h"
+#include "appleseedrenderer/projectwriter.h"
+#include "appleseedrenderer/renderersettings.h"
+#include "appleseedrenderer/tilecallback.h"
+#include "utilities.h"
+#include "version.h"
+
+// appleseed.renderer headers.
+#include "renderer/api/bsdf.h"
+#include "renderer/api/bssrdf.h"
+#include "renderer/api/color.h"
+#include "renderer/api/edf.h"
+#include "renderer/api/environmentedf.h"
+#include "renderer/api/environmentshader.h"
+#include "renderer/api/frame.h"
+#include "renderer/api/log.h"
+#include "renderer/api/material.h"
+#include "renderer/api/object.h"
+#include "renderer/api/project.h"
+#include "renderer/api/scene.h"
+#include "renderer/api/shadergroup.h"
+#include "renderer/api/surfaceshader.h"
+#include "renderer/api/texture.h"
+#include "renderer/api/volume.h"
+
+// appleseed.foundation headers.
+#include "foundation/core/exceptions/exception.h"
+#include "foundation/image/canvasproperties.h"
+#include "foundation/image/color.h"
+#include "foundation/image/genericimagefilereader.h"
+#include "foundation/image/image.h"
+#include "foundation/utility/autoreleaseptr.h"
+#include "foundation/utility/containers/dictionary.h"
+#include "foundation/utility/siphash.h"
+#include "foundation/utility/string.h"
+#include "foundation/utility/uid.h"
+
+// Boost headers.
+#include "boost/filesystem.hpp"
+
+// 3ds Max headers.
+#include "appleseed-max-common/_beginmaxheaders.h"
+#include <assert1.h>
+#include <bitmap.h>
+#include <maxapi.h>
+#include <notify.h>
+#include <object.h>
+#include "appleseed-max-common/_endmaxheaders.h"
+
+// Standard headers.
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <list>
+#include <memory>
+#include <set>
+#include <string>
+
+namespace asf = foundation;
+namespace asr = renderer;
+namespace bf = boost::filesystem;
+
+MaterialPreviewCache g_material_preview_cache;
+
+
+//
+// MaterialPreviewCache class implementation.
+//
+
+namespace
+{
+    // The material editor has a few sample object types, each rendered at a few swatch sizes.
+    const size_t MaxPreviewSceneCount = 4;
+
+    // Everything a preview scene is built from, except materials.
+    struct PreviewSceneKey
+    {
+        std::vector<INode*>     m_nodes;
+        std::vector<Object*>    m_objects;
+        std::vector<Matrix3>    m_node_transforms;
+        std::vector<INode*>     m_lights;
+        std::vector<Matrix3>    m_default_light_transforms;
+        std::vector<Color>      m_default_light_colors;
+        Matrix3                 m_view_transform;
+        int                     m_projection_type;
+        float                   m_fov;
+        float                   m_zoom;
+        Texmap*                 m_env_map;
+        asf::Color3f            m_background;
+        int                     m_width;
+        int                     m_height;
+        float                   m_scale_multiplier;
+
+        PreviewSceneKey(
+            const MaxSceneEntities&             entities,
+            const std::vector<DefaultLight>&    default_lights,
+            const ViewParams&                   view_params,
+            const RendParams&                   rend_params,
+            const FrameRendParams&              frame_rend_params,
+            const RendererSettings&             settings,
+            Bitmap*                             bitmap,
+            const TimeValue                     time)
+          : m_view_transform(view_params.affineTM)
+          , m_projection_type(view_params.projType)
+          , m_fov(view_params.fov)
+          , m_zoom(view_params.zoom)
+          , m_env_map(rend_params.envMap)
+          , m_background(to_color3f(frame_rend_params.background))
+          , m_width(bitmap->Width())
+          , m_height(bitmap->Height())
+          , m_scale_multiplier(settings.m_scale_multiplier)
+        {
+            for (INode* node : entities.m_objects)
+            {
+                m_nodes.push_back(node);
+                m_objects.push_back(node->GetObjectRef());
+                m_node_transforms.push_back(node->GetObjTMAfterWSM(time));
+            }
+
+            for (const auto& light_info : entities.m_lights)
+                m_lights.push_back(light_info.m_light);
+
+            for (const auto& default_light : default_lights)
+            {
+                m_default_light_transforms.push_back(default_light.tm);
+                m_default_light_colors.push_back(default_light.ls.color * default_light.ls.intens);
+            }
+        }
+
+        bool operator==(const PreviewSceneKey& rhs) const
+        {
+            return
+                m_nodes == rhs.m_nodes &&
+                m_objects == rhs.m_objects &&
+                m_node_transforms == rhs.m_node_transforms &&
+                m_lights == rhs.m_lights &&
+                m_default_light_transforms == rhs.m_default_light_transforms &&
+                m_default_light_colors == rhs.m_default_light_colors &&
+                m_view_transform == rhs.m_view_transform &&
+                m_projection_type == rhs.m_projection_type &&
+                m_fov == rhs.m_fov &&
+                m_zoom == rhs.m_zoom &&
+                m_env_map == rhs.m_env_map &&
+                m_background == rhs.m_background &&
+                m_width == rhs.m_width &&
+                m_height == rhs.m_height &&
+                m_scale_multiplier == rhs.m_scale_multiplier;
+        }
+    };
+
+    struct PreviewScene
+    {
+        PreviewSceneKey                         m_key;
+        asf::auto_release_ptr<asr::Project>     m_project;
+        ObjectMap                               m_object_map;
+        ObjectInstanceMap                       m_object_inst_map;
+        MaterialMap                             m_material_map;
+        AssemblyMap                             m_assembly_map;
+        AssemblyInstanceMap                     m_assembly_inst_map;
+        LightMap                                m_light_map;
+        std::set<asf::UniqueID>                 m_scene_entity_uids;   // entities of the assembly not created by materials
+        std::uint64_t                           m_geometry_hash = 0;    // hash of the converted sample objects
+
+        explicit PreviewScene(const PreviewSceneKey& key)
+          : m_key(key)
+        {
+        }
+    };
+
+    template <typename EntityContainer>
+    void collect_entity_uids(
+        const EntityContainer&      entities,
+        std::set<asf::UniqueID>&    uids)
+    {
+        for (const auto& entity : entities)
+            uids.insert(entity.get_uid());
+    }
+
+    template <typename EntityContainer>
+    void remove_entities_not_in(
+        EntityContainer&                entities,
+        const std::set<asf::UniqueID>&  uids)
+    {
+        std::vector<decltype(&*entities.begin())> removed_entities;
+
+        for (auto& entity : entities)
+        {
+            if (uids.count(entity.get_uid()) == 0)
+                removed_entities.push_back(&entity);
+        }
+
+        for (auto entity : removed_entities)
+            entities.remove(entity);
+    }
+
+    // Materials and their plugins may create entities in any of these containers.
+    void collect_material_container_uids(
+        const asr::Assembly&        assembly,
+        std::set<asf::UniqueID>&    uids)
+    {
+        collect_entity_uids(assembly.colors(), uids);
+        collect_entity_uids(assembly.textures(), uids);
+        collect_entity_uids(assembly.texture_instances(), uids);
+        collect_entity_uids(assembly.shader_groups(), uids);
+        collect_entity_uids(assembly.bsdfs(), uids);
+        collect_entity_uids(assembly.bssrdfs(), uids);
+        collect_entity_uids(assembly.edfs(), uids);
+        collect_entity_uids(assembly.surface_shaders(), uids);
+        collect_entity_uids(assembly.volumes(), uids);
+        collect_entity_uids(assembly.materials(), uids);
+    }
+
+    void remove_material_entities(
+        asr::Assembly&                  assembly,
+        const std::set<asf::UniqueID>&  uids)
+    {
+        remove_entities_not_in(assembly.materials(), uids);
+        remove_entities_not_in(assembly.volumes(), uids);
+        remove_entities_not_in(assembly.surface_shaders(), uids);
+        remove_entities_not_in(assembly.edfs(), uids);
+        remove_entities_not_in(assembly.bssrdfs(), uids);
+        remove_entities_not_in(assembly.bsdfs(), uids);
+        remove_entities_not_in(assembly.shader_groups(), uids);
+        remove_entities_not_in(assembly.texture_instances(), uids);
+        remove_entities_not_in(assembly.textures(), uids);
+        remove_entities_not_in(assembly.colors(), uids);
+    }
+
+    //
+    // Render keys. Rendered swatches are looked up on disk by a hash of everything that affects
+    // them: the plugin version, the preview settings, the swatch size, the geometry of the
+    // sample objects and the material entities.
+    //
+
+    void append_dictionary(
+        const asf::Dictionary&      dictionary,
+        std::string&                key)
+    {
+        for (auto it = dictionary.strings().begin(), e = dictionary.strings().end(); it != e; ++it)
+        {
+            key += it.key();
+            key += '=';
+            key += it.value();
+            key += ';';
+        }
+
+        for (auto it = dictionary.dictionaries().begin(), e = dictionary.dictionaries().end(); it != e; ++it)
+        {
+            key += it.key();
+            key += '{';
+            append_dictionary(it.value(), key);
+            key += '}';
+        }
+    }
+
+    void append_matrix(
+        const Matrix3&              m,
+        std::string&                key)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            const Point3 row = m.GetRow(i);
+            key += asf::format("{0} {1} {2};", row.x, row.y, row.z);
+        }
+    }
+
+    // Sample objects are converted once per preview scene, so is their geometry hashed.
+    void append_geometry(
+        const asr::AssemblyContainer&   assemblies,
+        std::string&                    key)
+    {
+        const char* mesh_object_model = asr::MeshObjectFactory().get_model();
+
+        for (const auto& assembly : assemblies)
+        {
+            for (const auto& object : assembly.objects())
+            {
+                key += object.get_name();
+                key += ':';
+                key += object.get_model();
+                key += '{';
+                if (std::strcmp(object.get_model(), mesh_object_model) == 0)
+                    key += asf::to_string(compute_mesh_hash(static_cast<const asr::MeshObject&>(object)));
+                else append_dictionary(object.get_parameters(), key);
+                key += '}';
+            }
+
+            append_geometry(assembly.assemblies(), key);
+        }
+    }
+
+    std::uint64_t hash_geometry(const asr::Project& project)
+    {
+        std::string key;
+        append_geometry(project.get_scene()->assemblies(), key);
+        return asf::siphash24(key.c_str(), key.size());
+    }
+
+    template <typename EntityContainer>
+    void append_entities(
+        const EntityContainer&          entities,
+        const std::set<asf::UniqueID>&  excluded_uids,
+        std::string&                    key)
+    {
+        for (const auto& entity : entities)
+        {
+            if (excluded_uids.count(entity.get_uid()) > 0)
+                continue;
+
+            key += entity.get_name();
+            key += ':';
+            key += entity.get_model();
+            key += '{';
+            append_dictionary(entity.get_parameters(), key);
+            key += '}';
+        }
+    }
+
+    void append_colors(
+        const asr::ColorContainer&      colors,
+        const std::set<asf::UniqueID>&  excluded_uids,
+        std::string&                    key)
+    {
+        for (const auto& color : colors)
+        {
+            if (excluded_uids.count(color.get_uid()) > 0)
+                continue;
+
+            key += color.get_name();
+            key += '{';
+            append_dictionary(color.get_parameters(), key);
+            for (size_t i = 0, e = color.get_values().size(); i < e; ++i)
+                key += asf::format("{0} ", color.get_values()[i]);
+            key += '}';
+        }
+    }
+
+    void append_texture_instances(
+        const asr::TextureInstanceContainer&    texture_instances,
+        const std::set<asf::UniqueID>&          excluded_uids,
+        std::string&                            key)
+    {
+        for (const auto& texture_instance : texture_instances)
+        {
+            if (excluded_uids.count(texture_instance.get_uid()) > 0)
+                continue;
+
+            key += texture_instance.get_name();
+            key += ':';
+            key += texture_instance.get_texture_name();
+            key += '{';
+            append_dictionary(texture_instance.get_parameters(), key);
+            key += '}';
+        }
+    }
+
+    void append_shader_groups(
+        const asr::ShaderGroupContainer&    shader_groups,
+        const std::set<asf::UniqueID>&      excluded_uids,
+        std::string&                        key)
+    {
+        for (const auto& shader_group : shader_groups)
+        {
+            if (excluded_uids.count(shader_group.get_uid()) > 0)
+                continue;
+
+            key += shader_group.get_name();
+            key += '{';
+
+            for (const auto& shader : shader_group.shaders())
+            {
+                key += asf::format("{0} {1} {2}(", shader.get_type(), shader.get_shader(), shader.get_layer());
+                append_dictionary(shader.get_parameters(), key);
+                key += ')';
+            }
+
+            for (const auto& connection : shader_group.shader_connections())
+            {
+                key +=
+                    asf::format(
+                        "{0}.{1}->{2}.{3};",
+                        connection.get_src_layer(),
+                        connection.get_src_param(),
+                        connection.get_dst_layer(),
+                        connection.get_dst_param());
+            }
+
+            key += '}';
+        }
+    }
+
+    // Texture files may change on disk without any change to the project.
+    void append_texture_file_times(
+        const asr::TextureContainer&    textures,
+        std::string&                    key)
+    {
+        for (const auto& texture : textures)
+        {
+            const std::string filepath =
+                texture.get_parameters().get_optional<std::string>("filename", "");
+            if (filepath.empty())
+                continue;
+
+            boost::system::error_code ec;
+            const std::time_t time = bf::last_write_time(utf8_to_wide(filepath), ec);
+            if (!ec)
+                key += "|" + filepath + ":" + asf::to_string(time);
+        }
+    }
+
+    // Entities created by materials, and the few entities of the environment.
+    void append_material_entities(
+        const asr::BaseGroup&           base_group,
+        const std::set<asf::UniqueID>&  excluded_uids,
+        std::string&                    key)
+    {
+        append_colors(base_group.colors(), excluded_uids, key);
+        append_entities(base_group.textures(), excluded_uids, key);
+        append_texture_instances(base_group.texture_instances(), excluded_uids, key);
+        append_shader_groups(base_group.shader_groups(), excluded_uids, key);
+        append_texture_file_times(base_group.textures(), key);
+    }
+
+    // Directory in which rendered swatches are kept.
+    std::wstring get_render_directory()
+    {
+        std::wstring directory = GetCOREInterface()->GetDir(APP_TEMP_DIR);
+        directory += L"\\appleseed\\previews";
+        return directory;
+    }
+
+    // Keep at most this many bytes of rendered swatches on disk.
+    const std::uintmax_t MaxRenderDirectorySize = 64 * 1024 * 1024;
+
+    // Delete the least recently used swatches until the directory fits in its budget.
+    // Swatches are touched when read, so that their write time tells when they were last used.
+    void evict_renders(const bf::path& directory)
+    {
+        struct RenderFile
+        {
+            bf::path        m_path;
+            std::time_t     m_time;
+            std::uintmax_t  m_size;
+        };
+
+        std::vector<RenderFile> files;
+        std::uintmax_t total_size = 0;
+
+        boost::system::error_code ec;
+        for (bf::directory_iterator it(directory, ec), e; !ec && it != e; it.increment(ec))
+        {
+            const bf::path& path = it->path();
+            if (path.extension() != L".exr")
+                continue;
+
+            RenderFile file;
+            file.m_path = path;
+            file.m_time = bf::last_write_time(path, ec);
+            file.m_size = bf::file_size(path, ec);
+            if (ec)
+            {
+                ec.clear();
+                continue;
+            }
+
+            files.push_back(file);
+            total_size += file.m_size;
+        }
+
+        if (total_size <= MaxRenderDirectorySize)
+            return;
+
+        std::sort(
+            files.begin(),
+            files.end(),
+            [](const RenderFile& lhs, const RenderFile& rhs)
+            {
+                return lhs.m_time < rhs.m_time;
+            });
+
+        for (const RenderFile& file : files)
+        {
+            if (total_size <= MaxRenderDirectorySize)
+                break;
+
+            bf::remove(file.m_path, ec);
+            if (!ec)
+                total_size -= file.m_size;
+        }
+    }
+
+    void on_scene_reset(void* param, NotifyInfo* info)
+    {
+        // Preview scenes reference 3ds Max objects that are about to be deleted.
+        static_cast<MaterialPreviewCache*>(param)->clear();
+    }
+
+    const int SceneResetNotificationCodes[] =
+    {
+        NOTIFY_SYSTEM_PRE_RESET,
+        NOTIFY_SYSTEM_PRE_NEW,
+        NOTIFY_FILE_PRE_OPEN
+    };
+}
+
+struct MaterialPreviewCache::Impl
+{
+    // Most recently used scenes first.
+    std::list<std::unique_ptr<PreviewScene>>    m_scenes;
+    std::wstring                                m_render_path;      // empty if renders of the current preview are not kept
+    bool                                        m_registered = false;
+
+    static asr::Assembly& get_assembly(PreviewScene& scene)
+    {
+        asr::Assembly* assembly = scene.m_project->get_scene()->assemblies().get_by_name("assembly");
+        DbgAssert(assembly);
+        return *assembly;
+    }
+
+    static void add_objects(
+        PreviewScene&                       scene,
+        const MaxSceneEntities&             entities,
+        const RendererSettings&             settings,
+        const TimeValue                     time)
+    {
+        for (INode* node : entities.m_objects)
+        {
+            add_object(
+                *scene.m_project,
+                get_assembly(scene),
+                node,
+                RenderType::MaterialPreview,
+                settings,
+                time,
+                scene.m_object_map,
+                scene.m_object_inst_map,
+                scene.m_material_map,
+                scene.m_assembly_map,
+                scene.m_assembly_inst_map);
+        }
+    }
+
+    static std::unique_ptr<PreviewScene> build_scene(
+        const PreviewSceneKey&              key,
+        const MaxSceneEntities&             entities,
+        const std::vector<DefaultLight>&    default_lights,
+        const ViewParams&                   view_params,
+        const RendParams&                   rend_params,
+        const FrameRendParams&              frame_rend_params,
+        const RendererSettings&             settings,
+        Bitmap*                             bitmap,
+        const TimeValue                     time,
+        RendProgressCallback*               progress_cb)
+    {
+        std::unique_ptr<PreviewScene> scene(new PreviewScene(key));
+
+        // Build the scene without objects first, to tell apart the entities created by materials.
+        MaxSceneEntities scene_entities = entities;
+        scene_entities.m_objects.clear();
+        scene->m_project =
+            build_project(
+                scene_entities,
+                default_lights,
+                nullptr,
+                view_params,
+                rend_params,
+                frame_rend_params,
+                settings,
+                bitmap,
+                time,
+                progress_cb,
+                scene->m_object_map,
+                scene->m_object_inst_map,
+                scene->m_material_map,
+                scene->m_assembly_map,
+                scene->m_assembly_inst_map,
+                scene->m_light_map);
+        collect_material_container_uids(get_assembly(*scene), scene->m_scene_entity_uids);
+
+        add_objects(*scene, entities, settings, time);
+        scene->m_geometry_hash = hash_geometry(*scene->m_project);
+
+        return scene;
+    }
+
+    // Objects instantiated through assemblies keep their material mappings in their own
+    // assembly, which is not rebuilt when materials are replaced.
+    static bool can_replace_materials(const PreviewScene& scene)
+    {
+        return scene.m_assembly_map.empty() && scene.m_assembly_inst_map.empty();
+    }
+
+    static void replace_materials(
+        PreviewScene&                       scene,
+        const MaxSceneEntities&             entities,
+        const RendererSettings&             settings,
+        const TimeValue                     time)
+    {
+        asr::Assembly& assembly = get_assembly(scene);
+
+        // Object instances are recreated with the mappings of the new materials. The objects
+        // themselves remain in the object map and are not converted again.
+        assembly.object_instances().clear();
+        remove_material_entities(assembly, scene.m_scene_entity_uids);
+        scene.m_object_inst_map.clear();
+        scene.m_material_map.clear();
+
+        add_objects(scene, entities, settings, time);
+
+        assembly.bump_version_id();
+
+        // Settings only insert parameters: start again from the default configurations.
+        scene.m_project->configurations().clear();
+        scene.m_project->add_default_configurations();
+        settings.apply(*scene.m_project);
+    }
+
+    // Any change to the preview settings, the swatch size or the materials yields a new render path.
+    static std::wstring compute_render_path(const PreviewScene& scene)
+    {
+        const PreviewSceneKey& scene_key = scene.m_key;
+        const asr::Project& project = *scene.m_project;
+
+        // Swatches rendered by other versions of the plugin may differ.
+        std::string key = wide_to_utf8(PluginVersionString);
+        key += ';';
+
+        key += asf::format("geometry {0};", scene.m_geometry_hash);
+
+        for (size_t i = 0, e = scene_key.m_objects.size(); i < e; ++i)
+        {
+            const Class_ID class_id = scene_key.m_objects[i]->ClassID();
+            key += asf::format("object {0} {1}:", class_id.PartA(), class_id.PartB());
+            append_matrix(scene_key.m_node_transforms[i], key);
+        }
+
+        for (size_t i = 0, e = scene_key.m_default_light_transforms.size(); i < e; ++i)
+        {
+            const Color& color = scene_key.m_default_light_colors[i];
+            key += asf::format("light {0} {1} {2}:", color.r, color.g, color.b);
+            append_matrix(scene_key.m_default_light_transforms[i], key);
+        }
+
+        key += asf::format(
+            "view {0} {1} {2}:",
+            scene_key.m_projection_type,
+            scene_key.m_fov,
+            scene_key.m_zoom);
+        append_matrix(scene_key.m_view_transform, key);
+
+        key += asf::format(
+            "background {0} {1} {2};",
+            scene_key.m_background.r,
+            scene_key.m_background.g,
+            scene_key.m_background.b);
+
+        // Resolution, sampling and lighting settings.
+        append_dictionary(project.get_frame()->get_parameters(), key);
+        append_dictionary(project.configurations().get_by_name("final")->get_inherited_parameters(), key);
+
+        // Environment.
+        const asr::Scene& scene_entities = *project.get_scene();
+        const std::set<asf::UniqueID> no_uids;
+        append_entities(scene_entities.environment_edfs(), no_uids, key);
+        append_entities(scene_entities.environment_shaders(), no_uids, key);
+        append_material_entities(scene_entities, no_uids, key);
+
+        // Materials.
+        const asr::Assembly* assembly = project.get_scene()->assemblies().get_by_name("assembly");
+        DbgAssert(assembly);
+        append_material_entities(*assembly, scene.m_scene_entity_uids, key);
+        append_entities(assembly->bsdfs(), scene.m_scene_entity_uids, key);
+        append_entities(assembly->bssrdfs(), scene.m_scene_entity_uids, key);
+        append_entities(assembly->edfs(), scene.m_scene_entity_uids, key);
+        append_entities(assembly->surface_shaders(), scene.m_scene_entity_uids, key);
+        append_entities(assembly->volumes(), scene.m_scene_entity_uids, key);
+        append_entities(assembly->materials(), scene.m_scene_entity_uids, key);
+
+        // Material assignments.
+        for (const auto& object_instance : assembly->object_instances())
+        {
+            key += object_instance.get_name();
+            key += ':';
+            for (auto it = object_instance.get_front_material_mappings().begin(),
+                      e = object_instance.get_front_material_mappings().end(); it != e; ++it)
+                key += asf::format("{0}={1};", it.key(), it.value());
+            for (auto it = object_instance.get_back_material_mappings().begin(),
+                      e = object_instance.get_back_material_mappings().end(); it != e; ++it)
+                key += asf::format("{0}={1};", it.key(), it.value());
+        }
+
+        const std::uint64_t hash = asf::siphash24(key.c_str(), key.size());
+        return get_render_directory() + L"\\" + utf8_to_wide(asf::to_string(hash)) + L".exr";
+    }
+
+    asr::Project& get_current_project(const RendererSettings& settings)
+    {
+        const PreviewScene& scene = *m_scenes.front();
+
+        // 3ds Max procedural maps are not described by the entities that wrap them.
+        m_render_path.clear();
+        if (!settings.m_use_max_procedural_maps)
+            m_render_path = compute_render_path(scene);
+
+        return *scene.m_project;
+    }
+
+    void register_notifications(MaterialPreviewCache* cache)
+    {
+        if (m_registered)
+            return;
+
+        for (const int code : SceneResetNotificationCodes)
+            RegisterNotification(on_scene_reset, cache, code);
+
+        m_registered = true;
+    }
+
+    void unregister_notifications(MaterialPreviewCache* cache)
+    {
+        if (!m_registered)
+            return;
+
+        for (const int code : SceneResetNotificationCodes)
+            UnRegisterNotification(on_scene_reset, cache, code);
+
+        m_registered = false;
+    }
+};
+
+MaterialPreviewCache::MaterialPreviewCache()
+  : impl(new Impl())
+{
+}
+
+MaterialPreviewCache::~MaterialPreviewCache()
+{
+    delete impl;
+}
+
+asr::Project& MaterialPreviewCache::get_project(
+    const MaxSceneEntities&                 entities,
+    const std::vector<DefaultLight>&        default_lights,
+    const ViewParams&                       view_params,
+    const RendParams&                       rend_params,
+    const FrameRendParams&                  frame_rend_params,
+    const RendererSettings&                 settings,
+    Bitmap*                                 bitmap,
+    const TimeValue                         time,
+    RendProgressCallback*                   progress_cb)
+{
+    impl->register_notifications(this);
+
+    const PreviewSceneKey key(
+        entities,
+        default_lights,
+        view_params,
+        rend_params,
+        frame_rend_params,
+        settings,
+        bitmap,
+        time);
+
+    for (auto it = impl->m_scenes.begin(), e = impl->m_scenes.end(); it != e; ++it)
+    {
+        if ((*it)->m_key == key)
+        {
+            std::unique_ptr<PreviewScene> scene = std::move(*it);
+            impl->m_scenes.erase(it);
+
+            if (Impl::can_replace_materials(*scene))
+            {
+                Impl::replace_materials(*scene, entities, settings, time);
+                impl->m_scenes.push_front(std::move(scene));
+                return impl->get_current_project(settings);
+            }
+
+            break;
+        }
+    }
+
+    impl->m_scenes.push_front(
+        Impl::build_scene(
+            key,
+            entities,
+            default_lights,
+            view_params,
+            rend_params,
+            frame_rend_params,
+            settings,
+            bitmap,
+            time,
+            progress_cb));
+
+    while (impl->m_scenes.size() > MaxPreviewSceneCount)
+        impl->m_scenes.pop_back();
+
+    return impl->get_current_project(settings);
+}
+
+bool MaterialPreviewCache::read_render(Bitmap* bitmap)
+{
+    if (impl->m_render_path.empty() || !bf::exists(impl->m_render_path))
+        return false;
+
+    const std::string render_filepath = wide_to_utf8(impl->m_render_path);
+
+    try
+    {
+        asf::GenericImageFileReader reader;
+        std::unique_ptr<asf::Image> image(reader.read(render_filepath.c_str()));
+
+        const asf::CanvasProperties& props = image->properties();
+        if (props.m_canvas_width != static_cast<size_t>(bitmap->Width()) ||
+            props.m_canvas_height != static_cast<size_t>(bitmap->Height()) ||
+            props.m_channel_count != 4)
+            return false;
+
+        volatile std::uint32_t rendered_tile_count = 0;
+        TileCallback tile_callback(bitmap, &rendered_tile_count);
+        tile_callback.blit_image(*image);
+
+        // Mark the swatch as recently used so that it is evicted last.
+        boost::system::error_code ec;
+        bf::last_write_time(impl->m_render_path, std::time(nullptr), ec);
+
+        return true;
+    }
+    catch (const asf::Exception& e)
+    {
+        RENDERER_LOG_WARNING("failed to read material preview %s: %s.", render_filepath.c_str(), e.what());
+        return false;
+    }
+}
+
+void MaterialPreviewCache::write_render()
+{
+    if (impl->m_render_path.empty() || impl->m_scenes.empty())
+        return;
+
+    const bf::path render_path(impl->m_render_path);
+
+    boost::system::error_code ec;
+    bf::create_directories(render_path.parent_path(), ec);
+    if (ec)
+        return;
+
+    // Write to a temporary file first so that other 3ds Max sessions never read a partial file.
+    const bf::path temp_path = bf::path(render_path).replace_extension(L".tmp.exr");
+    const asr::Frame* frame = impl->m_scenes.front()->m_project->get_frame();
+    if (!frame->write_main_image(wide_to_utf8(temp_path.wstring()).c_str()))
+        return;
+
+    bf::rename(temp_path, render_path, ec);
+    if (ec)
+    {
+        bf::remove(temp_path, ec);
+        return;
+    }
+
+    evict_renders(render_path.parent_path());
+}
+
+void MaterialPreviewCache::clear()
+{
+    impl->m_scenes.clear();
+    impl->unregister_notifications(this);
+}
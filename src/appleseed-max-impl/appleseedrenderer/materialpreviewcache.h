@@ -0,0 +1,102 @@
+
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2015-2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+// Build options header.
+#include "foundation/core/buildoptions.h"
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+
+// 3ds Max headers.
+#include "appleseed-max-common/_beginmaxheaders.h"
+#include <maxtypes.h>
+#include <render.h>
+#include "appleseed-max-common/_endmaxheaders.h"
+
+// Standard headers.
+#include <vector>
+
+// Forward declarations.
+namespace renderer  { class Project; }
+class Bitmap;
+class FrameRendParams;
+class MaxSceneEntities;
+class RendererSettings;
+class RendParams;
+class ViewParams;
+
+//
+// Keep material editor preview scenes alive between swatch renders. Building a preview scene
+// loads plugins and converts the preview geometry, lights and environment; as long as these
+// are unchanged, a cached scene is reused and only its materials are replaced.
+//
+// Rendered swatches are also kept on disk, named after a hash of the preview settings and of
+// the materials, so that previews which did not change since an earlier session are not
+// rendered again. The least recently used swatches are deleted beyond a size budget.
+//
+
+class MaterialPreviewCache
+  : public foundation::NonCopyable
+{
+  public:
+    MaterialPreviewCache();
+
+    ~MaterialPreviewCache();
+
+    // Return a project rendering the materials currently assigned to the preview scene.
+    // The project remains owned by the cache and is valid until the next call.
+    renderer::Project& get_project(
+        const MaxSceneEntities&             entities,
+        const std::vector<DefaultLight>&    default_lights,
+        const ViewParams&                   view_params,
+        const RendParams&                   rend_params,
+        const FrameRendParams&              frame_rend_params,
+        const RendererSettings&             settings,
+        Bitmap*                             bitmap,
+        const TimeValue                     time,
+        RendProgressCallback*               progress_cb);
+
+    // Copy the image rendered earlier for the project returned by get_project() into a bitmap.
+    // Returns false if no image was rendered for an identical project.
+    bool read_render(Bitmap* bitmap);
+
+    // Keep the image rendered for the project returned by get_project() on disk.
+    void write_render();
+
+    // Release all preview scenes. Must be called from the main thread.
+    void clear();
+
+  private:
+    struct Impl;
+    Impl* impl;
+};
+
+extern MaterialPreviewCache g_material_preview_cache;
@@ -0,0 +1,590 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2015-2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Interface header.
+#include "meshoptimizer.h"
+
+// Build options header.
+#include "foundation/core/buildoptions.h"
+
+// appleseed.renderer headers.
+#include "renderer/api/log.h"
+#include "renderer/api/object.h"
+#include "renderer/api/scene.h"
+
+// appleseed.foundation headers.
+#include "foundation/math/vector.h"
+#include "foundation/platform/defaulttimers.h"
+#include "foundation/utility/autoreleaseptr.h"
+#include "foundation/utility/stopwatch.h"
+#include "foundation/utility/string.h"
+
+// Standard headers.
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace asf = foundation;
+namespace asr = renderer;
+
+namespace
+{
+    //
+    // Mesh data extracted from a mesh object.
+    //
+
+    struct MeshData
+    {
+        std::vector<asr::GVector3>  m_vertices;
+        std::vector<asr::GVector2>  m_tex_coords;
+        std::vector<asr::GVector3>  m_normals;
+        std::vector<asr::Triangle>  m_triangles;
+
+        size_t get_memory_size() const
+        {
+            return
+                m_vertices.size() * sizeof(asr::GVector3) +
+                m_tex_coords.size() * sizeof(asr::GVector2) +
+                m_normals.size() * sizeof(asr::GVector3) +
+                m_triangles.size() * sizeof(asr::Triangle);
+        }
+    };
+
+    MeshData read_mesh_data(const asr::MeshObject& object)
+    {
+        MeshData mesh;
+
+        mesh.m_vertices.reserve(object.get_vertex_count());
+        for (size_t i = 0, e = object.get_vertex_count(); i < e; ++i)
+            mesh.m_vertices.push_back(object.get_vertex(i));
+
+        mesh.m_tex_coords.reserve(object.get_tex_coords_count());
+        for (size_t i = 0, e = object.get_tex_coords_count(); i < e; ++i)
+            mesh.m_tex_coords.push_back(object.get_tex_coords(i));
+
+        mesh.m_normals.reserve(object.get_vertex_normal_count());
+        for (size_t i = 0, e = object.get_vertex_normal_count(); i < e; ++i)
+            mesh.m_normals.push_back(object.get_vertex_normal(i));
+
+        mesh.m_triangles.reserve(object.get_triangle_count());
+        for (size_t i = 0, e = object.get_triangle_count(); i < e; ++i)
+            mesh.m_triangles.push_back(object.get_triangle(i));
+
+        return mesh;
+    }
+
+    asf::auto_release_ptr<asr::MeshObject> create_mesh_object(
+        const asr::MeshObject&  source,
+        const MeshData&         mesh)
+    {
+        asf::auto_release_ptr<asr::MeshObject> object(
+            asr::MeshObjectFactory().create(source.get_name(), source.get_parameters()));
+
+        for (size_t i = 0, e = source.get_material_slot_count(); i < e; ++i)
+            object->push_material_slot(source.get_material_slot(i));
+
+        object->reserve_vertices(mesh.m_vertices.size());
+        for (const auto& v : mesh.m_vertices)
+            object->push_vertex(v);
+
+        object->reserve_tex_coords(mesh.m_tex_coords.size());
+        for (const auto& uv : mesh.m_tex_coords)
+            object->push_tex_coords(uv);
+
+        object->reserve_vertex_normals(mesh.m_normals.size());
+        for (const auto& n : mesh.m_normals)
+            object->push_vertex_normal(n);
+
+        object->reserve_triangles(mesh.m_triangles.size());
+        for (const auto& triangle : mesh.m_triangles)
+            object->push_triangle(triangle);
+
+        return object;
+    }
+
+    //
+    // Degenerate triangles removal.
+    //
+
+    bool is_degenerate(const asr::Triangle& triangle, const std::vector<asr::GVector3>& vertices)
+    {
+        if (triangle.m_v0 == triangle.m_v1 ||
+            triangle.m_v1 == triangle.m_v2 ||
+            triangle.m_v2 == triangle.m_v0)
+            return true;
+
+        const asr::GVector3& v0 = vertices[triangle.m_v0];
+        const asr::GVector3& v1 = vertices[triangle.m_v1];
+        const asr::GVector3& v2 = vertices[triangle.m_v2];
+
+        return asf::square_norm(asf::cross(v1 - v0, v2 - v0)) == asr::GScalar(0.0);
+    }
+
+    void remove_degenerate_triangles(MeshData& mesh)
+    {
+        mesh.m_triangles.erase(
+            std::remove_if(
+                mesh.m_triangles.begin(),
+                mesh.m_triangles.end(),
+                [&mesh](const asr::Triangle& triangle)
+                {
+                    return is_degenerate(triangle, mesh.m_vertices);
+                }),
+            mesh.m_triangles.end());
+    }
+
+    //
+    // Triangle reordering for vertex cache locality.
+    //
+    // Reference:
+    //
+    //   Linear-Speed Vertex Cache Optimisation, Tom Forsyth
+    //   https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html
+    //
+
+    const size_t VertexCacheSize = 32;
+    const size_t NoTriangle = ~size_t(0);
+
+    float compute_vertex_score(const int cache_position, const std::uint32_t remaining_triangle_count)
+    {
+        // Vertices not used by any remaining triangle will never be needed again.
+        if (remaining_triangle_count == 0)
+            return -1.0f;
+
+        float score = 0.0f;
+
+        if (cache_position >= 0)
+        {
+            if (cache_position < 3)
+            {
+                // The three vertices of the last triangle get a fixed score,
+                // regardless of their order, to not favor strips over fans.
+                score = 0.75f;
+            }
+            else
+            {
+                const float scale = 1.0f / (VertexCacheSize - 3);
+                score = std::pow(1.0f - (cache_position - 3) * scale, 1.5f);
+            }
+        }
+
+        // Favor vertices with few remaining triangles to get rid of them quickly.
+        score += 2.0f / std::sqrt(static_cast<float>(remaining_triangle_count));
+
+        return score;
+    }
+
+    void optimize_triangle_order(MeshData& mesh)
+    {
+        std::vector<asr::Triangle>& triangles = mesh.m_triangles;
+        const size_t vertex_count = mesh.m_vertices.size();
+        const size_t triangle_count = triangles.size();
+
+        // Count the triangles using each vertex.
+        std::vector<std::uint32_t> remaining_triangle_counts(vertex_count, 0);
+        for (const auto& triangle : triangles)
+        {
+            ++remaining_triangle_counts[triangle.m_v0];
+            ++remaining_triangle_counts[triangle.m_v1];
+            ++remaining_triangle_counts[triangle.m_v2];
+        }
+
+        // Build the list of triangles using each vertex. The triangles of vertex v are
+        // vertex_triangles[offsets[v]] to vertex_triangles[offsets[v] + remaining_triangle_counts[v] - 1].
+        std::vector<std::uint32_t> offsets(vertex_count + 1, 0);
+        for (size_t i = 0; i < vertex_count; ++i)
+            offsets[i + 1] = offsets[i] + remaining_triangle_counts[i];
+
+        std::vector<std::uint32_t> vertex_triangles(offsets[vertex_count]);
+        {
+            std::vector<std::uint32_t> ends(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < triangle_count; ++i)
+            {
+                const asr::Triangle& triangle = triangles[i];
+                vertex_triangles[ends[triangle.m_v0]++] = static_cast<std::uint32_t>(i);
+                vertex_triangles[ends[triangle.m_v1]++] = static_cast<std::uint32_t>(i);
+                vertex_triangles[ends[triangle.m_v2]++] = static_cast<std::uint32_t>(i);
+            }
+        }
+
+        // Compute initial vertex scores.
+        std::vector<int> cache_positions(vertex_count, -1);
+        std::vector<float> vertex_scores(vertex_count);
+        for (size_t i = 0; i < vertex_count; ++i)
+            vertex_scores[i] = compute_vertex_score(-1, remaining_triangle_counts[i]);
+
+        std::vector<std::uint8_t> emitted(triangle_count, 0);
+        std::vector<asr::Triangle> output;
+        output.reserve(triangle_count);
+
+        std::uint32_t cache[VertexCacheSize + 3];
+        size_t cache_size = 0;
+
+        size_t best_triangle = NoTriangle;
+        size_t next_unemitted_triangle = 0;
+
+        while (output.size() < triangle_count)
+        {
+            // When none of the triangles using cached vertices remains, resume with the next
+            // triangle in the original order rather than searching the whole mesh.
+            if (best_triangle == NoTriangle)
+            {
+                while (emitted[next_unemitted_triangle])
+                    ++next_unemitted_triangle;
+                best_triangle = next_unemitted_triangle;
+            }
+
+            const asr::Triangle& triangle = triangles[best_triangle];
+            emitted[best_triangle] = 1;
+            output.push_back(triangle);
+
+            const std::uint32_t triangle_vertices[3] = { triangle.m_v0, triangle.m_v1, triangle.m_v2 };
+
+            // Remove the triangle from the lists of triangles of its vertices.
+            for (const std::uint32_t v : triangle_vertices)
+            {
+                std::uint32_t* v_triangles = &vertex_triangles[offsets[v]];
+                const std::uint32_t count = remaining_triangle_counts[v];
+                for (std::uint32_t i = 0; i < count; ++i)
+                {
+                    if (v_triangles[i] == best_triangle)
+                    {
+                        v_triangles[i] = v_triangles[count - 1];
+                        break;
+                    }
+                }
+                --remaining_triangle_counts[v];
+            }
+
+            // Move the vertices of the triangle to the front of the cache.
+            std::uint32_t new_cache[VertexCacheSize + 3];
+            size_t new_cache_size = 0;
+            for (const std::uint32_t v : triangle_vertices)
+                new_cache[new_cache_size++] = v;
+            for (size_t i = 0; i < cache_size; ++i)
+            {
+                const std::uint32_t v = cache[i];
+                if (v != triangle_vertices[0] && v != triangle_vertices[1] && v != triangle_vertices[2])
+                    new_cache[new_cache_size++] = v;
+            }
+
+            // Update the scores of the vertices that were or still are in the cache,
+            // evicting the vertices that no longer fit in the cache.
+            for (size_t i = 0; i < new_cache_size; ++i)
+            {
+                const std::uint32_t v = new_cache[i];
+                cache_positions[v] = i < VertexCacheSize ? static_cast<int>(i) : -1;
+                vertex_scores[v] = compute_vertex_score(cache_positions[v], remaining_triangle_counts[v]);
+            }
+
+            // Pick the remaining triangle with the highest score among those using these vertices.
+            best_triangle = NoTriangle;
+            float best_score = -1.0f;
+            for (size_t i = 0; i < new_cache_size; ++i)
+            {
+                const std::uint32_t v = new_cache[i];
+                const std::uint32_t* v_triangles = &vertex_triangles[offsets[v]];
+                for (std::uint32_t j = 0, e = remaining_triangle_counts[v]; j < e; ++j)
+                {
+                    const std::uint32_t t = v_triangles[j];
+                    const asr::Triangle& candidate = triangles[t];
+                    const float score =
+                        vertex_scores[candidate.m_v0] +
+                        vertex_scores[candidate.m_v1] +
+                        vertex_scores[candidate.m_v2];
+                    if (best_score < score)
+                    {
+                        best_score = score;
+                        best_triangle = t;
+                    }
+                }
+            }
+
+            cache_size = std::min(new_cache_size, VertexCacheSize);
+            std::copy(new_cache, new_cache + cache_size, cache);
+        }
+
+        triangles.swap(output);
+    }
+
+    //
+    // Welding and compaction of vertex attributes.
+    //
+
+    typedef std::uint32_t asr::Triangle::* TriangleIndex;
+
+    const TriangleIndex VertexIndices[3] = { &asr::Triangle::m_v0, &asr::Triangle::m_v1, &asr::Triangle::m_v2 };
+    const TriangleIndex TexCoordsIndices[3] = { &asr::Triangle::m_a0, &asr::Triangle::m_a1, &asr::Triangle::m_a2 };
+    const TriangleIndex NormalIndices[3] = { &asr::Triangle::m_n0, &asr::Triangle::m_n1, &asr::Triangle::m_n2 };
+
+    const std::uint32_t Unreferenced = ~std::uint32_t(0);
+
+    template <typename Vector>
+    struct VectorHash
+    {
+        size_t operator()(const Vector& v) const
+        {
+            size_t h = 0;
+            for (size_t i = 0; i < Vector::Dimension; ++i)
+                h = h * 31 + std::hash<typename Vector::ValueType>()(v[i]);
+            return h;
+        }
+    };
+
+    // Renumber the values referenced by triangles in order of first use, dropping unreferenced
+    // values and, if `weld` is true, merging values that are exactly equal.
+    template <typename Vector>
+    void compact_attribute(
+        std::vector<Vector>&        values,
+        std::vector<asr::Triangle>& triangles,
+        const TriangleIndex         (&indices)[3],
+        const bool                  weld)
+    {
+        std::vector<std::uint32_t> remap(values.size(), Unreferenced);
+        std::unordered_map<Vector, std::uint32_t, VectorHash<Vector>> welded_values;
+        std::vector<Vector> compacted_values;
+        compacted_values.reserve(values.size());
+
+        for (auto& triangle : triangles)
+        {
+            for (const TriangleIndex index : indices)
+            {
+                std::uint32_t& i = triangle.*index;
+
+                if (i == asr::Triangle::None)
+                    continue;
+
+                if (remap[i] == Unreferenced)
+                {
+                    const auto new_index = static_cast<std::uint32_t>(compacted_values.size());
+                    if (weld)
+                    {
+                        const auto result = welded_values.insert(std::make_pair(values[i], new_index));
+                        if (result.second)
+                            compacted_values.push_back(values[i]);
+                        remap[i] = result.first->second;
+                    }
+                    else
+                    {
+                        compacted_values.push_back(values[i]);
+                        remap[i] = new_index;
+                    }
+                }
+
+                i = remap[i];
+            }
+        }
+
+        compacted_values.shrink_to_fit();
+        values.swap(compacted_values);
+    }
+
+    //
+    // Mesh optimization.
+    //
+
+    struct MeshOptimizationStats
+    {
+        size_t  m_mesh_count = 0;
+        size_t  m_vertex_count_before = 0;
+        size_t  m_vertex_count_after = 0;
+        size_t  m_tex_coords_count_before = 0;
+        size_t  m_tex_coords_count_after = 0;
+        size_t  m_normal_count_before = 0;
+        size_t  m_normal_count_after = 0;
+        size_t  m_triangle_count_before = 0;
+        size_t  m_triangle_count_after = 0;
+        size_t  m_memory_before = 0;
+        size_t  m_memory_after = 0;
+
+        void add(const MeshData& before, const MeshData& after)
+        {
+            ++m_mesh_count;
+            m_vertex_count_before += before.m_vertices.size();
+            m_vertex_count_after += after.m_vertices.size();
+            m_tex_coords_count_before += before.m_tex_coords.size();
+            m_tex_coords_count_after += after.m_tex_coords.size();
+            m_normal_count_before += before.m_normals.size();
+            m_normal_count_after += after.m_normals.size();
+            m_triangle_count_before += before.m_triangles.size();
+            m_triangle_count_after += after.m_triangles.size();
+            m_memory_before += before.get_memory_size();
+            m_memory_after += after.get_memory_size();
+        }
+
+        void add(const MeshOptimizationStats& other)
+        {
+            m_mesh_count += other.m_mesh_count;
+            m_vertex_count_before += other.m_vertex_count_before;
+            m_vertex_count_after += other.m_vertex_count_after;
+            m_tex_coords_count_before += other.m_tex_coords_count_before;
+            m_tex_coords_count_after += other.m_tex_coords_count_after;
+            m_normal_count_before += other.m_normal_count_before;
+            m_normal_count_after += other.m_normal_count_after;
+            m_triangle_count_before += other.m_triangle_count_before;
+            m_triangle_count_after += other.m_triangle_count_after;
+            m_memory_before += other.m_memory_before;
+            m_memory_after += other.m_memory_after;
+        }
+    };
+
+    struct MeshObjectEntry
+    {
+        asr::Assembly*          m_assembly;
+        asr::MeshObject*        m_object;
+        asr::MeshObject*        m_optimized_object;
+        MeshOptimizationStats   m_stats;
+    };
+
+    void optimize_mesh_object(MeshObjectEntry& entry)
+    {
+        const asr::MeshObject& object = *entry.m_object;
+
+        // Motion-blurred and tangent-space meshes carry extra per-vertex data that isn't handled here.
+        if (object.get_motion_segment_count() > 0 || object.get_vertex_tangent_count() > 0)
+            return;
+
+        const MeshData source = read_mesh_data(object);
+
+        MeshData mesh = source;
+        remove_degenerate_triangles(mesh);
+
+        // Leave meshes made only of degenerate triangles alone.
+        if (mesh.m_triangles.empty())
+            return;
+
+        optimize_triangle_order(mesh);
+
+        compact_attribute(mesh.m_vertices, mesh.m_triangles, VertexIndices, false);
+        compact_attribute(mesh.m_tex_coords, mesh.m_triangles, TexCoordsIndices, true);
+        compact_attribute(mesh.m_normals, mesh.m_triangles, NormalIndices, true);
+
+        entry.m_optimized_object = create_mesh_object(object, mesh).release();
+        entry.m_stats.add(source, mesh);
+    }
+
+    void collect_mesh_objects(asr::Assembly& assembly, std::vector<MeshObjectEntry>& entries)
+    {
+        const char* mesh_object_model = asr::MeshObjectFactory().get_model();
+
+        for (auto& object : assembly.objects())
+        {
+            if (std::strcmp(object.get_model(), mesh_object_model) == 0)
+            {
+                MeshObjectEntry entry;
+                entry.m_assembly = &assembly;
+                entry.m_object = static_cast<asr::MeshObject*>(&object);
+                entry.m_optimized_object = nullptr;
+                entries.push_back(entry);
+            }
+        }
+
+        for (auto& child_assembly : assembly.assemblies())
+            collect_mesh_objects(child_assembly, entries);
+    }
+}
+
+void optimize_mesh_objects(asr::Assembly& assembly)
+{
+    asf::Stopwatch<asf::DefaultWallclockTimer> stopwatch;
+    stopwatch.start();
+
+    std::vector<MeshObjectEntry> entries;
+    collect_mesh_objects(assembly, entries);
+
+    // Mesh objects are independent from each other, so they are optimized in parallel.
+    std::atomic<size_t> next_entry_index(0);
+    const auto optimize_entries = [&]()
+    {
+        while (true)
+        {
+            const size_t entry_index = next_entry_index++;
+            if (entry_index >= entries.size())
+                break;
+
+            optimize_mesh_object(entries[entry_index]);
+        }
+    };
+
+    const size_t thread_count =
+        std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1U), entries.size());
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < thread_count; ++i)
+        threads.emplace_back(optimize_entries);
+
+    optimize_entries();
+
+    for (auto& thread : threads)
+        thread.join();
+
+    // Replace the original objects by the optimized ones. Object instances refer to objects
+    // by name so they don't need to be updated.
+    MeshOptimizationStats stats;
+    for (auto& entry : entries)
+    {
+        if (entry.m_optimized_object == nullptr)
+            continue;
+
+        entry.m_assembly->objects().remove(entry.m_object);
+        entry.m_assembly->objects().insert(asf::auto_release_ptr<asr::Object>(entry.m_optimized_object));
+
+        stats.add(entry.m_stats);
+    }
+
+    stopwatch.measure();
+
+    RENDERER_LOG_INFO(
+        "optimized %s mesh object%s in %s:\n"
+        "  vertices         %s -> %s\n"
+        "  texture coords   %s -> %s\n"
+        "  normals          %s -> %s\n"
+        "  triangles        %s -> %s\n"
+        "  memory           %s -> %s",
+        asf::pretty_uint(stats.m_mesh_count).c_str(),
+        stats.m_mesh_count > 1 ? "s" : "",
+        asf::pretty_time(stopwatch.get_seconds()).c_str(),
+        asf::pretty_uint(stats.m_vertex_count_before).c_str(),
+        asf::pretty_uint(stats.m_vertex_count_after).c_str(),
+        asf::pretty_uint(stats.m_tex_coords_count_before).c_str(),
+        asf::pretty_uint(stats.m_tex_coords_count_after).c_str(),
+        asf::pretty_uint(stats.m_normal_count_before).c_str(),
+        asf::pretty_uint(stats.m_normal_count_after).c_str(),
+        asf::pretty_uint(stats.m_triangle_count_before).c_str(),
+        asf::pretty_uint(stats.m_triangle_count_after).c_str(),
+        asf::pretty_size(stats.m_memory_before).c_str(),
+        asf::pretty_size(stats.m_memory_after).c_str());
+}
@@ -35,7 +35,10 @@
 #include "appleseedobjpropsmod/appleseedobjpropsmod.h"
 #include "appleseedrenderelement/appleseedrenderelement.h"
 #include "appleseedrenderer/maxsceneentities.h"
+#include "appleseedrenderer/meshoptimizer.h"
+#include "appleseedscatterobj/appleseedscatterobj.h"
 #include "seexprutils.h"
+#include "textureconverter.h"
 #include "utilities.h"
 
 // appleseed-max-common headers.
@@ -55,6 +58,7 @@
 #include "renderer/api/environmentshader.h"
 #include "renderer/api/frame.h"
 #include "renderer/api/light.h"
+#include "renderer/api/log.h"
 #include "renderer/api/material.h"
 #include "renderer/api/object.h"
 #include "renderer/api/postprocessing.h"
@@ -74,6 +78,7 @@
 #include "foundation/utility/containers/dictionary.h"
 #include "foundation/utility/iostreamop.h"
 #include "foundation/utility/searchpaths.h"
+#include "foundation/utility/string.h"
 
 // 3ds Max headers.
 #include "appleseed-max-common/_beginmaxheaders.h"
@@ -84,16 +89,25 @@
 #include <INodeTab.h>
 #include <MeshNormalSpec.h>
 #include <modstack.h>
+#include <notify.h>
 #include <object.h>
 #include <pbbitmap.h>
+#include <ref.h>
 #include <renderelements.h>
 #include <RendType.h>
 #include <Scene/IPhysicalCamera.h>
+#include <shape.h>
+#include <spline3d.h>
 #include <trig.h>
 #include <triobj.h>
 #include "appleseed-max-common/_endmaxheaders.h"
 
+// Platform headers.
+#include <xmmintrin.h>
+
 // Standard headers.
+#include <algorithm>
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
 #include <limits>
@@ -200,45 +214,148 @@ namespace
         }
     };
 
-    asf::auto_release_ptr<asr::MeshObject> convert_mesh_object(
+    // Material slot index of material IDs not used by any face of a mesh.
+    const std::uint32_t UnusedMaterialSlot = ~std::uint32_t(0);
+
+    // Create one material slot per material ID used by a mesh, in order of first appearance,
+    // and return a table mapping material IDs to material slot indices.
+    std::vector<std::uint32_t> create_material_slots(
         Mesh&                   mesh,
-        const Matrix3&          mesh_transform,
+        asr::MeshObject&        object,
         ObjectInfo&             object_info)
     {
-        asf::auto_release_ptr<asr::MeshObject> object(
-            asr::MeshObjectFactory().create(object_info.m_name.c_str(), asr::ParamArray()));
+        const int face_count = mesh.getNumFaces();
 
-        // Make sure the input mesh has vertex normals.
-        mesh.checkNormals(TRUE);
+        MtlID max_mtlid = 0;
+        for (int i = 0; i < face_count; ++i)
+            max_mtlid = std::max(max_mtlid, mesh.faces[i].getMatID());
 
-        // Copy vertices to the mesh object.
-        object->reserve_vertices(mesh.getNumVerts());
-        for (int i = 0, e = mesh.getNumVerts(); i < e; ++i)
+        std::vector<std::uint32_t> slot_table(static_cast<size_t>(max_mtlid) + 1, UnusedMaterialSlot);
+
+        for (int i = 0; i < face_count; ++i)
         {
-            const Point3 v = mesh_transform * mesh.getVert(i);
-            object->push_vertex(asr::GVector3(v.x, v.y, v.z));
+            const MtlID mtlid = mesh.faces[i].getMatID();
+            if (slot_table[mtlid] == UnusedMaterialSlot)
+            {
+                const auto slot_name = "material_slot_" + asf::to_string(object.get_material_slot_count());
+                const auto slot_index = static_cast<std::uint32_t>(object.push_material_slot(slot_name.c_str()));
+                object_info.m_mtlid_to_slot_name.insert(std::make_pair(mtlid, slot_name));
+                object_info.m_mtlid_to_slot_index.insert(std::make_pair(mtlid, slot_index));
+                slot_table[mtlid] = slot_index;
+            }
         }
 
-        // Copy texture vertices to the mesh object.
-        object->reserve_tex_coords(mesh.getNumTVerts());
-        for (int i = 0, e = mesh.getNumTVerts(); i < e; ++i)
+        return slot_table;
+    }
+
+    // Vertex normals stored as separate arrays of coordinates such that they can be normalized in bulk.
+    class NormalArrays
+    {
+      public:
+        explicit NormalArrays(const size_t capacity)
+          : m_x(capacity)
+          , m_y(capacity)
+          , m_z(capacity)
+          , m_size(0)
         {
-            const UVVert& uv = mesh.getTVert(i);
-            object->push_tex_coords(asr::GVector2(uv.x, uv.y));
         }
 
-        // Compute the matrix to transform normals.
-        Matrix3 normal_transform = mesh_transform;
-        normal_transform.Invert();
-        normal_transform = transpose(normal_transform);
+        std::uint32_t push(const Point3& n)
+        {
+            DbgAssert(m_size < m_x.size());
+            m_x[m_size] = n.x;
+            m_y[m_size] = n.y;
+            m_z[m_size] = n.z;
+            return static_cast<std::uint32_t>(m_size++);
+        }
+
+        // Normalize all normals, four at a time. Zero-length normals are rare: they are replaced
+        // by the same fallback as asf::safe_normalize() one at a time.
+        void normalize()
+        {
+            float* x = m_x.data();
+            float* y = m_y.data();
+            float* z = m_z.data();
+
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 one = _mm_set1_ps(1.0f);
+
+            size_t i = 0;
+
+            for (; i + 4 <= m_size; i += 4)
+            {
+                const __m128 vx = _mm_loadu_ps(x + i);
+                const __m128 vy = _mm_loadu_ps(y + i);
+                const __m128 vz = _mm_loadu_ps(z + i);
+
+                const __m128 square_norm =
+                    _mm_add_ps(
+                        _mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)),
+                        _mm_mul_ps(vz, vz));
+
+                const __m128 nonzero = _mm_cmpgt_ps(square_norm, zero);
+                const __m128 rcp_norm = _mm_div_ps(one, _mm_sqrt_ps(square_norm));
+                const __m128 scale = _mm_or_ps(_mm_and_ps(nonzero, rcp_norm), _mm_andnot_ps(nonzero, one));
+
+                _mm_storeu_ps(x + i, _mm_mul_ps(vx, scale));
+                _mm_storeu_ps(y + i, _mm_mul_ps(vy, scale));
+                _mm_storeu_ps(z + i, _mm_mul_ps(vz, scale));
+
+                const int nonzero_mask = _mm_movemask_ps(nonzero);
+                if (nonzero_mask != 0xF)
+                {
+                    for (size_t j = 0; j < 4; ++j)
+                    {
+                        if ((nonzero_mask & (1 << j)) == 0)
+                            safe_normalize(i + j);
+                    }
+                }
+            }
+
+            for (; i < m_size; ++i)
+                safe_normalize(i);
+        }
+
+        void copy_to(asr::MeshObject& object) const
+        {
+            object.reserve_vertex_normals(m_size);
+            for (size_t i = 0; i < m_size; ++i)
+                object.push_vertex_normal(asr::GVector3(m_x[i], m_y[i], m_z[i]));
+        }
+
+      private:
+        std::vector<float>  m_x;
+        std::vector<float>  m_y;
+        std::vector<float>  m_z;
+        size_t              m_size;
+
+        void safe_normalize(const size_t i)
+        {
+            const asr::GVector3 n = asf::safe_normalize(asr::GVector3(m_x[i], m_y[i], m_z[i]));
+            m_x[i] = n.x;
+            m_y[i] = n.y;
+            m_z[i] = n.z;
+        }
+    };
+
+    // Convert the faces of a mesh to triangles. Whether the mesh has texture coordinates and specified
+    // normals is known ahead of time, so that the per-face loop doesn't need to test for them.
+    template <bool HasTexCoords, bool HasSpecifiedNormals>
+    void convert_mesh_faces(
+        Mesh&                               mesh,
+        MeshNormalSpec*                     nspec,
+        const Matrix3&                      normal_transform,
+        const std::vector<std::uint32_t>&   slot_table,
+        NormalArrays&                       normals,
+        asr::MeshObject&                    object)
+    {
+        static_assert(
+            sizeof(DWORD) == sizeof(std::uint32_t),
+            "DWORD is expected to be 32-bit long");
 
-        // Copy vertex normals and triangles to mesh object.
-        object->reserve_vertex_normals(mesh.getNumFaces() * 3);
-        object->reserve_triangles(mesh.getNumFaces());
         for (int i = 0, e = mesh.getNumFaces(); i < e; ++i)
         {
             Face& face = mesh.faces[i];
-            TVFace& tvface = mesh.tvFace[i];
 
             const DWORD face_smgroup = face.getSmGroup();
             const MtlID face_mat = face.getMatID();
@@ -247,33 +364,22 @@ namespace
             if (face_smgroup == 0)
             {
                 // No smooth group for this face, check if face has explicit normals.
-                bool normal_set = false;
-                MeshNormalSpec* nspec = mesh.GetSpecifiedNormals();
-                if (nspec)
+                const bool normal_set =
+                    HasSpecifiedNormals &&
+                    nspec->GetNormalIndex(i, 0) >= 0 &&
+                    nspec->GetNormalIndex(i, 1) >= 0 &&
+                    nspec->GetNormalIndex(i, 2) >= 0;
+
+                if (normal_set)
                 {
                     for (int j = 0; j < 3; ++j)
-                    {
-                        const int norm_index = nspec->GetNormalIndex(i, j);
-                        normal_set = norm_index >= 0;
-                        if (!normal_set)
-                            break;
-                        
-                        const Point3& n = nspec->Normal(norm_index);
-                        normal_indices[j] =
-                            static_cast<std::uint32_t>(
-                                object->push_vertex_normal(
-                                    asf::safe_normalize(asr::GVector3(n.x, n.y, n.z))));
-                    }
+                        normal_indices[j] = normals.push(nspec->Normal(nspec->GetNormalIndex(i, j)));
                 }
-
-                if (!normal_set)
+                else
                 {
                     // No explicit normals for this face, use face normal.
-                    const Point3 n = normal_transform * mesh.getFaceNormal(i);
                     const std::uint32_t normal_index =
-                        static_cast<std::uint32_t>(
-                            object->push_vertex_normal(
-                                asf::safe_normalize(asr::GVector3(n.x, n.y, n.z))));
+                        normals.push(VectorTransform(normal_transform, mesh.getFaceNormal(i)));
                     normal_indices[0] = normal_index;
                     normal_indices[1] = normal_index;
                     normal_indices[2] = normal_index;
@@ -285,40 +391,34 @@ namespace
                 {
                     RVertex& rvertex = mesh.getRVert(face.getVert(j));
                     const size_t normal_count = rvertex.rFlags & NORCT_MASK;
+
+                    const Point3* n = nullptr;
                     if (normal_count == 1)
                     {
                         // This vertex has a single normal.
-                        const Point3& n = rvertex.rn.getNormal();
-                        normal_indices[j] =
-                            static_cast<std::uint32_t>(
-                                object->push_vertex_normal(
-                                    asf::safe_normalize(asr::GVector3(n.x, n.y, n.z))));
+                        n = &rvertex.rn.getNormal();
                     }
                     else
                     {
-                        // This vertex has multiple normals.
+                        // This vertex has multiple normals, find the one for this smooth group and material.
                         for (size_t k = 0; k < normal_count; ++k)
                         {
-                            // Find the normal for this smooth group and material.
                             RNormal& rn = rvertex.ern[k];
                             if ((face_smgroup & rn.getSmGroup()) && face_mat == rn.getMtlIndex())
                             {
-                                const Point3& n = rn.getNormal();
-                                normal_indices[j] =
-                                    static_cast<std::uint32_t>(
-                                        object->push_vertex_normal(
-                                            asf::safe_normalize(asr::GVector3(n.x, n.y, n.z))));
+                                n = &rn.getNormal();
                                 break;
                             }
                         }
                     }
+
+                    normal_indices[j] =
+                        n != nullptr
+                            ? normals.push(*n)
+                            : normals.push(VectorTransform(normal_transform, mesh.getFaceNormal(i)));
                 }
             }
 
-            static_assert(
-                sizeof(DWORD) == sizeof(std::uint32_t),
-                "DWORD is expected to be 32-bit long");
-
             asr::Triangle triangle;
             triangle.m_v0 = face.getVert(0);
             triangle.m_v1 = face.getVert(1);
@@ -326,8 +426,9 @@ namespace
             triangle.m_n0 = normal_indices[0];
             triangle.m_n1 = normal_indices[1];
             triangle.m_n2 = normal_indices[2];
-            if (mesh.getNumTVerts() > 0)
+            if (HasTexCoords)
             {
+                const TVFace& tvface = mesh.tvFace[i];
                 triangle.m_a0 = tvface.getTVert(0);
                 triangle.m_a1 = tvface.getTVert(1);
                 triangle.m_a2 = tvface.getTVert(2);
@@ -338,27 +439,76 @@ namespace
                 triangle.m_a1 = asr::Triangle::None;
                 triangle.m_a2 = asr::Triangle::None;
             }
+            triangle.m_pa = slot_table[face_mat];
 
-            // Assign to the triangle the material slot corresponding to the face's material ID,
-            // creating a new material slot if necessary.
-            std::uint32_t slot_index;
-            const MtlID mtlid = face.getMatID();
-            const auto it = object_info.m_mtlid_to_slot_index.find(mtlid);
-            if (it == object_info.m_mtlid_to_slot_index.end())
-            {
-                // Create a new material slot in the object.
-                const auto slot_name = "material_slot_" + asf::to_string(object->get_material_slot_count());
-                slot_index = static_cast<std::uint32_t>(object->push_material_slot(slot_name.c_str()));
-                object_info.m_mtlid_to_slot_name.insert(std::make_pair(mtlid, slot_name));
-                object_info.m_mtlid_to_slot_index.insert(std::make_pair(mtlid, slot_index));
-            }
-            else slot_index = it->second;
-            triangle.m_pa = slot_index;
+            object.push_triangle(triangle);
+        }
+    }
 
-            object->push_triangle(triangle);
+    asf::auto_release_ptr<asr::MeshObject> convert_mesh_object(
+        Mesh&                   mesh,
+        const Matrix3&          mesh_transform,
+        ObjectInfo&             object_info)
+    {
+        asf::auto_release_ptr<asr::MeshObject> object(
+            asr::MeshObjectFactory().create(object_info.m_name.c_str(), asr::ParamArray()));
+
+        // Make sure the input mesh has vertex normals.
+        mesh.checkNormals(TRUE);
+
+        const int vertex_count = mesh.getNumVerts();
+        const int tex_coords_count = mesh.getNumTVerts();
+        const int face_count = mesh.getNumFaces();
+
+        // Copy vertices to the mesh object.
+        object->reserve_vertices(vertex_count);
+        for (int i = 0; i < vertex_count; ++i)
+        {
+            const Point3 v = mesh_transform * mesh.getVert(i);
+            object->push_vertex(asr::GVector3(v.x, v.y, v.z));
         }
 
-        // todo: optimize the object.
+        // Copy texture vertices to the mesh object.
+        object->reserve_tex_coords(tex_coords_count);
+        for (int i = 0; i < tex_coords_count; ++i)
+        {
+            const UVVert& uv = mesh.getTVert(i);
+            object->push_tex_coords(asr::GVector2(uv.x, uv.y));
+        }
+
+        // Create material slots and map material IDs to them once and for all.
+        const std::vector<std::uint32_t> slot_table = create_material_slots(mesh, object.ref(), object_info);
+
+        // Compute the matrix to transform normals.
+        Matrix3 normal_transform = mesh_transform;
+        normal_transform.Invert();
+        normal_transform = transpose(normal_transform);
+
+        MeshNormalSpec* nspec = mesh.GetSpecifiedNormals();
+        const bool has_tex_coords = tex_coords_count > 0;
+        const bool has_specified_normals = nspec != nullptr && nspec->GetNumFaces() > 0;
+
+        // Each face has at most three distinct normals.
+        NormalArrays normals(static_cast<size_t>(face_count) * 3);
+
+        // Convert faces to triangles.
+        object->reserve_triangles(face_count);
+        if (has_tex_coords)
+        {
+            if (has_specified_normals)
+                convert_mesh_faces<true, true>(mesh, nspec, normal_transform, slot_table, normals, object.ref());
+            else convert_mesh_faces<true, false>(mesh, nspec, normal_transform, slot_table, normals, object.ref());
+        }
+        else
+        {
+            if (has_specified_normals)
+                convert_mesh_faces<false, true>(mesh, nspec, normal_transform, slot_table, normals, object.ref());
+            else convert_mesh_faces<false, false>(mesh, nspec, normal_transform, slot_table, normals, object.ref());
+        }
+
+        // Normalize vertex normals in bulk and copy them to the mesh object.
+        normals.normalize();
+        normals.copy_to(object.ref());
 
         return object;
     }
@@ -429,6 +579,85 @@ namespace
         return object_infos;
     }
 
+    // Renderable shapes that can be converted to Bezier splines are exported as curves
+    // rather than being tessellated into tubes.
+    bool is_curve_object(INode* object_node, const TimeValue time)
+    {
+        Object* object = object_node->EvalWorldState(time).obj;
+        if (object == nullptr || object->SuperClassID() != SHAPE_CLASS_ID)
+            return false;
+
+        ShapeObject* shape_object = static_cast<ShapeObject*>(object);
+        return shape_object->GetRenderable() && shape_object->CanMakeBezier();
+    }
+
+    std::vector<ObjectInfo> create_curve_objects(
+        asr::Assembly&          assembly,
+        INode*                  object_node,
+        const TimeValue         time)
+    {
+        // Retrieve the ShapeObject at the desired time.
+        const ObjectState object_state = object_node->EvalWorldState(time);
+        ShapeObject* shape_object = static_cast<ShapeObject*>(object_state.obj);
+
+        BezierShape bezier_shape;
+        shape_object->MakeBezier(time, bezier_shape);
+
+        size_t segment_count = 0;
+        for (int i = 0; i < bezier_shape.splineCount; ++i)
+            segment_count += static_cast<size_t>(bezier_shape.splines[i]->Segments());
+
+        if (segment_count == 0)
+            return {};
+
+        ObjectInfo object_info;
+        object_info.m_name = wide_to_utf8(object_node->GetName());
+        object_info.m_name = make_unique_name(assembly.objects(), object_info.m_name);
+
+        asf::auto_release_ptr<asr::CurveObject> object(
+            asr::CurveObjectFactory::create(
+                object_info.m_name.c_str(),
+                asr::ParamArray().insert("basis", "bezier")));
+
+        // Max splines have a single rendering thickness, used as the width of all control points.
+        Interval thickness_validity = FOREVER;
+        const float width = shape_object->GetThickness(time, thickness_validity);
+        const float widths[4] = { width, width, width, width };
+        const float opacities[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+        const asf::Color3f colors[4] = { asf::Color3f(1.0f), asf::Color3f(1.0f), asf::Color3f(1.0f), asf::Color3f(1.0f) };
+
+        // Each segment of a Max spline is a cubic Bezier curve going from a knot to the next one,
+        // with the out vector of the first knot and the in vector of the second one as inner control points.
+        object->reserve_curves3(segment_count);
+        for (int i = 0; i < bezier_shape.splineCount; ++i)
+        {
+            Spline3D* spline = bezier_shape.splines[i];
+            const int knot_count = spline->KnotCount();
+
+            for (int j = 0, e = spline->Segments(); j < e; ++j)
+            {
+                const int next_knot = (j + 1) % knot_count;
+                const asr::GVector3 control_points[4] =
+                {
+                    to_vector3f(spline->GetKnotPoint(j)),
+                    to_vector3f(spline->GetOutVec(j)),
+                    to_vector3f(spline->GetInVec(next_knot)),
+                    to_vector3f(spline->GetKnotPoint(next_knot))
+                };
+                object->push_curve3(asr::Curve3Type(control_points, widths, opacities, colors));
+            }
+        }
+
+        // Remember the material slots declared by the object.
+        for (size_t i = 0, e = object->get_material_slot_count(); i < e; ++i)
+            object_info.m_mtlid_to_slot_name.insert(std::make_pair(0, object->get_material_slot(i)));
+
+        // Insert object into assembly.
+        assembly.objects().insert(asf::auto_release_ptr<asr::Object>(object));
+
+        return { object_info };
+    }
+
     std::vector<ObjectInfo> create_objects(
         asr::Project&           project,
         asr::Assembly&          assembly,
@@ -456,14 +685,19 @@ namespace
             if (!object)
                 return {};
 
-            // Remember the material slots declared by the object.
+            // Remember the material slots declared by the object. Material slot i is bound to material ID i.
             for (size_t i = 0, e = object->get_material_slot_count(); i < e; ++i)
-                object_info.m_mtlid_to_slot_name.insert(std::make_pair(0, object->get_material_slot(i)));
+                object_info.m_mtlid_to_slot_name.insert(std::make_pair(static_cast<MtlID>(i), object->get_material_slot(i)));
 
             // Insert object into assembly.
             assembly.objects().insert(object);
             return { object_info };
         }
+        else if (is_curve_object(object_node, time))
+        {
+            // This object is a renderable spline: export it as a curve object.
+            return create_curve_objects(assembly, object_node, time);
+        }
         else
         {
             // This object is not an appleseed-max object plugin: export the object as one or multiple mesh objects.
@@ -858,6 +1092,131 @@ namespace
         obj_instance_map[wide_to_utf8(instance_node->GetName())] = assembly.object_instances().get_by_index(instance_index);
     }
 
+    std::string get_or_create_object_assembly(
+        asr::Project&           project,
+        asr::Assembly&          assembly,
+        INode*                  node,
+        const RenderType        type,
+        const RendererSettings& settings,
+        const TimeValue         time,
+        MaterialMap&            material_map,
+        AssemblyMap&            assembly_map)
+    {
+        // Retrieve the geometrical object referenced by this node.
+        Object* object = node->GetObjectRef();
+
+        // Check if we already created an assembly for that object.
+        const AssemblyMap::const_iterator it = assembly_map.find(object);
+        if (it != assembly_map.end())
+            return it->second;
+
+        // Create an assembly for that object.
+        const std::string assembly_name =
+            make_unique_name(assembly.assemblies(), wide_to_utf8(node->GetName()) + "_assembly");
+        asf::auto_release_ptr<asr::Assembly> object_assembly(
+            asr::AssemblyFactory().create(assembly_name.c_str()));
+
+        // Add objects and object instances to that assembly.
+        ObjectInstanceMap fake_instance_map;
+        auto object_infos = create_objects(project, object_assembly.ref(), node, time);
+        for (auto& object_info : object_infos)
+        {
+            create_object_instance(
+                object_assembly.ref(),
+                &assembly,
+                node,
+                asf::Transformd::identity(),
+                object_info,
+                type,
+                settings,
+                time,
+                fake_instance_map,
+                material_map);
+        }
+
+        // Remember the name of the assembly corresponding to that object.
+        assembly_map.insert(std::make_pair(object, assembly_name));
+
+        // Insert the assembly into the scene.
+        assembly.assemblies().insert(object_assembly);
+
+        return assembly_name;
+    }
+
+    bool is_scatter_object(INode* node, const TimeValue time)
+    {
+        Object* object = node->EvalWorldState(time).obj;
+        return object != nullptr && object->ClassID() == AppleseedScatterObj::get_class_id();
+    }
+
+    // Instances generated by a scatter object share one assembly per source node, each
+    // instance being a lightweight assembly instance of the assembly of its source node.
+    void add_scatter_instances(
+        asr::Project&           project,
+        asr::Assembly&          assembly,
+        INode*                  node,
+        const RenderType        type,
+        const RendererSettings& settings,
+        const TimeValue         time,
+        MaterialMap&            material_map,
+        AssemblyMap&            assembly_map)
+    {
+        AppleseedScatterObj* scatter_object =
+            static_cast<AppleseedScatterObj*>(node->EvalWorldState(time).obj);
+
+        // Create the assemblies of the source nodes, before any instance is generated.
+        std::vector<std::string> source_assembly_names;
+        for (int i = 0, e = scatter_object->get_source_node_count(time); i < e; ++i)
+        {
+            INode* source_node = scatter_object->get_source_node(time, i);
+            source_assembly_names.push_back(
+                source_node != nullptr
+                    ? get_or_create_object_assembly(
+                          project,
+                          assembly,
+                          source_node,
+                          type,
+                          settings,
+                          time,
+                          material_map,
+                          assembly_map)
+                    : std::string());
+        }
+
+        const std::vector<AppleseedScatterObj::Instance> instances =
+            scatter_object->generate_instances(time, std::numeric_limits<size_t>::max());
+
+        // Instance names only need to be made unique once, the index of the instance disambiguates them.
+        const std::string instance_name_prefix =
+            make_unique_name(assembly.assembly_instances(), wide_to_utf8(node->GetName()) + "_scatter");
+
+        for (size_t i = 0, e = instances.size(); i < e; ++i)
+        {
+            const AppleseedScatterObj::Instance& instance = instances[i];
+            const std::string& assembly_name = source_assembly_names[instance.m_source_index];
+            if (assembly_name.empty())
+                continue;
+
+            const std::string instance_name = instance_name_prefix + "_" + asf::to_string(i);
+            asf::auto_release_ptr<asr::AssemblyInstance> assembly_instance(
+                asr::AssemblyInstanceFactory::create(
+                    instance_name.c_str(),
+                    asr::ParamArray(),
+                    assembly_name.c_str()));
+            assembly_instance->transform_sequence().set_transform(
+                0.0,
+                asf::Transformd::from_local_to_parent(to_matrix4d(instance.m_transform)));
+
+            assembly.assembly_instances().insert(assembly_instance);
+        }
+
+        RENDERER_LOG_INFO(
+            "scatter object \"%s\" generated %s instance%s.",
+            wide_to_utf8(node->GetName()).c_str(),
+            asf::pretty_uint(instances.size()).c_str(),
+            instances.size() > 1 ? "s" : "");
+    }
+
     void add_objects(
         asr::Project&           project,
         asr::Assembly&          assembly,
@@ -979,118 +1338,17 @@ namespace
         assembly.lights().insert(light);
     }
 
-    void add_light(
-        asr::Assembly&          assembly,
-        const RendParams&       rend_params,
-        INode*                  light_node,
-        const TimeValue         time)
-    {
-        // Retrieve the ObjectState at the desired time.
-        const ObjectState object_state = light_node->EvalWorldState(time);
-
-        // Compute a unique name for this light.
-        std::string light_name = wide_to_utf8(light_node->GetName());
-        light_name = make_unique_name(assembly.lights(), light_name);
-
-        // Compute the transform of this light.
-        const asf::Transformd transform =
-            asf::Transformd::from_local_to_parent(
-                to_matrix4d(light_node->GetObjTMAfterWSM(time)));
-
-        // Retrieve the light's parameters.
-        GenLight* light_object = dynamic_cast<GenLight*>(object_state.obj);
-        if (light_object == nullptr)
-            return;
-
-        const asf::Color3f color = to_color3f(light_object->GetRGBColor(time));
-        const float intensity = light_object->GetIntensity(time);
-        const float decay_start = light_object->GetDecayRadius(time);
-        const int decay_exponent = light_object->GetDecayType();
-
-        // Skip exporting lights with zero intensity
-        if (!asf::is_zero(color) && intensity > 0.0f)
-        {
-            // Create a color entity.
-            const std::string color_name =
-                insert_color(assembly, light_name + "_color", color);
-
-            // Get light from envmap.
-            INode* sun_node(nullptr);
-            BOOL sun_node_on(FALSE);
-            float sun_size_mult;
-            if (rend_params.envMap != nullptr &&
-                rend_params.envMap->IsSubClassOf(AppleseedEnvMap::get_class_id()))
-            {
-                AppleseedEnvMap* env_map = static_cast<AppleseedEnvMap*>(rend_params.envMap);
-                env_map->GetParamBlock(0)->GetValueByName(L"sun_node", time, sun_node, FOREVER);
-                env_map->GetParamBlock(0)->GetValueByName(L"sun_node_on", time, sun_node_on, FOREVER);
-                env_map->GetParamBlock(0)->GetValueByName(L"sun_size_multiplier", time, sun_size_mult, FOREVER);
-            }
-
-            if (sun_node && sun_node_on && light_node == sun_node)
-            {
-                add_sun_light(
-                    assembly,
-                    light_name,
-                    transform,
-                    color_name,
-                    intensity,
-                    sun_size_mult,
-                    "environment_edf");
-            }
-            else if (light_object->ClassID() == Class_ID(OMNI_LIGHT_CLASS_ID, 0))
-            {
-                add_omni_light(
-                    assembly,
-                    light_name,
-                    transform,
-                    color_name,
-                    intensity,
-                    decay_start,
-                    decay_exponent);
-            }
-            else if (light_object->ClassID() == Class_ID(SPOT_LIGHT_CLASS_ID, 0) ||
-                     light_object->ClassID() == Class_ID(FSPOT_LIGHT_CLASS_ID, 0))
-            {
-                add_spot_light(
-                    assembly,
-                    light_name,
-                    transform,
-                    color_name,
-                    intensity,
-                    light_object->GetHotspot(time),
-                    light_object->GetFallsize(time),
-                    decay_start,
-                    decay_exponent);
-            }
-            else if (light_object->ClassID() == Class_ID(DIR_LIGHT_CLASS_ID, 0) ||
-                     light_object->ClassID() == Class_ID(TDIR_LIGHT_CLASS_ID, 0))
-            {
-                add_directional_light(
-                    assembly,
-                    light_name,
-                    transform,
-                    color_name,
-                    intensity);
-            }
-            else
-            {
-                // Unsupported light type.
-                // todo: emit warning message.
-            }
-        }
-    }
-
     void add_lights(
         asr::Assembly&          assembly,
         const RendParams&       rend_params,
         const MaxSceneEntities& entities,
-        const TimeValue         time)
+        const TimeValue         time,
+        LightMap&               light_map)
     {
         for (const auto& light_info : entities.m_lights)
         {
             if (light_info.m_enabled)
-                add_light(assembly, rend_params, light_info.m_light, time);
+                add_light(assembly, rend_params, light_info.m_light, time, light_map);
         }
     }
 
@@ -1200,7 +1458,8 @@ namespace
         ObjectInstanceMap&                  object_inst_map,
         MaterialMap&                        material_map,
         AssemblyMap&                        assembly_map,
-        AssemblyInstanceMap&                assembly_inst_map)
+        AssemblyInstanceMap&                assembly_inst_map,
+        LightMap&                           light_map)
     {
         // Add objects, object instances and materials to the assembly.
         add_objects(
@@ -1217,8 +1476,12 @@ namespace
             assembly_inst_map,
             progress_cb);
 
+        // Optimize mesh objects once they are all created.
+        if (type == RenderType::Default && settings.m_optimize_meshes)
+            optimize_mesh_objects(assembly);
+
         // Only add non-physical lights. Light-emitting materials were added by material plugins.
-        add_lights(assembly, rend_params, entities, time);
+        add_lights(assembly, rend_params, entities, time, light_map);
 
         // Add Max's default lights if
         //       the scene does not contain non-physical lights (point lights, spot lights, etc.)
@@ -1280,6 +1543,133 @@ namespace
         }
     }
 
+    asf::auto_release_ptr<asf::Image> bake_environment_map(
+        Texmap*                 envmap,
+        const size_t            width,
+        const size_t            height,
+        const TimeValue         time)
+    {
+        // Render the environment map into a Max bitmap.
+        BitmapInfo bi;
+        bi.SetWidth(static_cast<WORD>(width));
+        bi.SetHeight(static_cast<WORD>(height));
+        bi.SetType(BMM_FLOAT_RGBA_32);
+        Bitmap* envmap_bitmap = TheManager->Create(&bi);
+        envmap->RenderBitmap(time, envmap_bitmap, 1.0f, TRUE);
+
+        // Render the Max bitmap to an appleseed image.
+        asf::auto_release_ptr<asf::Image> envmap_image =
+            render_bitmap_to_image(envmap_bitmap, width, height, 32, 32);
+
+        // Destroy the Max bitmap.
+        envmap_bitmap->DeleteThis();
+
+        // Write the environment map to disk, useful for debugging.
+        // asf::GenericImageFileWriter writer;
+        // writer.write("appleseed-max-environment-map.exr", envmap_image.ref());
+
+        return envmap_image;
+    }
+
+    const int EnvironmentMapCacheResetNotificationCodes[] =
+    {
+        NOTIFY_SYSTEM_PRE_RESET,
+        NOTIFY_SYSTEM_PRE_NEW,
+        NOTIFY_FILE_PRE_OPEN
+    };
+
+    //
+    // Keeps the last baked image of an environment map across renders. The baked image is
+    // discarded when the environment map (or anything it references) changes, or when it
+    // is requested for a time outside of the validity interval of the environment map.
+    // The reference to the environment map is released when the scene is reset.
+    //
+
+    class BakedEnvironmentMapCache
+      : public SingleRefMaker
+    {
+      public:
+        asf::auto_release_ptr<asf::Image> get_image(
+            Texmap*             envmap,
+            const size_t        width,
+            const size_t        height,
+            const TimeValue     time)
+        {
+            register_notifications();
+
+            if (GetRef() != envmap ||
+                m_image.get() == nullptr ||
+                m_image->properties().m_canvas_width != width ||
+                m_image->properties().m_canvas_height != height ||
+                !m_validity.InInterval(time))
+            {
+                SetRef(envmap);
+                m_validity = envmap->Validity(time);
+                m_image = bake_environment_map(envmap, width, height, time);
+            }
+
+            // The texture entity takes ownership of the image it is given.
+            return asf::auto_release_ptr<asf::Image>(new asf::Image(m_image.ref()));
+        }
+
+        RefResult NotifyRefChanged(
+            const Interval&     change_interval,
+            RefTargetHandle     target,
+            PartID&             part_id,
+            RefMessage          message,
+            BOOL                propagate) override
+        {
+            if (message == REFMSG_CHANGE)
+                m_image.reset();
+
+            return SingleRefMaker::NotifyRefChanged(change_interval, target, part_id, message, propagate);
+        }
+
+        // Drop the baked image and the reference to the environment map.
+        void clear()
+        {
+            m_image.reset();
+            SetRef(nullptr);
+            unregister_notifications();
+        }
+
+      private:
+        Interval                            m_validity;
+        asf::auto_release_ptr<asf::Image>   m_image;
+        bool                                m_registered = false;
+
+        static void on_scene_reset(void* param, NotifyInfo* info)
+        {
+            // Don't keep the environment map of the previous scene alive.
+            static_cast<BakedEnvironmentMapCache*>(param)->clear();
+        }
+
+        void register_notifications()
+        {
+            if (m_registered)
+                return;
+
+            for (const int code : EnvironmentMapCacheResetNotificationCodes)
+                RegisterNotification(on_scene_reset, this, code);
+
+            m_registered = true;
+        }
+
+        void unregister_notifications()
+        {
+            if (!m_registered)
+                return;
+
+            for (const int code : EnvironmentMapCacheResetNotificationCodes)
+                UnRegisterNotification(on_scene_reset, this, code);
+
+            m_registered = false;
+        }
+    };
+
+    BakedEnvironmentMapCache g_envmap_cache;
+    BakedEnvironmentMapCache g_material_editor_envmap_cache;
+
     void setup_environment_map(
         asr::Scene&             scene,
         const RendParams&       rend_params,
@@ -1314,27 +1704,12 @@ namespace
             else
             {
                 // Dimensions of the environment map texture.
-                const size_t EnvMapWidth = 2048;
-                const size_t EnvMapHeight = 1024;
-
-                // Render the environment map into a Max bitmap.
-                BitmapInfo bi;
-                bi.SetWidth(static_cast<WORD>(EnvMapWidth));
-                bi.SetHeight(static_cast<WORD>(EnvMapHeight));
-                bi.SetType(BMM_FLOAT_RGBA_32);
-                Bitmap* envmap_bitmap = TheManager->Create(&bi);
-                rend_params.envMap->RenderBitmap(time, envmap_bitmap, 1.0f, TRUE);
-
-                // Render the Max bitmap to an appleseed image.
-                asf::auto_release_ptr<asf::Image> envmap_image =
-                    render_bitmap_to_image(envmap_bitmap, EnvMapWidth, EnvMapHeight, 32, 32);
-
-                // Destroy the Max bitmap.
-                envmap_bitmap->DeleteThis();
+                const size_t EnvMapWidth = static_cast<size_t>(settings.m_envmap_bake_width);
+                const size_t EnvMapHeight = EnvMapWidth / 2;
 
-                // Write the environment map to disk, useful for debugging.
-                // asf::GenericImageFileWriter writer;
-                // writer.write("appleseed-max-environment-map.exr", envmap_image.ref());
+                // Bake the environment map, or reuse the image baked by a previous render.
+                asf::auto_release_ptr<asf::Image> envmap_image =
+                    g_envmap_cache.get_image(rend_params.envMap, EnvMapWidth, EnvMapHeight, time);
 
                 const std::string env_tex_name = make_unique_name(scene.textures(), "environment_map");
                 scene.textures().insert(
@@ -1422,24 +1797,9 @@ namespace
         const size_t EnvMapWidth = 512;
         const size_t EnvMapHeight = 512;
 
-        // Render the environment map into a Max bitmap.
-        BitmapInfo bi;
-        bi.SetWidth(static_cast<WORD>(EnvMapWidth));
-        bi.SetHeight(static_cast<WORD>(EnvMapHeight));
-        bi.SetType(BMM_FLOAT_RGBA_32);
-        Bitmap* envmap_bitmap = TheManager->Create(&bi);
-        rend_params.envMap->RenderBitmap(time, envmap_bitmap, 1.0f, TRUE);
-
-        // Render the Max bitmap to an appleseed image.
+        // Bake the environment map, or reuse the image baked by a previous material preview.
         asf::auto_release_ptr<asf::Image> envmap_image =
-            render_bitmap_to_image(envmap_bitmap, EnvMapWidth, EnvMapHeight, 32, 32);
-
-        // Destroy the Max bitmap.
-        envmap_bitmap->DeleteThis();
-
-        // Write the environment map to disk, useful for debugging.
-        // asf::GenericImageFileWriter writer;
-        // writer.write("appleseed-max-material-editor-environment-map.exr", envmap_image.ref());
+            g_material_editor_envmap_cache.get_image(rend_params.envMap, EnvMapWidth, EnvMapHeight, time);
 
         // Create texture entity from image.
         const std::string env_tex_name = make_unique_name(scene.textures(), "environment_map");
@@ -1502,6 +1862,19 @@ namespace
         else setup_solid_environment(scene, frame_rend_params, settings);
     }
 
+    std::wstring get_texture_conversion_directory(const RendererSettings& settings)
+    {
+        if (!settings.m_enable_texture_conversion)
+            return std::wstring();
+
+        if (!settings.m_texture_conversion_path.isNull())
+            return settings.m_texture_conversion_path.data();
+
+        std::wstring directory = GetCOREInterface()->GetDir(APP_TEMP_DIR);
+        directory += L"\\appleseed\\textures";
+        return directory;
+    }
+
     const char* get_filter_type(const int filter_type)
     {
         switch (filter_type)
@@ -1529,6 +1902,23 @@ namespace
         }
     }
 
+    // Create the AOV rendered for an appleseed render element, or return an empty pointer.
+    asf::auto_release_ptr<asr::AOV> create_render_element_aov(IRenderElement* render_element)
+    {
+        if (render_element->ClassID() != AppleseedRenderElement::get_class_id())
+            return asf::auto_release_ptr<asr::AOV>();
+
+        auto factories = g_aov_factory_registrar.get_factories();
+
+        AppleseedRenderElement* element = static_cast<AppleseedRenderElement*>(render_element);
+        int aov_index = 0;
+        element->GetParamBlock(0)->GetValueByName(L"aov_index", 0, aov_index, FOREVER);
+        if (aov_index <= 0 || aov_index > static_cast<int>(factories.size()))
+            return asf::auto_release_ptr<asr::AOV>();
+
+        return factories[aov_index - 1]->create(asr::ParamArray());
+    }
+
     asf::auto_release_ptr<asr::Frame> build_frame(
         const RendParams&       rend_params,
         const FrameRendParams&  frame_rend_params,
@@ -1554,35 +1944,30 @@ namespace
             IRenderElementMgr* re_manager = GetCOREInterface()->GetCurRenderElementMgr();
             if (re_manager != nullptr)
             {
-                re_manager->SetDisplayElements(false);
                 for (int i = 0, e = re_manager->NumRenderElements(); i < e; ++i)
                 {
-                    auto factories = g_aov_factory_registrar.get_factories();
-
                     auto* render_element = re_manager->GetRenderElement(i);
-                    render_element->SetEnabled(false);
 
-                    if (render_element->ClassID() == AppleseedRenderElement::get_class_id())
+                    asf::auto_release_ptr<asr::AOV> aov_entity = create_render_element_aov(render_element);
+                    if (aov_entity.get() == nullptr)
                     {
-                        AppleseedRenderElement* element = static_cast<AppleseedRenderElement*>(render_element);
-                        int aov_index = 0;
-                        element->GetParamBlock(0)->GetValueByName(L"aov_index", 0, aov_index, FOREVER);
-                        if (aov_index > 0 && aov_index <= static_cast<int>(factories.size()))
+                        // appleseed can't render this element.
+                        render_element->SetEnabled(false);
+                        continue;
+                    }
+
+                    if (aovs.get_by_name(aov_entity->get_name()) == nullptr)
+                    {
+                        // AOVs streamed into the bitmap of their render element are saved by 3ds Max.
+                        PBBitmap* p_bitmap = nullptr;
+                        render_element->GetPBBitmap(p_bitmap);
+                        if (p_bitmap != nullptr && p_bitmap->bm == nullptr)
                         {
-                            asf::auto_release_ptr<asr::AOV> aov_entity = factories[aov_index - 1]->create(asr::ParamArray());
-                            if (aovs.get_by_name(aov_entity->get_name()) == nullptr)
-                            {
-                                PBBitmap* p_bitmap = nullptr;
-                                render_element->GetPBBitmap(p_bitmap);
-                                if (p_bitmap != nullptr)
-                                {
-                                    aov_entity->get_parameters().insert(
-                                        "output_filename",
-                                        wide_to_utf8(p_bitmap->bi.Name()).c_str());
-                                }
-                                aovs.insert(aov_entity);
-                            }
+                            aov_entity->get_parameters().insert(
+                                "output_filename",
+                                wide_to_utf8(p_bitmap->bi.Name()).c_str());
                         }
+                        aovs.insert(aov_entity);
                     }
                 }
             }
@@ -1778,7 +2163,8 @@ asf::auto_release_ptr<asr::Project> build_project(
     ObjectInstanceMap&                      object_inst_map,
     MaterialMap&                            material_map,
     AssemblyMap&                            assembly_map,
-    AssemblyInstanceMap&                    assembly_inst_map)
+    AssemblyInstanceMap&                    assembly_inst_map,
+    LightMap&                               light_map)
 {
     // Create an empty project.
     asf::auto_release_ptr<asr::Project> project(
@@ -1786,6 +2172,7 @@ asf::auto_release_ptr<asr::Project> build_project(
 
     object_map.clear();
     material_map.clear();
+    light_map.clear();
 
     // Initialize search paths.
     project->search_paths().set_root_path(get_root_path());
@@ -1799,6 +2186,9 @@ asf::auto_release_ptr<asr::Project> build_project(
     // Add default configurations to the project.
     project->add_default_configurations();
 
+    // Bitmap textures get converted, if enabled, as the environment and the materials are built.
+    set_texture_conversion_directory(get_texture_conversion_directory(settings));
+
     // Create a scene.
     asf::auto_release_ptr<asr::Scene> scene(asr::SceneFactory::create());
 
@@ -1833,7 +2223,8 @@ asf::auto_release_ptr<asr::Project> build_project(
         object_inst_map,
         material_map,
         assembly_map,
-        assembly_inst_map);
+        assembly_inst_map,
+        light_map);
 
     // Create an instance of the assembly and insert it into the scene.
     asf::auto_release_ptr<asr::AssemblyInstance> assembly_instance(
@@ -1883,6 +2274,21 @@ void add_object(
     AssemblyMap&            assembly_map,
     AssemblyInstanceMap&    assembly_inst_map)
 {
+    // Scatter objects have no geometry of their own: they only emit instances of their source nodes.
+    if (is_scatter_object(node, time))
+    {
+        add_scatter_instances(
+            project,
+            assembly,
+            node,
+            type,
+            settings,
+            time,
+            material_map,
+            assembly_map);
+        return;
+    }
+
     // Retrieve the geometrical object referenced by this node.
     Object* object = node->GetObjectRef();
 
@@ -1893,66 +2299,16 @@ void add_object(
 
     if (is_motion_blur_enabled(node, time) || should_optimize_for_instancing(object, time))
     {
-        // Look for an existing assembly for that object, or create one if none could be found.
-        std::string assembly_name;
-        const AssemblyMap::const_iterator it = assembly_map.find(object);
-        if (it == assembly_map.end())
-        {
-            // Create an assembly for that object.
-            assembly_name = make_unique_name(assembly.assemblies(), wide_to_utf8(node->GetName()) + "_assembly");
-            asf::auto_release_ptr<asr::Assembly> object_assembly(
-                asr::AssemblyFactory().create(assembly_name.c_str()));
-
-            // Add objects and object instances to that assembly.
-            ObjectInstanceMap fake_instance_map;
-            auto object_infos = create_objects(project, object_assembly.ref(), node, time);
-            for (auto& object_info : object_infos)
-            {
-                create_object_instance(
-                    object_assembly.ref(),
-                    &assembly,
-                    node,
-                    asf::Transformd::identity(),
-                    object_info,
-                    type,
-                    settings,
-                    time,
-                    fake_instance_map,
-                    material_map);
-            }
-
-            // Remember the name of the assembly corresponding to that object.
-            assembly_map.insert(std::make_pair(object, assembly_name));
-
-            // Insert the assembly into the scene.
-            assembly.assemblies().insert(object_assembly);
-        }
-        else
-        {
-            assembly_name = it->second;
-        }
-
-        // Create an instance of the assembly corresponding to that object.
-        const std::string object_assembly_instance_name =
-            make_unique_name(assembly.assembly_instances(), assembly_name + "_instance");
-        asf::auto_release_ptr<asr::AssemblyInstance> object_assembly_instance(
-            asr::AssemblyInstanceFactory::create(
-                object_assembly_instance_name.c_str(),
-                asr::ParamArray(),
-                assembly_name.c_str()));
-        object_assembly_instance->transform_sequence().set_transform(0.0, transform);
-
-        // Apply transformation motion blur if enabled on that object.
-        if (is_motion_blur_enabled(node, time))
-        {
-            object_assembly_instance->transform_sequence()
-                .set_transform(1.0, asf::Transformd::from_local_to_parent(
-                    to_matrix4d(node->GetObjTMAfterWSM(time + GetTicksPerFrame()))));
-        }
-
-        // Insert the assembly instance into the parent assembly.
-        assembly.assembly_instances().insert(object_assembly_instance);
-        assembly_inst_map[wide_to_utf8(node->GetName())] = assembly.assembly_instances().get_by_name(object_assembly_instance_name.c_str());
+        add_object_as_assembly_instance(
+            project,
+            assembly,
+            node,
+            type,
+            settings,
+            time,
+            material_map,
+            assembly_map,
+            assembly_inst_map);
     }
     else
     {
@@ -1982,3 +2338,268 @@ void add_object(
         }
     }
 }
+
+void add_object_as_assembly_instance(
+    asr::Project&           project,
+    asr::Assembly&          assembly,
+    INode*                  node,
+    const RenderType        type,
+    const RendererSettings& settings,
+    const TimeValue         time,
+    MaterialMap&            material_map,
+    AssemblyMap&            assembly_map,
+    AssemblyInstanceMap&    assembly_inst_map)
+{
+    // Compute the transform of this instance.
+    const asf::Transformd transform =
+        asf::Transformd::from_local_to_parent(
+            to_matrix4d(node->GetObjTMAfterWSM(time)));
+
+    // Look for an existing assembly for that object, or create one if none could be found.
+    const std::string assembly_name =
+        get_or_create_object_assembly(
+            project,
+            assembly,
+            node,
+            type,
+            settings,
+            time,
+            material_map,
+            assembly_map);
+
+    // Create an instance of the assembly corresponding to that object.
+    const std::string object_assembly_instance_name =
+        make_unique_name(assembly.assembly_instances(), assembly_name + "_instance");
+    asf::auto_release_ptr<asr::AssemblyInstance> object_assembly_instance(
+        asr::AssemblyInstanceFactory::create(
+            object_assembly_instance_name.c_str(),
+            asr::ParamArray(),
+            assembly_name.c_str()));
+    object_assembly_instance->transform_sequence().set_transform(0.0, transform);
+
+    // Apply transformation motion blur if enabled on that object.
+    if (is_motion_blur_enabled(node, time))
+    {
+        object_assembly_instance->transform_sequence()
+            .set_transform(1.0, asf::Transformd::from_local_to_parent(
+                to_matrix4d(node->GetObjTMAfterWSM(time + GetTicksPerFrame()))));
+    }
+
+    // Insert the assembly instance into the parent assembly.
+    assembly.assembly_instances().insert(object_assembly_instance);
+    assembly_inst_map[wide_to_utf8(node->GetName())] = assembly.assembly_instances().get_by_name(object_assembly_instance_name.c_str());
+}
+
+void add_light(
+    asr::Assembly&          assembly,
+    const RendParams&       rend_params,
+    INode*                  light_node,
+    const TimeValue         time,
+    LightMap&               light_map)
+{
+    // Retrieve the ObjectState at the desired time.
+    const ObjectState object_state = light_node->EvalWorldState(time);
+
+    // Compute a unique name for this light.
+    std::string light_name = wide_to_utf8(light_node->GetName());
+    light_name = make_unique_name(assembly.lights(), light_name);
+
+    // Compute the transform of this light.
+    const asf::Transformd transform =
+        asf::Transformd::from_local_to_parent(
+            to_matrix4d(light_node->GetObjTMAfterWSM(time)));
+
+    // Retrieve the light's parameters.
+    GenLight* light_object = dynamic_cast<GenLight*>(object_state.obj);
+    if (light_object == nullptr)
+        return;
+
+    const asf::Color3f color = to_color3f(light_object->GetRGBColor(time));
+    const float intensity = light_object->GetIntensity(time);
+    const float decay_start = light_object->GetDecayRadius(time);
+    const int decay_exponent = light_object->GetDecayType();
+
+    // Skip exporting lights with zero intensity
+    if (!asf::is_zero(color) && intensity > 0.0f)
+    {
+        // Create a color entity.
+        const std::string color_name =
+            insert_color(assembly, light_name + "_color", color);
+
+        // Remember the names of the entities of this light, node names are not unique.
+        LightEntityNames& entity_names = light_map[light_node];
+        entity_names.m_light_name = light_name;
+        entity_names.m_color_name = color_name;
+
+        // Get light from envmap.
+        INode* sun_node(nullptr);
+        BOOL sun_node_on(FALSE);
+        float sun_size_mult;
+        if (rend_params.envMap != nullptr &&
+            rend_params.envMap->IsSubClassOf(AppleseedEnvMap::get_class_id()))
+        {
+            AppleseedEnvMap* env_map = static_cast<AppleseedEnvMap*>(rend_params.envMap);
+            env_map->GetParamBlock(0)->GetValueByName(L"sun_node", time, sun_node, FOREVER);
+            env_map->GetParamBlock(0)->GetValueByName(L"sun_node_on", time, sun_node_on, FOREVER);
+            env_map->GetParamBlock(0)->GetValueByName(L"sun_size_multiplier", time, sun_size_mult, FOREVER);
+        }
+
+        if (sun_node && sun_node_on && light_node == sun_node)
+        {
+            add_sun_light(
+                assembly,
+                light_name,
+                transform,
+                color_name,
+                intensity,
+                sun_size_mult,
+                "environment_edf");
+        }
+        else if (light_object->ClassID() == Class_ID(OMNI_LIGHT_CLASS_ID, 0))
+        {
+            add_omni_light(
+                assembly,
+                light_name,
+                transform,
+                color_name,
+                intensity,
+                decay_start,
+                decay_exponent);
+        }
+        else if (light_object->ClassID() == Class_ID(SPOT_LIGHT_CLASS_ID, 0) ||
+                 light_object->ClassID() == Class_ID(FSPOT_LIGHT_CLASS_ID, 0))
+        {
+            add_spot_light(
+                assembly,
+                light_name,
+                transform,
+                color_name,
+                intensity,
+                light_object->GetHotspot(time),
+                light_object->GetFallsize(time),
+                decay_start,
+                decay_exponent);
+        }
+        else if (light_object->ClassID() == Class_ID(DIR_LIGHT_CLASS_ID, 0) ||
+                 light_object->ClassID() == Class_ID(TDIR_LIGHT_CLASS_ID, 0))
+        {
+            add_directional_light(
+                assembly,
+                light_name,
+                transform,
+                color_name,
+                intensity);
+        }
+        else
+        {
+            // Unsupported light type.
+            // todo: emit warning message.
+        }
+    }
+}
+
+void update_light(
+    asr::Assembly&          assembly,
+    const RendParams&       rend_params,
+    INode*                  light_node,
+    const TimeValue         time,
+    LightMap&               light_map)
+{
+    // Remove the light and its color entity, then create them again.
+    remove_light(assembly, light_node, light_map);
+    add_light(assembly, rend_params, light_node, time, light_map);
+}
+
+void remove_light(
+    asr::Assembly&          assembly,
+    INode*                  light_node,
+    LightMap&               light_map)
+{
+    const auto it = light_map.find(light_node);
+    if (it == light_map.end())
+        return;
+
+    if (asr::Light* light = assembly.lights().get_by_name(it->second.m_light_name.c_str()))
+        assembly.lights().remove(light);
+
+    if (asr::ColorEntity* color = assembly.colors().get_by_name(it->second.m_color_name.c_str()))
+        assembly.colors().remove(color);
+
+    light_map.erase(it);
+}
+
+void clear_environment_map_caches()
+{
+    g_envmap_cache.clear();
+    g_material_editor_envmap_cache.clear();
+}
+
+asf::auto_release_ptr<asr::Scene> build_environment(
+    const RendParams&       rend_params,
+    const FrameRendParams&  frame_rend_params,
+    const RendererSettings& settings,
+    const TimeValue         time)
+{
+    asf::auto_release_ptr<asr::Scene> scene(asr::SceneFactory::create());
+
+    setup_environment(
+        scene.ref(),
+        rend_params,
+        frame_rend_params,
+        settings,
+        time);
+
+    return scene;
+}
+
+AOVBitmapMap get_render_element_bitmaps()
+{
+    AOVBitmapMap aov_bitmaps;
+
+    IRenderElementMgr* re_manager = GetCOREInterface()->GetCurRenderElementMgr();
+    if (re_manager == nullptr)
+        return aov_bitmaps;
+
+    for (int i = 0, e = re_manager->NumRenderElements(); i < e; ++i)
+    {
+        auto* render_element = re_manager->GetRenderElement(i);
+
+        PBBitmap* p_bitmap = nullptr;
+        render_element->GetPBBitmap(p_bitmap);
+        if (p_bitmap == nullptr || p_bitmap->bm == nullptr)
+            continue;
+
+        // Like build_frame(), only consider the first render element of each AOV.
+        asf::auto_release_ptr<asr::AOV> aov = create_render_element_aov(render_element);
+        if (aov.get() != nullptr)
+            aov_bitmaps.insert(std::make_pair(std::string(aov->get_name()), p_bitmap->bm));
+    }
+
+    return aov_bitmaps;
+}
+
+void recreate_frame(
+    asr::Project&           project,
+    const asr::ParamArray&  additional_params)
+{
+    asr::Frame* frame = project.get_frame();
+
+    asr::ParamArray params = frame->get_parameters();
+    params.merge(additional_params);
+
+    asf::auto_release_ptr<asr::Frame> new_frame(
+        asr::FrameFactory::create(
+            frame->get_name(),
+            params,
+            frame->aovs()));
+
+    // The crop window only remains valid if the resolution does not change.
+    if (!additional_params.strings().exist("resolution"))
+        new_frame->set_crop_window(frame->get_crop_window());
+
+    asr::PostProcessingStageContainer& stages = frame->post_processing_stages();
+    while (!stages.empty())
+        new_frame->post_processing_stages().insert(stages.remove(&*stages.begin()));
+
+    project.set_frame(new_frame);
+}
@@ -33,6 +33,7 @@
 
 // appleseed-max headers.
 #include "appleseedrenderer/renderersettings.h"
+#include "appleseedrenderer/tilecallback.h"
 
 // appleseed.foundation headers.
 #include "foundation/utility/autoreleaseptr.h"
@@ -45,6 +46,7 @@
 
 // Standard headers.
 #include <map>
+#include <string>
 #include <vector>
 
 // Forward declarations.
@@ -52,7 +54,9 @@ namespace renderer { class Assembly; }
 namespace renderer { class AssemblyInstance; }
 namespace renderer { class Camera; }
 namespace renderer { class ObjectInstance; }
+namespace renderer { class ParamArray; }
 namespace renderer { class Project; }
+namespace renderer { class Scene; }
 class Bitmap;
 class FrameRendParams;
 class IAppleseedGeometricObject;
@@ -82,6 +86,14 @@ typedef std::map<Mtl*, std::string> MaterialMap;
 typedef std::map<IAppleseedMtl*, std::string> IAppleseedMtlMap;
 typedef std::map<Object*, std::string> AssemblyMap;
 
+struct LightEntityNames
+{
+    std::string                         m_light_name;                   // name of the appleseed light
+    std::string                         m_color_name;                   // name of the color entity of the light
+};
+
+typedef std::map<INode*, LightEntityNames> LightMap;
+
 // Build an appleseed project from the current 3ds Max scene.
 foundation::auto_release_ptr<renderer::Project> build_project(
     const MaxSceneEntities&             entities,
@@ -98,7 +110,8 @@ foundation::auto_release_ptr<renderer::Project> build_project(
     ObjectInstanceMap&                  object_inst_map,
     MaterialMap&                        material_map,
     AssemblyMap&                        assembly_map,
-    AssemblyInstanceMap&                assembly_inst_map);
+    AssemblyInstanceMap&                assembly_inst_map,
+    LightMap&                           light_map);
 
 foundation::auto_release_ptr<renderer::Camera> build_camera(
     INode*                              view_node,
@@ -119,3 +132,60 @@ void add_object(
     MaterialMap&                        material_map,
     AssemblyMap&                        assembly_map,
     AssemblyInstanceMap&                assembly_inst_map);
+
+// Add an object as an instance of an assembly holding its geometry. The transform of the
+// object can then be changed by replacing its assembly instance only.
+void add_object_as_assembly_instance(
+    renderer::Project&                  project,
+    renderer::Assembly&                 assembly,
+    INode*                              node,
+    const RenderType                    type,
+    const RendererSettings&             settings,
+    const TimeValue                     time,
+    MaterialMap&                        material_map,
+    AssemblyMap&                        assembly_map,
+    AssemblyInstanceMap&                assembly_inst_map);
+
+// Add the appleseed light of a 3ds Max light, evaluated at a given time, to an assembly.
+void add_light(
+    renderer::Assembly&                 assembly,
+    const RendParams&                   rend_params,
+    INode*                              light_node,
+    const TimeValue                     time,
+    LightMap&                           light_map);
+
+// Replace the appleseed light of a 3ds Max light by one evaluated at a given time.
+void update_light(
+    renderer::Assembly&                 assembly,
+    const RendParams&                   rend_params,
+    INode*                              light_node,
+    const TimeValue                     time,
+    LightMap&                           light_map);
+
+// Remove the appleseed light of a 3ds Max light, if any.
+void remove_light(
+    renderer::Assembly&                 assembly,
+    INode*                              light_node,
+    LightMap&                           light_map);
+
+// Release the environment maps referenced by the caches of baked environment maps.
+// Must be called before the plug-in is unloaded.
+void clear_environment_map_caches();
+
+// Build the environment of a scene in a scene of its own. The returned scene only holds
+// the environment and the scene-level entities it refers to; these can then be moved to
+// a scene built by build_project() to replace its environment.
+foundation::auto_release_ptr<renderer::Scene> build_environment(
+    const RendParams&                   rend_params,
+    const FrameRendParams&              frame_rend_params,
+    const RendererSettings&             settings,
+    const TimeValue                     time);
+
+// Return the bitmaps allocated by 3ds Max for the appleseed render elements of the scene.
+AOVBitmapMap get_render_element_bitmaps();
+
+// Replace the frame of a project by one with the same settings, AOVs and post-processing
+// stages but with additional parameters.
+void recreate_frame(
+    renderer::Project&                  project,
+    const renderer::ParamArray&         additional_params);
@@ -0,0 +1,535 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2015-2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Interface header.
+#include "projectwriter.h"
+
+// appleseed-max headers.
+#include "utilities.h"
+
+// Build options header.
+#include "foundation/core/buildoptions.h"
+
+// appleseed.renderer headers.
+#include "renderer/api/log.h"
+#include "renderer/api/object.h"
+#include "renderer/api/project.h"
+#include "renderer/api/scene.h"
+
+// appleseed.foundation headers.
+#include "foundation/platform/defaulttimers.h"
+#include "foundation/utility/siphash.h"
+#include "foundation/utility/stopwatch.h"
+#include "foundation/utility/string.h"
+
+// Boost headers.
+#include "boost/filesystem.hpp"
+#include "boost/filesystem/fstream.hpp"
+
+// Standard headers.
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace asf = foundation;
+namespace asr = renderer;
+namespace bf = boost::filesystem;
+
+namespace
+{
+    const char* GeometryDirectoryName = "geometry";
+
+    struct GeometryEntry
+    {
+        asr::Object*    m_object;
+        bool            m_is_mesh;
+        std::string     m_stem;             // stem of the geometry file
+        std::string     m_filename;         // path of the geometry file, relative to the project file
+        bool            m_duplicate;        // the geometry file is written by another entry
+        bool            m_skipped;          // the geometry file was already up-to-date
+        bool            m_success;
+    };
+
+    void collect_geometry(asr::Assembly& assembly, std::vector<GeometryEntry>& entries)
+    {
+        const char* mesh_object_model = asr::MeshObjectFactory().get_model();
+        const char* curve_object_model = asr::CurveObjectFactory().get_model();
+
+        for (auto& object : assembly.objects())
+        {
+            const bool is_mesh = std::strcmp(object.get_model(), mesh_object_model) == 0;
+            const bool is_curve = std::strcmp(object.get_model(), curve_object_model) == 0;
+
+            if (is_mesh || is_curve)
+            {
+                GeometryEntry entry;
+                entry.m_object = &object;
+                entry.m_is_mesh = is_mesh;
+                entry.m_duplicate = false;
+                entry.m_skipped = false;
+                entry.m_success = false;
+                entries.push_back(entry);
+            }
+        }
+
+        for (auto& child_assembly : assembly.assemblies())
+            collect_geometry(child_assembly, entries);
+    }
+
+    // Object names are node names, which may contain characters that are not allowed in file names.
+    std::string make_file_stem(const char* object_name)
+    {
+        std::string stem = object_name;
+        std::replace_if(
+            stem.begin(),
+            stem.end(),
+            [](const char c) { return std::strchr("\\/:*?\"<>|", c) != nullptr; },
+            '_');
+        return stem;
+    }
+
+    //
+    // Hash of a stream of data, computed one block at a time.
+    //
+
+    class StreamHasher
+    {
+      public:
+        StreamHasher()
+          : m_size(0)
+          , m_hash(0)
+        {
+            m_buffer.resize(64 * 1024);
+        }
+
+        template <typename T>
+        void update(const T& value)
+        {
+            update(&value, sizeof(T));
+        }
+
+        void update(const void* data, size_t size)
+        {
+            const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+
+            while (size > 0)
+            {
+                const size_t n = std::min(size, m_buffer.size() - m_size);
+                std::memcpy(&m_buffer[m_size], bytes, n);
+                m_size += n;
+                bytes += n;
+                size -= n;
+
+                if (m_size == m_buffer.size())
+                    flush();
+            }
+        }
+
+        std::uint64_t digest()
+        {
+            flush();
+            return m_hash;
+        }
+
+      private:
+        std::vector<std::uint8_t>   m_buffer;
+        size_t                      m_size;
+        std::uint64_t               m_hash;
+
+        void flush()
+        {
+            if (m_size == 0)
+                return;
+
+            const std::uint64_t chain[2] = { m_hash, asf::siphash24(m_buffer.data(), m_size) };
+            m_hash = asf::siphash24(chain, sizeof(chain));
+            m_size = 0;
+        }
+    };
+
+    std::uint64_t hash_mesh_object(const asr::MeshObject& object)
+    {
+        StreamHasher hasher;
+
+        hasher.update(object.get_vertex_count());
+        for (size_t i = 0, e = object.get_vertex_count(); i < e; ++i)
+            hasher.update(object.get_vertex(i));
+
+        hasher.update(object.get_vertex_normal_count());
+        for (size_t i = 0, e = object.get_vertex_normal_count(); i < e; ++i)
+            hasher.update(object.get_vertex_normal(i));
+
+        hasher.update(object.get_tex_coords_count());
+        for (size_t i = 0, e = object.get_tex_coords_count(); i < e; ++i)
+            hasher.update(object.get_tex_coords(i));
+
+        hasher.update(object.get_triangle_count());
+        for (size_t i = 0, e = object.get_triangle_count(); i < e; ++i)
+            hasher.update(object.get_triangle(i));
+
+        hasher.update(object.get_material_slot_count());
+        for (size_t i = 0, e = object.get_material_slot_count(); i < e; ++i)
+        {
+            const char* slot = object.get_material_slot(i);
+            hasher.update(slot, std::strlen(slot) + 1);
+        }
+
+        return hasher.digest();
+    }
+
+    bool write_geometry_file(const asr::Object& object, const bool is_mesh, const bf::path& path)
+    {
+        // Write to a temporary file first so that an interrupted export never leaves
+        // a partially written file behind a name that will be trusted by the next export.
+        bf::path temp_path = path;
+        temp_path.replace_extension(L".tmp" + path.extension().wstring());
+
+        const std::string temp_filepath = wide_to_utf8(temp_path.wstring());
+        const bool success =
+            is_mesh
+                ? asr::MeshObjectWriter::write(
+                      static_cast<const asr::MeshObject&>(object),
+                      object.get_name(),
+                      temp_filepath.c_str())
+                : asr::CurveObjectWriter::write(
+                      static_cast<const asr::CurveObject&>(object),
+                      temp_filepath.c_str());
+
+        if (!success)
+        {
+            bf::remove(temp_path);
+            return false;
+        }
+
+        bf::rename(temp_path, path);
+        return true;
+    }
+
+    void write_geometry(const bf::path& project_directory, GeometryEntry& entry)
+    {
+        const bf::path path = project_directory / utf8_to_wide(entry.m_filename);
+
+        try
+        {
+            if (entry.m_is_mesh && bf::exists(path))
+            {
+                entry.m_skipped = true;
+                entry.m_success = true;
+                return;
+            }
+
+            entry.m_success = write_geometry_file(*entry.m_object, entry.m_is_mesh, path);
+        }
+        catch (const bf::filesystem_error& e)
+        {
+            RENDERER_LOG_ERROR("failed to write %s, error = %s.", entry.m_filename.c_str(), e.what());
+            entry.m_success = false;
+        }
+
+        if (!entry.m_success)
+            RENDERER_LOG_ERROR("failed to write geometry of object \"%s\".", entry.m_object->get_name());
+    }
+
+    // Objects are independent from each other, so they are processed in parallel.
+    template <typename Function>
+    void for_each_entry_in_parallel(std::vector<GeometryEntry>& entries, const Function& function)
+    {
+        std::atomic<size_t> next_entry_index(0);
+        const auto process_entries = [&]()
+        {
+            while (true)
+            {
+                const size_t entry_index = next_entry_index++;
+                if (entry_index >= entries.size())
+                    break;
+
+                function(entries[entry_index]);
+            }
+        };
+
+        const size_t thread_count =
+            std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1U), entries.size());
+
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < thread_count; ++i)
+            threads.emplace_back(process_entries);
+
+        process_entries();
+
+        for (auto& thread : threads)
+            thread.join();
+    }
+
+    void collect_project_geometry(asr::Project& project, std::vector<GeometryEntry>& entries)
+    {
+        for (auto& assembly : project.get_scene()->assemblies())
+            collect_geometry(assembly, entries);
+    }
+
+    void name_geometry_files(std::vector<GeometryEntry>& entries)
+    {
+        // Mesh files are named after their content, but curve files are only named after their
+        // object, and object names are only unique within an assembly.
+        std::set<std::string> curve_stems;
+        for (auto& entry : entries)
+        {
+            const std::string stem = make_file_stem(entry.m_object->get_name());
+            entry.m_stem = stem;
+
+            if (!entry.m_is_mesh)
+            {
+                for (size_t i = 1; !curve_stems.insert(entry.m_stem).second; ++i)
+                    entry.m_stem = stem + "_" + asf::to_string(i);
+            }
+        }
+
+        // Curve objects are small and rewritten every time; mesh files are content-addressed.
+        for_each_entry_in_parallel(
+            entries,
+            [](GeometryEntry& entry)
+            {
+                entry.m_filename =
+                    entry.m_is_mesh
+                        ? asf::format("{0}/{1}_{2}.binarymesh",
+                              GeometryDirectoryName,
+                              entry.m_stem,
+                              hash_mesh_object(static_cast<const asr::MeshObject&>(*entry.m_object)))
+                        : asf::format("{0}/{1}.binarycurve", GeometryDirectoryName, entry.m_stem);
+            });
+    }
+
+    // Hash the project file that would be written for a project, along with an optional list
+    // of geometry files. Returns 0 on failure.
+    std::uint64_t hash_project_file(
+        asr::Project&                       project,
+        const std::vector<GeometryEntry>&   entries = std::vector<GeometryEntry>())
+    {
+        try
+        {
+            const bf::path temp_path =
+                bf::temp_directory_path() / bf::unique_path(L"appleseed-%%%%-%%%%-%%%%-%%%%.appleseed");
+            const std::string temp_filepath = wide_to_utf8(temp_path.wstring());
+
+            if (!asr::ProjectFileWriter::write(
+                    project,
+                    temp_filepath.c_str(),
+                    asr::ProjectFileWriter::OmitWritingGeometryFiles |
+                    asr::ProjectFileWriter::OmitHandlingAssetFiles))
+            {
+                bf::remove(temp_path);
+                return 0;
+            }
+
+            StreamHasher hasher;
+
+            bf::ifstream file(temp_path, std::ios::binary);
+            std::vector<char> buffer(64 * 1024);
+            while (file)
+            {
+                file.read(buffer.data(), buffer.size());
+                hasher.update(buffer.data(), static_cast<size_t>(file.gcount()));
+            }
+            file.close();
+
+            bf::remove(temp_path);
+
+            for (const auto& entry : entries)
+            {
+                hasher.update(entry.m_object->get_name(), std::strlen(entry.m_object->get_name()) + 1);
+                hasher.update(entry.m_filename.c_str(), entry.m_filename.size() + 1);
+            }
+
+            return hasher.digest();
+        }
+        catch (const bf::filesystem_error& e)
+        {
+            RENDERER_LOG_ERROR("failed to compute project hash, error = %s.", e.what());
+            return 0;
+        }
+    }
+}
+
+
+//
+// ProjectWriter class implementation.
+//
+
+struct ProjectWriter::Impl
+{
+    asr::Project&                   m_project;
+    const std::string               m_filepath;
+    const bf::path                  m_project_directory;
+    std::vector<GeometryEntry>      m_entries;
+    double                          m_prepare_time;
+
+    Impl(asr::Project& project, const char* filepath)
+      : m_project(project)
+      , m_filepath(filepath)
+      , m_project_directory(bf::path(utf8_to_wide(filepath)).parent_path())
+      , m_prepare_time(0.0)
+    {
+    }
+
+    void prepare()
+    {
+        asf::Stopwatch<asf::DefaultWallclockTimer> stopwatch;
+        stopwatch.start();
+
+        collect_project_geometry(m_project, m_entries);
+        name_geometry_files(m_entries);
+
+        // Identical meshes of different assemblies share their file: only write it once,
+        // otherwise several threads would write the same file concurrently.
+        std::set<std::string> filenames;
+        for (auto& entry : m_entries)
+            entry.m_duplicate = !filenames.insert(entry.m_filename).second;
+
+        // Let the project file reference the geometry files.
+        for (const auto& entry : m_entries)
+        {
+            entry.m_object->get_parameters().insert(
+                entry.m_is_mesh ? "filename" : "filepath",
+                entry.m_filename);
+        }
+
+        stopwatch.measure();
+        m_prepare_time = stopwatch.get_seconds();
+    }
+
+    bool write(const int options)
+    {
+        asf::Stopwatch<asf::DefaultWallclockTimer> stopwatch;
+        stopwatch.start();
+
+        try
+        {
+            bf::create_directories(m_project_directory / utf8_to_wide(GeometryDirectoryName));
+        }
+        catch (const bf::filesystem_error& e)
+        {
+            RENDERER_LOG_ERROR("failed to create geometry directory, error = %s.", e.what());
+            return false;
+        }
+
+        const bf::path& project_directory = m_project_directory;
+        for_each_entry_in_parallel(
+            m_entries,
+            [&project_directory](GeometryEntry& entry)
+            {
+                if (!entry.m_duplicate)
+                    write_geometry(project_directory, entry);
+            });
+
+        bool success = true;
+        size_t written_count = 0;
+        size_t skipped_count = 0;
+        for (const auto& entry : m_entries)
+        {
+            if (entry.m_duplicate)
+                continue;
+
+            success &= entry.m_success;
+
+            if (entry.m_skipped)
+                ++skipped_count;
+            else if (entry.m_success)
+                ++written_count;
+        }
+
+        success &=
+            asr::ProjectFileWriter::write(
+                m_project,
+                m_filepath.c_str(),
+                asr::ProjectFileWriter::OmitWritingGeometryFiles | options);
+
+        stopwatch.measure();
+
+        RENDERER_LOG_INFO(
+            "wrote project %s in %s (%s geometry file%s written, %s unchanged).",
+            m_filepath.c_str(),
+            asf::pretty_time(m_prepare_time + stopwatch.get_seconds()).c_str(),
+            asf::pretty_uint(written_count).c_str(),
+            written_count > 1 ? "s" : "",
+            asf::pretty_uint(skipped_count).c_str());
+
+        return success;
+    }
+
+    std::uint64_t compute_hash()
+    {
+        // The project file references the geometry files by their names.
+        return hash_project_file(m_project);
+    }
+};
+
+ProjectWriter::ProjectWriter(asr::Project& project, const char* filepath)
+  : impl(new Impl(project, filepath))
+{
+    impl->prepare();
+}
+
+ProjectWriter::~ProjectWriter()
+{
+    delete impl;
+}
+
+bool ProjectWriter::write(const int options)
+{
+    return impl->write(options);
+}
+
+std::uint64_t ProjectWriter::compute_hash()
+{
+    return impl->compute_hash();
+}
+
+bool write_project(asr::Project& project, const char* filepath)
+{
+    return ProjectWriter(project, filepath).write();
+}
+
+std::uint64_t compute_project_hash(asr::Project& project)
+{
+    // Name the geometry files without letting the objects reference them.
+    std::vector<GeometryEntry> entries;
+    collect_project_geometry(project, entries);
+    name_geometry_files(entries);
+
+    return hash_project_file(project, entries);
+}
+
+std::uint64_t compute_mesh_hash(const asr::MeshObject& object)
+{
+    return hash_mesh_object(object);
+}
@@ -0,0 +1,85 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2015-2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+// Build options header.
+#include "foundation/core/buildoptions.h"
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+
+// Standard headers.
+#include <cstdint>
+
+// Forward declarations.
+namespace renderer { class MeshObject; }
+namespace renderer { class Project; }
+
+//
+// Write a project to disk. Mesh and curve objects are written in parallel to compressed
+// binary files in a geometry/ directory next to the project file. Mesh files are named
+// after a hash of their content so that meshes that did not change since a previous
+// export are not written again; the project file only references them.
+//
+// The work is split in two phases so that the second one may run while the project is
+// being rendered: the constructor names the geometry files and lets the objects reference
+// them, while write() only reads the project, unless it handles asset files, in which case
+// it updates their paths.
+//
+
+class ProjectWriter
+  : public foundation::NonCopyable
+{
+  public:
+    ProjectWriter(renderer::Project& project, const char* filepath);
+
+    ~ProjectWriter();
+
+    // Write the geometry files and the project file. Options are ProjectFileWriter options.
+    bool write(const int options = 0);
+
+    // Compute a hash of the project file that write() would write. Since mesh files are named
+    // after their content, the hash changes when meshes change, but not when external files
+    // such as textures change. Returns 0 on failure.
+    std::uint64_t compute_hash();
+
+  private:
+    struct Impl;
+    Impl* impl;
+};
+
+// Write a project to disk in one go.
+bool write_project(renderer::Project& project, const char* filepath);
+
+// Compute a hash of a project that, like ProjectWriter::compute_hash(), changes when meshes
+// change, without modifying the project. Returns 0 on failure.
+std::uint64_t compute_project_hash(renderer::Project& project);
+
+// Compute the hash of the content of a mesh object that mesh files are named after.
+std::uint64_t compute_mesh_hash(const renderer::MeshObject& object);
@@ -29,49 +29,151 @@
 // Interface header.
 #include "renderercontroller.h"
 
+// appleseed-max headers.
+#include "appleseedrenderer/renderersettings.h"
+#include "utilities.h"
+
 // Build options header.
 #include "foundation/core/buildoptions.h"
 
+// appleseed.renderer headers.
+#include "renderer/api/log.h"
+
 // appleseed.foundation headers.
 #include "foundation/platform/atomic.h"
+#include "foundation/utility/string.h"
 
 // 3ds Max headers.
 #include "appleseed-max-common/_beginmaxheaders.h"
 #include <render.h>
 #include "appleseed-max-common/_endmaxheaders.h"
 
+// Standard headers.
+#include <algorithm>
+#include <string>
+
 namespace asf = foundation;
 namespace asr = renderer;
 
 RendererController::RendererController(
     RendProgressCallback*   progress_cb,
     volatile std::uint32_t* rendered_tile_count,
-    const size_t            total_tile_count)
+    const size_t            total_tile_count,
+    const RendererSettings& settings)
   : m_progress_cb(progress_cb)
   , m_rendered_tile_count(rendered_tile_count)
   , m_total_tile_count(total_tile_count)
+  , m_pass_tile_count(total_tile_count / std::max(settings.m_passes, 1))
+  , m_budget_tile_count(total_tile_count)
+  , m_time_limit(settings.m_time_limit * 60.0)
   , m_status(ContinueRendering)
+  , m_completed_pass_count(0)
+  , m_last_title_update_time(0.0)
 {
+    // Each pass adds at most this many samples to every pixel.
+    const int pass_samples =
+        settings.m_sampler_type == 0
+            ? settings.m_uniform_pixel_samples
+            : settings.m_adaptive_max_samples;
+
+    if (settings.m_target_samples_per_pixel > 0 && pass_samples > 0)
+    {
+        const size_t budget_pass_count =
+            (settings.m_target_samples_per_pixel + pass_samples - 1) / pass_samples;
+        m_budget_tile_count = std::min(m_total_tile_count, budget_pass_count * m_pass_tile_count);
+    }
 }
 
 void RendererController::on_rendering_begin()
 {
     m_status = ContinueRendering;
+    m_completed_pass_count = 0;
+    m_last_title_update_time = 0.0;
+    m_stopwatch.start();
 }
 
 void RendererController::on_progress()
 {
-    const int done =
-        static_cast<int>(asf::atomic_read(m_rendered_tile_count));
-    const int total = static_cast<int>(m_total_tile_count);
+    const size_t done = static_cast<size_t>(asf::atomic_read(m_rendered_tile_count));
 
     m_status =
-        m_progress_cb->Progress(done, total) == RENDPROG_CONTINUE
+        m_progress_cb->Progress(
+            static_cast<int>(done),
+            static_cast<int>(m_budget_tile_count)) == RENDPROG_CONTINUE
             ? ContinueRendering
             : AbortRendering;
+
+    if (m_status != ContinueRendering)
+        return;
+
+    m_stopwatch.measure();
+    const double elapsed = m_stopwatch.get_seconds();
+
+    // Stop once the passes required by the sample budget are rendered.
+    if (done >= m_budget_tile_count && m_budget_tile_count < m_total_tile_count)
+    {
+        stop("target samples per pixel reached");
+        return;
+    }
+
+    if (m_time_limit > 0.0)
+    {
+        if (elapsed >= m_time_limit)
+        {
+            stop("time limit reached");
+            return;
+        }
+
+        // At the end of a pass, don't start another one that would not complete in time.
+        const size_t completed_pass_count = m_pass_tile_count > 0 ? done / m_pass_tile_count : 0;
+        if (completed_pass_count > m_completed_pass_count)
+        {
+            m_completed_pass_count = completed_pass_count;
+
+            const double pass_time = elapsed / completed_pass_count;
+            if (done < m_budget_tile_count && elapsed + pass_time > m_time_limit)
+            {
+                stop("next pass would exceed the time limit");
+                return;
+            }
+        }
+    }
+
+    // Update the remaining time estimate about once per second.
+    if (elapsed - m_last_title_update_time >= 1.0)
+    {
+        m_last_title_update_time = elapsed;
+        update_title(done, elapsed);
+    }
 }
 
 asr::IRendererController::Status RendererController::get_status() const
 {
     return m_status;
 }
+
+void RendererController::stop(const char* reason)
+{
+    RENDERER_LOG_INFO(
+        "stopping rendering after %s: %s.",
+        asf::pretty_time(m_stopwatch.get_seconds()).c_str(),
+        reason);
+
+    m_status = TerminateRendering;
+}
+
+void RendererController::update_title(const size_t done, const double elapsed)
+{
+    if (done == 0)
+        return;
+
+    // Estimate the remaining time from the throughput so far.
+    const double tiles_per_second = done / elapsed;
+    double remaining = (m_budget_tile_count - std::min(done, m_budget_tile_count)) / tiles_per_second;
+    if (m_time_limit > 0.0)
+        remaining = std::min(remaining, m_time_limit - elapsed);
+
+    const std::string title =
+        "Rendering... (" + asf::pretty_time(remaining, 0) + " remaining)";
+    m_progress_cb->SetTitle(utf8_to_wide(title).c_str());
+}
@@ -34,13 +34,24 @@
 // appleseed.renderer headers.
 #include "renderer/api/rendering.h"
 
+// appleseed.foundation headers.
+#include "foundation/platform/defaulttimers.h"
+#include "foundation/utility/stopwatch.h"
+
 // Standard headers.
 #include <cstddef>
 #include <cstdint>
 
 // Forward declarations.
+class RendererSettings;
 class RendProgressCallback;
 
+//
+// Report progress to 3ds Max and stop rendering when the user asks for it or when the
+// time or sample budget of the render settings is exhausted. Budgets stop renders with
+// TerminateRendering so that the frame is still completed and written.
+//
+
 class RendererController
   : public renderer::DefaultRendererController
 {
@@ -48,7 +59,8 @@ class RendererController
     RendererController(
         RendProgressCallback*           progress_cb,
         volatile std::uint32_t*         rendered_tile_count,
-        const size_t                    total_tile_count);
+        const size_t                    total_tile_count,
+        const RendererSettings&         settings);
 
     void on_rendering_begin() override;
 
@@ -60,5 +72,14 @@ class RendererController
     RendProgressCallback*               m_progress_cb;
     volatile std::uint32_t*             m_rendered_tile_count;
     const size_t                        m_total_tile_count;
+    const size_t                        m_pass_tile_count;
+    size_t                              m_budget_tile_count;        // tiles to render within the sample budget
+    double                              m_time_limit;               // in seconds, 0 for no limit
     Status                              m_status;
+    size_t                              m_completed_pass_count;
+    double                              m_last_title_update_time;
+    foundation::Stopwatch<foundation::DefaultWallclockTimer> m_stopwatch;
+
+    void stop(const char* reason);
+    void update_title(const size_t done, const double elapsed);
 };
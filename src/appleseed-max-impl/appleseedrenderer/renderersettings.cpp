@@ -60,6 +60,8 @@ namespace
             m_sampler_type = 0;
             m_noise_seed = 0;
             m_enable_noise_seed = true;
+            m_time_limit = 0;
+            m_target_samples_per_pixel = 0;
 
             m_uniform_pixel_samples = 64;
 
@@ -76,6 +78,7 @@ namespace
             m_force_off_default_lights = false;
             m_enable_light_importance_sampling = false;
             m_light_sampling_algorithm = 0;
+            m_envmap_bake_width = 2048;     // height is half the width
 
             m_enable_gi = true;
             m_enable_caustics = false;
@@ -135,6 +138,12 @@ namespace
             m_low_priority_mode = true;
             m_use_max_procedural_maps = false;
             m_texture_cache_size = 1024;    // value in MB
+            m_enable_texture_conversion = false;
+            m_optimize_meshes = false;
+            m_stream_tiles_to_disk = false;
+            m_enable_checkpoints = false;
+            m_interactive_max_fps = 10;
+            m_enable_navigation_mode = true;
 
             const int log_open_mode = load_system_setting(L"LogOpenMode", static_cast<int>(DialogLogTarget::OpenMode::Errors));
             m_log_open_mode = static_cast<DialogLogTarget::OpenMode>(log_open_mode);
@@ -367,6 +376,7 @@ void RendererSettings::apply_settings_to_interactive_config(asr::Project& projec
     params.insert_path("sample_generator", "generic");
     params.insert_path("sample_renderer", "generic");
     params.insert_path("lighting_engine", "pt");
+    params.insert_path("progressive_frame_renderer.max_fps", m_interactive_max_fps);
 
     if (m_rendering_threads == 0)
         params.insert_path("rendering_threads", "-1");  // keep one logical core free for UI tasks in ActiveShade mode
@@ -431,6 +441,14 @@ bool RendererSettings::save(ISave* isave) const
         success &= write<bool>(isave, m_enable_noise_seed);
         isave->EndChunk();
 
+        isave->BeginChunk(ChunkSettingsTimeLimit);
+        success &= write<int>(isave, m_time_limit);
+        isave->EndChunk();
+
+        isave->BeginChunk(ChunkSettingsTargetSamplesPerPixel);
+        success &= write<int>(isave, m_target_samples_per_pixel);
+        isave->EndChunk();
+
     isave->EndChunk();
 
     //
@@ -451,6 +469,10 @@ bool RendererSettings::save(ISave* isave) const
         success &= write<bool>(isave, m_enable_light_importance_sampling);
         isave->EndChunk();
 
+        isave->BeginChunk(ChunkSettingsLightingEnvMapBakeWidth);
+        success &= write<int>(isave, m_envmap_bake_width);
+        isave->EndChunk();
+
     isave->EndChunk();
 
     //
@@ -761,6 +783,34 @@ bool RendererSettings::save(ISave* isave) const
         isave->BeginChunk(ChunkSettingsSystemTextureCacheSize);
         success &= write<std::uint64_t>(isave, m_texture_cache_size);
         isave->EndChunk();
+
+        isave->BeginChunk(ChunkSettingsSystemEnableTextureConversion);
+        success &= write<bool>(isave, m_enable_texture_conversion);
+        isave->EndChunk();
+
+        isave->BeginChunk(ChunkSettingsSystemTextureConversionPath);
+        success &= write(isave, m_texture_conversion_path);
+        isave->EndChunk();
+
+        isave->BeginChunk(ChunkSettingsSystemOptimizeMeshes);
+        success &= write<bool>(isave, m_optimize_meshes);
+        isave->EndChunk();
+
+        isave->BeginChunk(ChunkSettingsSystemStreamTilesToDisk);
+        success &= write<bool>(isave, m_stream_tiles_to_disk);
+        isave->EndChunk();
+
+        isave->BeginChunk(ChunkSettingsSystemEnableCheckpoints);
+        success &= write<bool>(isave, m_enable_checkpoints);
+        isave->EndChunk();
+
+        isave->BeginChunk(ChunkSettingsSystemInteractiveMaxFPS);
+        success &= write<int>(isave, m_interactive_max_fps);
+        isave->EndChunk();
+
+        isave->BeginChunk(ChunkSettingsSystemEnableNavigationMode);
+        success &= write<bool>(isave, m_enable_navigation_mode);
+        isave->EndChunk();
         
     isave->EndChunk();
 
@@ -882,6 +932,14 @@ IOResult RendererSettings::load_image_sampling_settings(ILoad* iload)
           case ChunkSettingsEnableNoiseSeed:
             result = read<bool>(iload, &m_enable_noise_seed);
             break;
+
+          case ChunkSettingsTimeLimit:
+            result = read<int>(iload, &m_time_limit);
+            break;
+
+          case ChunkSettingsTargetSamplesPerPixel:
+            result = read<int>(iload, &m_target_samples_per_pixel);
+            break;
         }
 
         if (result != IO_OK)
@@ -1240,6 +1298,34 @@ IOResult RendererSettings::load_system_settings(ILoad* iload)
           case ChunkSettingsSystemTextureCacheSize:
             result = read<std::uint64_t>(iload, &m_texture_cache_size);
             break;
+
+          case ChunkSettingsSystemEnableTextureConversion:
+            result = read<bool>(iload, &m_enable_texture_conversion);
+            break;
+
+          case ChunkSettingsSystemTextureConversionPath:
+            result = read(iload, &m_texture_conversion_path);
+            break;
+
+          case ChunkSettingsSystemOptimizeMeshes:
+            result = read<bool>(iload, &m_optimize_meshes);
+            break;
+
+          case ChunkSettingsSystemStreamTilesToDisk:
+            result = read<bool>(iload, &m_stream_tiles_to_disk);
+            break;
+
+          case ChunkSettingsSystemEnableCheckpoints:
+            result = read<bool>(iload, &m_enable_checkpoints);
+            break;
+
+          case ChunkSettingsSystemInteractiveMaxFPS:
+            result = read<int>(iload, &m_interactive_max_fps);
+            break;
+
+          case ChunkSettingsSystemEnableNavigationMode:
+            result = read<bool>(iload, &m_enable_navigation_mode);
+            break;
         }
 
         if (result != IO_OK)
@@ -1332,6 +1418,10 @@ IOResult RendererSettings::load_lighting_settings(ILoad* iload)
           case ChunkSettingsEnableLightImportanceSampling:
             result = read<bool>(iload, &m_enable_light_importance_sampling);
             break;
+
+          case ChunkSettingsLightingEnvMapBakeWidth:
+            result = read<int>(iload, &m_envmap_bake_width);
+            break;
         }
 
         if (result != IO_OK)
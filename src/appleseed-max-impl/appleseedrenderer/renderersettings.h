@@ -60,6 +60,8 @@ class RendererSettings
     int                         m_sampler_type;
     int                         m_noise_seed;
     bool                        m_enable_noise_seed;
+    int                         m_time_limit;                   // in minutes, 0 = no limit
+    int                         m_target_samples_per_pixel;     // 0 = no target
 
     //
     // Uniform Pixel Sampler.
@@ -92,6 +94,7 @@ class RendererSettings
     bool                        m_force_off_default_lights;
     bool                        m_enable_light_importance_sampling;
     int                         m_light_sampling_algorithm;
+    int                         m_envmap_bake_width;
 
     //
     // Path Tracer.
@@ -191,6 +194,13 @@ class RendererSettings
     DialogLogTarget::OpenMode   m_log_open_mode;
     bool                        m_log_material_editor_messages;
     std::uint64_t               m_texture_cache_size;
+    bool                        m_enable_texture_conversion;
+    MSTR                        m_texture_conversion_path;     // empty = 3ds Max's temporary directory
+    bool                        m_optimize_meshes;
+    bool                        m_stream_tiles_to_disk;
+    bool                        m_enable_checkpoints;
+    int                         m_interactive_max_fps;
+    bool                        m_enable_navigation_mode;
 
     // Apply these settings to a given project.
     void apply(renderer::Project& project) const;
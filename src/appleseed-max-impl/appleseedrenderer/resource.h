@@ -228,6 +228,23 @@
 #define IDC_CHECK_OVERRIDE_MATERIAL_SKIP_LIGHTS         457
 #define IDC_CHECK_OVERRIDE_MATERIAL_SKIP_GLASS          458
 
+#define IDC_CHECK_TEXTURE_CONVERSION                    947
+#define IDC_STATIC_TEXTURE_CONVERSION_PATH              948
+#define IDC_TEXT_TEXTURE_CONVERSION_PATH                949
+#define IDC_BUTTON_BROWSE_TEXTURE_CONVERSION_PATH       950
+#define IDC_TEXT_ENVMAP_BAKE_WIDTH                      951
+#define IDC_SPINNER_ENVMAP_BAKE_WIDTH                   952
+#define IDC_CHECK_OPTIMIZE_MESHES                       953
+#define IDC_CHECK_STREAM_TILES_TO_DISK                  954
+#define IDC_CHECK_ENABLE_CHECKPOINTS                    955
+#define IDC_TEXT_TIME_LIMIT                             956
+#define IDC_SPINNER_TIME_LIMIT                          957
+#define IDC_TEXT_TARGET_SAMPLES                         958
+#define IDC_SPINNER_TARGET_SAMPLES                      959
+#define IDC_TEXT_INTERACTIVE_MAX_FPS                    960
+#define IDC_SPINNER_INTERACTIVE_MAX_FPS                 961
+#define IDC_CHECK_NAVIGATION_MODE                       962
+
 // Next default values for new objects
 // 
 #ifdef APSTUDIO_INVOKED
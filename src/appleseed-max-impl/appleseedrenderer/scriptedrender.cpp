@@ -0,0 +1,146 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2015-2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Interface header.
+#include "scriptedrender.h"
+
+// Build options header.
+#include "foundation/core/buildoptions.h"
+
+// 3ds Max headers.
+#include "appleseed-max-common/_beginmaxheaders.h"
+#include <bitmap.h>
+#include <maxapi.h>
+#include <object.h>
+#include "appleseed-max-common/_endmaxheaders.h"
+
+// Windows headers.
+#include <Windows.h>
+
+
+//
+// ScriptedRenderProgressCallback class implementation.
+//
+
+ScriptedRenderProgressCallback::ScriptedRenderProgressCallback()
+  : m_aborted(false)
+{
+}
+
+void ScriptedRenderProgressCallback::SetTitle(const MCHAR* title)
+{
+}
+
+namespace
+{
+    // Return true if a window of 3ds Max, such as the main window or the frame buffer, has the focus.
+    bool is_max_foreground()
+    {
+        DWORD process_id = 0;
+        GetWindowThreadProcessId(GetForegroundWindow(), &process_id);
+        return process_id == GetCurrentProcessId();
+    }
+}
+
+int ScriptedRenderProgressCallback::Progress(int done, int total)
+{
+    // MAXScript calls block the UI thread, so Escape is not seen by 3ds Max's own checks
+    // unless it was pressed in one of its windows; poll the keyboard directly in that case.
+    if (!m_aborted &&
+        (GetCOREInterface()->CheckForRenderAbort() ||
+         (is_max_foreground() && (GetAsyncKeyState(VK_ESCAPE) & 0x8000) != 0)))
+        m_aborted = true;
+
+    return m_aborted ? RENDPROG_ABORT : RENDPROG_CONTINUE;
+}
+
+bool ScriptedRenderProgressCallback::is_aborted() const
+{
+    return m_aborted;
+}
+
+
+//
+// ScriptedRenderParams class implementation.
+//
+
+ScriptedRenderParams::ScriptedRenderParams(const TimeValue time)
+{
+    Interface* max_interface = GetCOREInterface();
+
+    m_rend_params.inMtlEdit = false;
+    m_rend_params.rendType = RENDTYPE_NORMAL;
+    m_rend_params.envMap = max_interface->GetUseEnvironmentMap() ? max_interface->GetEnvironmentMap() : nullptr;
+
+    m_frame_rend_params.background = Color(max_interface->GetBackGround(time, FOREVER));
+    m_frame_rend_params.regxmin = m_frame_rend_params.regymin = 0;
+    m_frame_rend_params.regxmax = m_frame_rend_params.regymax = 1;
+
+    BitmapInfo bi;
+    bi.SetWidth(static_cast<WORD>(max_interface->GetRendWidth()));
+    bi.SetHeight(static_cast<WORD>(max_interface->GetRendHeight()));
+    bi.SetType(BMM_FLOAT_RGBA_32);
+    m_bitmap = TheManager->Create(&bi);
+}
+
+ScriptedRenderParams::~ScriptedRenderParams()
+{
+    m_bitmap->DeleteThis();
+}
+
+
+//
+// Scene functions implementation.
+//
+
+bool is_camera_node(INode* node, const TimeValue time)
+{
+    if (node == nullptr)
+        return false;
+
+    const ObjectState object_state = node->EvalWorldState(time);
+    return
+        object_state.obj != nullptr &&
+        object_state.obj->SuperClassID() == CAMERA_CLASS_ID;
+}
+
+std::vector<DefaultLight> get_default_lights(INode* camera_node, const TimeValue time)
+{
+    DefaultLight light;
+    light.ls.intens = 1.0f;
+    light.ls.color = Color(1.0f, 1.0f, 1.0f);
+    light.ls.type = DIRECT_LGT;
+    light.ls.on = TRUE;
+    light.ls.affectDiffuse = TRUE;
+    light.ls.affectSpecular = TRUE;
+    light.ls.ambientOnly = FALSE;
+    light.tm = camera_node->GetObjTMAfterWSM(time);
+    light.ls.tm = light.tm;
+
+    return std::vector<DefaultLight>(1, light);
+}
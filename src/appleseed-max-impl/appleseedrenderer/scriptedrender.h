@@ -0,0 +1,91 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2015-2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+// Build options header.
+#include "foundation/core/buildoptions.h"
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+
+// 3ds Max headers.
+#include "appleseed-max-common/_beginmaxheaders.h"
+#include <maxtypes.h>
+#include <render.h>
+#include "appleseed-max-common/_endmaxheaders.h"
+
+// Standard headers.
+#include <vector>
+
+// Forward declarations.
+class Bitmap;
+class INode;
+
+//
+// Helpers shared by renders and exports started from MAXScript, which happen outside of
+// Renderer::Open() and Renderer::Render() and therefore don't get their parameters from 3ds Max.
+//
+
+// Progress callback with no progress display. Pressing Escape in 3ds Max cancels the operation:
+// once it has been pressed, Progress() keeps returning RENDPROG_ABORT.
+class ScriptedRenderProgressCallback
+  : public RendProgressCallback
+{
+  public:
+    ScriptedRenderProgressCallback();
+
+    void SetTitle(const MCHAR* title) override;
+    int Progress(int done, int total) override;
+
+    bool is_aborted() const;
+
+  private:
+    bool m_aborted;
+};
+
+// Render parameters, frame parameters and output bitmap for rendering the current scene at a
+// given time. The bitmap has the resolution of the render settings.
+class ScriptedRenderParams
+  : public foundation::NonCopyable
+{
+  public:
+    explicit ScriptedRenderParams(const TimeValue time);
+    ~ScriptedRenderParams();
+
+    RendParams                  m_rend_params;
+    FrameRendParams             m_frame_rend_params;
+    Bitmap*                     m_bitmap;
+};
+
+// Return true if a node is a camera at a given time.
+bool is_camera_node(INode* node, const TimeValue time);
+
+// Return the default lights 3ds Max would hand to Renderer::Open() when rendering from a
+// camera: a single directional light placed at the camera and shining along its view.
+std::vector<DefaultLight> get_default_lights(INode* camera_node, const TimeValue time);
@@ -29,10 +29,14 @@
 // Interface header.
 #include "tilecallback.h"
 
+// appleseed-max headers.
+#include "appleseedrenderer/tilestreamer.h"
+
 // Build options header.
 #include "foundation/core/buildoptions.h"
 
 // appleseed.renderer headers.
+#include "renderer/api/aov.h"
 #include "renderer/api/frame.h"
 
 // appleseed.foundation headers.
@@ -131,9 +135,13 @@ namespace
 
 TileCallback::TileCallback(
     Bitmap*                 bitmap,
-    volatile std::uint32_t* rendered_tile_count)
+    volatile std::uint32_t* rendered_tile_count,
+    const AOVBitmapMap&     aov_bitmaps,
+    TileStreamer*           tile_streamer)
   : m_bitmap(bitmap)
   , m_rendered_tile_count(rendered_tile_count)
+  , m_aov_bitmaps(aov_bitmaps)
+  , m_tile_streamer(tile_streamer)
 {
 }
 
@@ -193,17 +201,32 @@ void TileCallback::on_tile_end(
     const size_t y = tile_y * props.m_tile_height;
 
     // Blit the tile to the destination bitmap.
-    blit_tile(*frame, tile_x, tile_y);
+    blit_tile(image, m_bitmap, tile_x, tile_y);
 
     // Partially refresh the display window.
     // Note that Bitmap::RefreshWindow() must be called from the UI thread.
     RECT rect = make_rect(x, y, tile.get_width(), tile.get_height());
     m_bitmap->RefreshWindow(&rect);
 
+    // Blit the AOV tiles to the render element bitmaps.
+    blit_aov_tiles(*frame, tile_x, tile_y);
+
+    // Write the tiles to disk.
+    if (m_tile_streamer != nullptr)
+        m_tile_streamer->write_tile(*frame, tile_x, tile_y);
+
     // Keep track of the number of rendered tiles.
     asf::atomic_inc(m_rendered_tile_count);
 }
 
+void TileCallback::on_tiled_frame_end(
+    const asr::Frame*       frame)
+{
+    // Streamed tiles are read from the frame: finish writing them before post-processing.
+    if (m_tile_streamer != nullptr)
+        m_tile_streamer->flush();
+}
+
 void TileCallback::on_progressive_frame_update(
     const asr::Frame&       frame,
     const double            time,
@@ -221,62 +244,185 @@ void TileCallback::on_progressive_frame_update(
     for (size_t y = 0; y < props.m_tile_count_y; ++y)
     {
         for (size_t x = 0; x < props.m_tile_count_x; ++x)
-            blit_tile(frame, x, y);
+        {
+            blit_tile(frame.image(), m_bitmap, x, y);
+            blit_aov_tiles(frame, x, y);
+        }
     }
 
     // Refresh the entire display window.
     // Note that Bitmap::RefreshWindow() must be called from the UI thread.
     m_bitmap->RefreshWindow();
+
+    for (const auto& aov_bitmap : m_aov_bitmaps)
+        aov_bitmap.second->RefreshWindow();
+}
+
+void TileCallback::blit_image(const asf::Image& image)
+{
+    const asf::CanvasProperties& props = image.properties();
+
+    DbgAssert(props.m_canvas_width == m_bitmap->Width());
+    DbgAssert(props.m_canvas_height == m_bitmap->Height());
+
+    for (size_t y = 0; y < props.m_tile_count_y; ++y)
+    {
+        for (size_t x = 0; x < props.m_tile_count_x; ++x)
+            blit_tile(image, m_bitmap, x, y);
+    }
+
+    m_bitmap->RefreshWindow();
 }
 
 void TileCallback::blit_tile(
-    const asr::Frame&       frame,
+    const asf::Image&       image,
+    Bitmap*                 bitmap,
     const size_t            tile_x,
     const size_t            tile_y)
 {
-    const asf::CanvasProperties& props = frame.image().properties();
+    static_assert(
+        sizeof(BMM_Color_fl) == sizeof(asf::Color4f),
+        "BMM_Color_fl is expected to be the same size of foundation::Color4f");
+
+    // Blit the tile into the bitmap, one row at a time.
+    read_tile(
+        image,
+        tile_x,
+        tile_y,
+        [bitmap](const size_t x, const size_t y, const size_t width, const asf::Color4f* row)
+        {
+            // Bitmap::PutPixels() does not modify the pixels it's given.
+            bitmap->PutPixels(
+                static_cast<int>(x),
+                static_cast<int>(y),
+                static_cast<int>(width),
+                const_cast<BMM_Color_fl*>(reinterpret_cast<const BMM_Color_fl*>(row)));
+        });
+}
+
+void TileCallback::copy_image(
+    const asf::Image&       image,
+    asf::Color4f*           pixels)
+{
+    const asf::CanvasProperties& props = image.properties();
 
-    // Allocate memory for the temporary tile.
-    if (m_float_tile_storage.get() == nullptr)
+    for (size_t tile_y = 0; tile_y < props.m_tile_count_y; ++tile_y)
     {
-        m_float_tile_storage.reset(
-            new asf::Tile(
-                props.m_tile_width,
-                props.m_tile_height,
-                props.m_channel_count,
-                asf::PixelFormatFloat));
+        for (size_t tile_x = 0; tile_x < props.m_tile_count_x; ++tile_x)
+        {
+            read_tile(
+                image,
+                tile_x,
+                tile_y,
+                [pixels, &props](const size_t x, const size_t y, const size_t width, const asf::Color4f* row)
+                {
+                    std::copy(row, row + width, pixels + y * props.m_canvas_width + x);
+                });
+        }
     }
+}
+
+void TileCallback::read_tile(
+    const asf::Image&       image,
+    const size_t            tile_x,
+    const size_t            tile_y,
+    const RowCallback&      row_callback)
+{
+    const asf::CanvasProperties& props = image.properties();
 
     // Retrieve the source tile.
-    const asf::Tile& tile = frame.image().tile(tile_x, tile_y);
+    const asf::Tile& tile = image.tile(tile_x, tile_y);
+    const size_t channel_count = tile.get_channel_count();
+    DbgAssert(channel_count >= 1 && channel_count <= 4);
+
+    if (m_row_storage.empty())
+        m_row_storage.resize(props.m_tile_width);
 
-    // Convert the tile to 32-bit floating point.
-    asf::Tile fp_tile(
-        tile,
-        asf::PixelFormatFloat,
-        m_float_tile_storage->get_storage());
+    // Frame and AOV tiles are stored in 32-bit floating point and are read in place.
+    // Tiles in other formats are converted to 32-bit floating point first.
+    const asf::Tile* fp_tile = &tile;
+    std::unique_ptr<asf::Tile> converted_tile;
+    if (tile.get_pixel_format() != asf::PixelFormatFloat)
+    {
+        // Allocate memory for the temporary tile, large enough for tiles of up to four channels.
+        if (m_float_tile_storage.get() == nullptr)
+        {
+            m_float_tile_storage.reset(
+                new asf::Tile(
+                    props.m_tile_width,
+                    props.m_tile_height,
+                    4,
+                    asf::PixelFormatFloat));
+        }
 
-    // Blit the time into the bitmap.
+        converted_tile.reset(
+            new asf::Tile(
+                tile,
+                asf::PixelFormatFloat,
+                m_float_tile_storage->get_storage()));
+        fp_tile = converted_tile.get();
+    }
+
+    // Read the tile one row at a time.
     const size_t dest_x = tile_x * props.m_tile_width;
     const size_t dest_y = tile_y * props.m_tile_height;
-    const size_t tile_width = fp_tile.get_width();
-    const size_t tile_height = fp_tile.get_height();
+    const size_t tile_width = fp_tile->get_width();
+    const size_t tile_height = fp_tile->get_height();
     for (size_t y = 0; y < tile_height; ++y)
     {
-        for (size_t x = 0; x < tile_width; ++x)
+        const asf::Color4f* row = reinterpret_cast<const asf::Color4f*>(fp_tile->pixel(0, y));
+
+        // Expand the pixels of tiles with less than four channels, such as those of some AOVs.
+        if (channel_count < 4)
         {
-            static_assert(
-                sizeof(BMM_Color_fl) == sizeof(asf::Color4f),
-                "BMM_Color_fl is expected to be the same size of foundation::Color4f");
-
-            asf::Color4f color;
-            fp_tile.get_pixel(x, y, color);
-
-            m_bitmap->PutPixels(
-                static_cast<int>(dest_x + x),
-                static_cast<int>(dest_y + y),
-                1,
-                reinterpret_cast<BMM_Color_fl*>(&color));
+            const float* source = reinterpret_cast<const float*>(fp_tile->pixel(0, y));
+            for (size_t x = 0; x < tile_width; ++x, source += channel_count)
+            {
+                m_row_storage[x] =
+                    channel_count == 1 ? asf::Color4f(source[0], source[0], source[0], 1.0f) :
+                    channel_count == 2 ? asf::Color4f(source[0], source[1], 0.0f, 1.0f) :
+                                         asf::Color4f(source[0], source[1], source[2], 1.0f);
+            }
+
+            row = m_row_storage.data();
         }
+
+        row_callback(dest_x, dest_y + y, tile_width, row);
+    }
+}
+
+void TileCallback::blit_aov_tiles(
+    const asr::Frame&       frame,
+    const size_t            tile_x,
+    const size_t            tile_y)
+{
+    if (m_aov_bitmaps.empty())
+        return;
+
+    for (const asr::AOV& aov : frame.aovs())
+    {
+        const auto it = m_aov_bitmaps.find(aov.get_name());
+        if (it == m_aov_bitmaps.end())
+            continue;
+
+        const asf::Image& image = aov.get_image();
+        const asf::CanvasProperties& props = image.properties();
+
+        Bitmap* bitmap = it->second;
+        if (static_cast<int>(props.m_canvas_width) != bitmap->Width() ||
+            static_cast<int>(props.m_canvas_height) != bitmap->Height())
+            continue;
+
+        blit_tile(image, bitmap, tile_x, tile_y);
+
+        // Note that Bitmap::RefreshWindow() must be called from the UI thread.
+        const asf::Tile& tile = image.tile(tile_x, tile_y);
+        RECT rect =
+            make_rect(
+                tile_x * props.m_tile_width,
+                tile_y * props.m_tile_height,
+                tile.get_width(),
+                tile.get_height());
+        bitmap->RefreshWindow(&rect);
     }
 }
@@ -35,16 +35,26 @@
 #include "renderer/api/rendering.h"
 
 // appleseed.foundation headers.
+#include "foundation/image/color.h"
 #include "foundation/image/tile.h"
 
 // Standard headers.
 #include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <map>
 #include <memory>
+#include <string>
+#include <vector>
 
 // Forward declarations.
-namespace renderer  { class Frame; }
+namespace foundation    { class Image; }
+namespace renderer      { class Frame; }
 class Bitmap;
+class TileStreamer;
+
+// Bitmaps of render elements, indexed by the name of the AOV they display.
+typedef std::map<std::string, Bitmap*> AOVBitmapMap;
 
 class TileCallback
   : public renderer::TileCallbackBase
@@ -52,7 +62,9 @@ class TileCallback
   public:
     TileCallback(
         Bitmap*                         bitmap,
-        volatile std::uint32_t*         rendered_tile_count);
+        volatile std::uint32_t*         rendered_tile_count,
+        const AOVBitmapMap&             aov_bitmaps = AOVBitmapMap(),
+        TileStreamer*                   tile_streamer = nullptr);
 
     void release() override;
 
@@ -66,6 +78,9 @@ class TileCallback
         const size_t                    tile_x,
         const size_t                    tile_y) override;
 
+    void on_tiled_frame_end(
+        const renderer::Frame*          frame) override;
+
     void on_progressive_frame_update(
         const renderer::Frame&          frame,
         const double                    time,
@@ -73,13 +88,41 @@ class TileCallback
         const double                    samples_per_pixel,
         const std::uint64_t             samples_per_second) override;
 
+    // Copy a whole image of the size of the bitmap into the bitmap.
+    void blit_image(const foundation::Image& image);
+
+  protected:
+    // Copy a whole image into an array of 32-bit floating point RGBA pixels, in scanline order.
+    void copy_image(
+        const foundation::Image&        image,
+        foundation::Color4f*            pixels);
+
   private:
     Bitmap*                             m_bitmap;
     volatile std::uint32_t*             m_rendered_tile_count;
+    const AOVBitmapMap                  m_aov_bitmaps;
+    TileStreamer*                       m_tile_streamer;
     std::unique_ptr<foundation::Tile>   m_float_tile_storage;
+    std::vector<foundation::Color4f>    m_row_storage;
 
     void blit_tile(
+        const foundation::Image&        image,
+        Bitmap*                         bitmap,
+        const size_t                    tile_x,
+        const size_t                    tile_y);
+
+    void blit_aov_tiles(
         const renderer::Frame&          frame,
         const size_t                    tile_x,
         const size_t                    tile_y);
+
+    // Called with the position in the image, the width and the pixels of each row of a tile.
+    typedef std::function<void (size_t x, size_t y, size_t width, const foundation::Color4f* row)> RowCallback;
+
+    // Read the rows of a tile as 32-bit floating point RGBA pixels.
+    void read_tile(
+        const foundation::Image&        image,
+        const size_t                    tile_x,
+        const size_t                    tile_y,
+        const RowCallback&              row_callback);
 };
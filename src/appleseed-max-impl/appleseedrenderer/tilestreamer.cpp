@@ -0,0 +1,178 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2015-2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Interface header.
+#include "tilestreamer.h"
+
+// appleseed-max headers.
+#include "appleseedrenderer/backgroundwriter.h"
+#include "utilities.h"
+
+// appleseed.renderer headers.
+#include "renderer/api/aov.h"
+#include "renderer/api/frame.h"
+#include "renderer/api/log.h"
+
+// appleseed.foundation headers.
+#include "foundation/core/exceptions/exception.h"
+#include "foundation/image/image.h"
+#include "foundation/image/imageattributes.h"
+#include "foundation/image/progressiveexrimagefilewriter.h"
+#include "foundation/image/tile.h"
+
+// Boost headers.
+#include "boost/filesystem.hpp"
+
+// Standard headers.
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace asf = foundation;
+namespace asr = renderer;
+namespace bf = boost::filesystem;
+
+
+//
+// TileStreamer class implementation.
+//
+
+namespace
+{
+    struct Stream
+    {
+        const asf::Image*                                       m_image;
+        std::string                                             m_filepath;
+        std::shared_ptr<asf::ProgressiveEXRImageFileWriter>     m_writer;
+    };
+}
+
+struct TileStreamer::Impl
+{
+    std::vector<Stream>     m_streams;
+
+    // A single thread writes the tiles, in the order they were rendered.
+    BackgroundWriter        m_background_writer;
+
+    Impl()
+      : m_background_writer(1, 256)
+    {
+    }
+
+    void open(
+        const asf::Image&   image,
+        const std::string&  filepath)
+    {
+        Stream stream;
+        stream.m_image = &image;
+        stream.m_filepath = filepath;
+        stream.m_writer = std::make_shared<asf::ProgressiveEXRImageFileWriter>(&asr::global_logger());
+
+        try
+        {
+            stream.m_writer->open(
+                filepath.c_str(),
+                image.properties(),
+                asf::ImageAttributes::create_default_attributes());
+        }
+        catch (const asf::Exception& e)
+        {
+            RENDERER_LOG_ERROR("failed to open %s for writing: %s", filepath.c_str(), e.what());
+            return;
+        }
+
+        RENDERER_LOG_INFO("streaming tiles to %s...", filepath.c_str());
+        m_streams.push_back(stream);
+    }
+
+    void close()
+    {
+        m_background_writer.stop();
+
+        for (auto& stream : m_streams)
+            stream.m_writer->close();
+
+        m_streams.clear();
+    }
+};
+
+TileStreamer::TileStreamer(
+    const asr::Frame&       frame,
+    const std::string&      path_prefix)
+  : impl(new Impl())
+{
+    impl->open(frame.image(), path_prefix + ".beauty.exr");
+
+    for (const asr::AOV& aov : frame.aovs())
+        impl->open(aov.get_image(), path_prefix + "." + aov.get_name() + ".exr");
+}
+
+TileStreamer::~TileStreamer()
+{
+    impl->close();
+    delete impl;
+}
+
+void TileStreamer::write_tile(
+    const asr::Frame&       frame,
+    const size_t            tile_x,
+    const size_t            tile_y)
+{
+    for (const auto& stream : impl->m_streams)
+    {
+        // The tile is final and is not copied: flush() is called before the frame changes again.
+        const asf::Tile* tile = &stream.m_image->tile(tile_x, tile_y);
+        const auto writer = stream.m_writer;
+
+        impl->m_background_writer.schedule(
+            [writer, tile, tile_x, tile_y]()
+            {
+                writer->write_tile(*tile, tile_x, tile_y);
+            });
+    }
+}
+
+void TileStreamer::flush()
+{
+    impl->m_background_writer.wait();
+}
+
+void TileStreamer::remove_files()
+{
+    std::vector<std::string> filepaths;
+    for (const auto& stream : impl->m_streams)
+        filepaths.push_back(stream.m_filepath);
+
+    impl->close();
+
+    for (const auto& filepath : filepaths)
+    {
+        boost::system::error_code ec;
+        bf::remove(bf::path(utf8_to_wide(filepath)), ec);
+    }
+}
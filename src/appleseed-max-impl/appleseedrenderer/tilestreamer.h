@@ -0,0 +1,78 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2015-2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+// Build options header.
+#include "foundation/core/buildoptions.h"
+
+// appleseed.foundation headers.
+#include "foundation/core/concepts/noncopyable.h"
+
+// Standard headers.
+#include <cstddef>
+#include <string>
+
+// Forward declarations.
+namespace renderer  { class Frame; }
+
+//
+// Write the tiles of a frame and of its AOVs to tiled OpenEXR files as soon as they are
+// rendered, so that a crashed or interrupted render leaves a partial image behind. This does
+// not reduce memory use: the frame keeps all its tiles. Tiles are written straight from the
+// frame by a background thread; each tile must only be written once, and the frame must not
+// be modified before flush() returns.
+//
+
+class TileStreamer
+  : public foundation::NonCopyable
+{
+  public:
+    // Open one file per image of the frame, named <path prefix>.<image name>.exr.
+    TileStreamer(
+        const renderer::Frame&          frame,
+        const std::string&              path_prefix);
+
+    // Wait until all tiles are written then close the files.
+    ~TileStreamer();
+
+    void write_tile(
+        const renderer::Frame&          frame,
+        const size_t                    tile_x,
+        const size_t                    tile_y);
+
+    // Wait until all scheduled tiles are written, e.g. before post-processing modifies the frame.
+    void flush();
+
+    // Close the files and delete them, once the final images of the render are saved.
+    void remove_files();
+
+  private:
+    struct Impl;
+    Impl* impl;
+};
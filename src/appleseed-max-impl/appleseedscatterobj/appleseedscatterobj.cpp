@@ -0,0 +1,825 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2015-2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Interface header.
+#include "appleseedscatterobj.h"
+
+// appleseed-max headers.
+#include "appleseedscatterobj/resource.h"
+#include "main.h"
+
+// Build options header.
+#include "foundation/core/buildoptions.h"
+
+// 3ds Max headers.
+#include "appleseed-max-common/_beginmaxheaders.h"
+#include <bitmap.h>
+#include <gfx.h>
+#include <imtl.h>
+#include <maxapi.h>
+#include <mouseman.h>
+#include <paramtype.h>
+#include <triobj.h>
+#include "appleseed-max-common/_endmaxheaders.h"
+
+// Standard headers.
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+
+AppleseedScatterObjClassDesc g_appleseed_scatterobj_classdesc;
+
+
+//
+// AppleseedScatterObj class implementation.
+//
+
+namespace
+{
+    enum { ParamBlockIdScatterObj };
+    enum { ParamBlockRefScatterObj };
+
+    enum ParamMapId
+    {
+        ParamMapIdScatter
+    };
+
+    enum ParamId
+    {
+        // Changing these value WILL break compatibility.
+        ParamIdSourceNodes                  = 0,
+        ParamIdSurfaceNode                  = 1,
+        ParamIdCount                        = 2,
+        ParamIdSeed                         = 3,
+        ParamIdDensityMap                   = 4,
+        ParamIdScaleMin                     = 5,
+        ParamIdScaleMax                     = 6,
+        ParamIdAlignToNormal                = 7,
+        ParamIdRandomRotation               = 8
+    };
+
+    ParamBlockDesc2 g_block_desc(
+        // --- Required arguments ---
+        ParamBlockIdScatterObj,                     // parameter block's ID
+        L"appleseedScatterObjParams",               // internal parameter block's name
+        0,                                          // ID of the localized name string
+        &g_appleseed_scatterobj_classdesc,          // class descriptor
+        P_AUTO_CONSTRUCT + P_MULTIMAP + P_AUTO_UI,  // block flags
+
+        // --- P_AUTO_CONSTRUCT arguments ---
+        ParamBlockRefScatterObj,                    // parameter block's reference number
+
+        // --- P_MULTIMAP arguments ---
+        1,                                          // number of rollups
+
+        // --- P_AUTO_UI arguments for Scatter rollup ---
+        ParamMapIdScatter,
+        IDD_FORMVIEW_PARAMS,                        // ID of the dialog template
+        IDS_FORMVIEW_PARAMS_TITLE,                  // ID of the dialog's title string
+        0,                                          // IParamMap2 creation/deletion flag mask
+        0,                                          // rollup creation flag
+        nullptr,                                    // user dialog procedure
+
+        // --- Parameters specifications ---
+
+        ParamIdSourceNodes, L"source_nodes", TYPE_INODE_TAB, 0, P_VARIABLE_SIZE, IDS_SOURCES,
+            p_ui, ParamMapIdScatter, TYPE_NODELISTBOX, IDC_LIST_SOURCES, IDC_BUTTON_ADD_SOURCE, 0, IDC_BUTTON_REMOVE_SOURCE,
+        p_end,
+        ParamIdSurfaceNode, L"surface_node", TYPE_INODE, 0, IDS_SURFACE,
+            p_ui, ParamMapIdScatter, TYPE_PICKNODEBUTTON, IDC_BUTTON_SURFACE,
+            p_prompt, IDS_PICK_SURFACE,
+        p_end,
+        ParamIdCount, L"count", TYPE_INT, 0, IDS_COUNT,
+            p_default, 1000,
+            p_range, 0, 10000000,
+            p_ui, ParamMapIdScatter, TYPE_SPINNER, EDITTYPE_INT, IDC_EDIT_COUNT, IDC_SPINNER_COUNT, SPIN_AUTOSCALE,
+        p_end,
+        ParamIdSeed, L"seed", TYPE_INT, 0, IDS_SEED,
+            p_default, 0,
+            p_range, 0, 1000000,
+            p_ui, ParamMapIdScatter, TYPE_SPINNER, EDITTYPE_INT, IDC_EDIT_SEED, IDC_SPINNER_SEED, SPIN_AUTOSCALE,
+        p_end,
+        ParamIdDensityMap, L"density_map", TYPE_TEXMAP, 0, IDS_DENSITY_MAP,
+            p_ui, ParamMapIdScatter, TYPE_TEXMAPBUTTON, IDC_BUTTON_DENSITY_MAP,
+        p_end,
+        ParamIdScaleMin, L"scale_min", TYPE_FLOAT, 0, IDS_SCALE_MIN,
+            p_default, 1.0f,
+            p_range, 0.0f, 1000.0f,
+            p_ui, ParamMapIdScatter, TYPE_SPINNER, EDITTYPE_FLOAT, IDC_EDIT_SCALE_MIN, IDC_SPINNER_SCALE_MIN, SPIN_AUTOSCALE,
+        p_end,
+        ParamIdScaleMax, L"scale_max", TYPE_FLOAT, 0, IDS_SCALE_MAX,
+            p_default, 1.0f,
+            p_range, 0.0f, 1000.0f,
+            p_ui, ParamMapIdScatter, TYPE_SPINNER, EDITTYPE_FLOAT, IDC_EDIT_SCALE_MAX, IDC_SPINNER_SCALE_MAX, SPIN_AUTOSCALE,
+        p_end,
+        ParamIdAlignToNormal, L"align_to_normal", TYPE_BOOL, 0, IDS_ALIGN_TO_NORMAL,
+            p_default, TRUE,
+            p_ui, ParamMapIdScatter, TYPE_SINGLECHECKBOX, IDC_CHECK_ALIGN_TO_NORMAL,
+        p_end,
+        ParamIdRandomRotation, L"random_rotation", TYPE_BOOL, 0, IDS_RANDOM_ROTATION,
+            p_default, TRUE,
+            p_ui, ParamMapIdScatter, TYPE_SINGLECHECKBOX, IDC_CHECK_RANDOM_ROTATION,
+        p_end,
+
+        // --- The end ---
+        p_end);
+
+    // Maximum number of instances displayed in the viewports.
+    const size_t MaxDisplayedInstances = 10000;
+
+    // Half the size of the icon displayed at the position of the scatter node.
+    const float IconHalfSize = 10.0f;
+
+    // Resolution at which the density map is baked before being sampled.
+    const int DensityMapResolution = 256;
+
+    // Number of candidate positions tried for an instance before giving up on it.
+    const int MaxDensityAttempts = 16;
+
+    // Number of instances generated by a thread at a time.
+    const size_t InstanceBatchSize = 1024;
+
+    class ScatterObjCreateCallBack
+      : public CreateMouseCallBack
+    {
+      public:
+        int proc(ViewExp* vpt, int msg, int point, int flags, IPoint2 m, Matrix3& mat) override
+        {
+            switch (msg)
+            {
+              case MOUSE_POINT:
+              case MOUSE_MOVE:
+                mat.SetTrans(vpt->SnapPoint(m, m, nullptr, SNAP_IN_3D));
+                return msg == MOUSE_POINT ? CREATE_STOP : CREATE_CONTINUE;
+
+              case MOUSE_ABORT:
+                return CREATE_ABORT;
+
+              default:
+                return CREATE_CONTINUE;
+            }
+        }
+    };
+
+    ScatterObjCreateCallBack g_create_callback;
+
+    std::uint64_t mix_bits(std::uint64_t x)
+    {
+        // SplitMix64 finalizer.
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+        return x ^ (x >> 31);
+    }
+
+    // Random number generator seeded per instance, so that an instance does not depend
+    // on the number of instances, nor on the thread that generated it.
+    class InstanceRandomGenerator
+    {
+      public:
+        InstanceRandomGenerator(const std::uint32_t seed, const size_t instance_index)
+          : m_state(mix_bits((static_cast<std::uint64_t>(seed) << 32) ^ static_cast<std::uint64_t>(instance_index)))
+        {
+        }
+
+        // Return a random number in [0, 1).
+        float next()
+        {
+            m_state += 0x9E3779B97F4A7C15ull;
+            return static_cast<float>(mix_bits(m_state) >> 40) * (1.0f / 16777216.0f);
+        }
+
+      private:
+        std::uint64_t m_state;
+    };
+
+    // Surface of the scatter, in world space.
+    struct ScatterSurface
+    {
+        std::vector<Point3>     m_vertices;
+        std::vector<Point3>     m_tex_coords;
+        std::vector<DWORD>      m_faces;            // 3 vertex indices per face
+        std::vector<DWORD>      m_tex_faces;        // 3 texture vertex indices per face, empty if the surface has no UVs
+        std::vector<float>      m_face_cdf;         // cumulated face areas
+    };
+
+    bool get_scatter_surface(INode* node, const TimeValue t, ScatterSurface& surface)
+    {
+        const ObjectState object_state = node->EvalWorldState(t);
+        if (object_state.obj == nullptr || !object_state.obj->CanConvertToType(Class_ID(TRIOBJ_CLASS_ID, 0)))
+            return false;
+
+        TriObject* tri_object = static_cast<TriObject*>(object_state.obj->ConvertToType(t, Class_ID(TRIOBJ_CLASS_ID, 0)));
+        const Mesh& mesh = tri_object->GetMesh();
+        const Matrix3 object_to_world = node->GetObjTMAfterWSM(t);
+
+        surface.m_vertices.resize(mesh.getNumVerts());
+        for (int i = 0, e = mesh.getNumVerts(); i < e; ++i)
+            surface.m_vertices[i] = object_to_world.PointTransform(mesh.getVert(i));
+
+        const int face_count = mesh.getNumFaces();
+        const bool has_tex_coords = mesh.numTVerts > 0 && mesh.tvFace != nullptr;
+
+        surface.m_faces.resize(face_count * 3);
+        for (int i = 0; i < face_count; ++i)
+        {
+            for (int j = 0; j < 3; ++j)
+                surface.m_faces[i * 3 + j] = mesh.faces[i].v[j];
+        }
+
+        if (has_tex_coords)
+        {
+            surface.m_tex_coords.assign(mesh.tVerts, mesh.tVerts + mesh.numTVerts);
+            surface.m_tex_faces.resize(face_count * 3);
+            for (int i = 0; i < face_count; ++i)
+            {
+                for (int j = 0; j < 3; ++j)
+                    surface.m_tex_faces[i * 3 + j] = mesh.tvFace[i].t[j];
+            }
+        }
+
+        if (tri_object != object_state.obj)
+            tri_object->DeleteMe();
+
+        // Faces are picked proportionally to their area.
+        surface.m_face_cdf.resize(face_count);
+        float total_area = 0.0f;
+        for (int i = 0; i < face_count; ++i)
+        {
+            const Point3& v0 = surface.m_vertices[surface.m_faces[i * 3 + 0]];
+            const Point3& v1 = surface.m_vertices[surface.m_faces[i * 3 + 1]];
+            const Point3& v2 = surface.m_vertices[surface.m_faces[i * 3 + 2]];
+            total_area += 0.5f * Length((v1 - v0) ^ (v2 - v0));
+            surface.m_face_cdf[i] = total_area;
+        }
+
+        return total_area > 0.0f;
+    }
+
+    // Bake a density map into a grid of values in [0, 1], the first row being the top of the map.
+    std::vector<float> bake_density_map(Texmap* density_map, const TimeValue t)
+    {
+        BitmapInfo bi;
+        bi.SetWidth(DensityMapResolution);
+        bi.SetHeight(DensityMapResolution);
+        bi.SetType(BMM_FLOAT_RGBA_32);
+        Bitmap* bitmap = TheManager->Create(&bi);
+        density_map->RenderBitmap(t, bitmap, 1.0f, TRUE);
+
+        std::vector<float> density(DensityMapResolution * DensityMapResolution);
+        std::vector<BMM_Color_fl> row(DensityMapResolution);
+
+        for (int y = 0; y < DensityMapResolution; ++y)
+        {
+            bitmap->GetLinearPixels(0, y, DensityMapResolution, row.data());
+            for (int x = 0; x < DensityMapResolution; ++x)
+            {
+                const BMM_Color_fl& c = row[x];
+                density[y * DensityMapResolution + x] = std::min(std::max((c.r + c.g + c.b) / 3.0f, 0.0f), 1.0f);
+            }
+        }
+
+        bitmap->DeleteThis();
+
+        return density;
+    }
+
+    float lookup_density(const std::vector<float>& density, const Point3& uv)
+    {
+        const float u = uv.x - std::floor(uv.x);
+        const float v = uv.y - std::floor(uv.y);
+        const int x = std::min(static_cast<int>(u * DensityMapResolution), DensityMapResolution - 1);
+        const int y = std::min(static_cast<int>((1.0f - v) * DensityMapResolution), DensityMapResolution - 1);
+        return density[y * DensityMapResolution + x];
+    }
+
+    Matrix3 make_instance_transform(
+        const Point3&           position,
+        const Point3&           up,
+        const float             angle,
+        const float             scale)
+    {
+        // Build an orthonormal basis around the up vector.
+        const Point3 helper = std::abs(up.z) < 0.9f ? Point3(0.0f, 0.0f, 1.0f) : Point3(1.0f, 0.0f, 0.0f);
+        const Point3 x0 = Normalize(helper ^ up);
+        const Point3 y0 = up ^ x0;
+
+        // Rotate the basis around the up vector.
+        const float cos_angle = std::cos(angle);
+        const float sin_angle = std::sin(angle);
+        const Point3 x = cos_angle * x0 + sin_angle * y0;
+        const Point3 y = cos_angle * y0 - sin_angle * x0;
+
+        Matrix3 transform(TRUE);
+        transform.SetRow(0, x * scale);
+        transform.SetRow(1, y * scale);
+        transform.SetRow(2, up * scale);
+        transform.SetRow(3, position);
+        return transform;
+    }
+}
+
+Class_ID AppleseedScatterObj::get_class_id()
+{
+    return Class_ID(0x2e7d4b91, 0x5f3a08c6);
+}
+
+AppleseedScatterObj::AppleseedScatterObj()
+  : m_pblock(nullptr)
+  , m_preview_valid(false)
+  , m_preview_time(0)
+{
+    m_preview_bbox.Init();
+    g_appleseed_scatterobj_classdesc.MakeAutoParamBlocks(this);
+}
+
+void AppleseedScatterObj::DeleteThis()
+{
+    delete this;
+}
+
+void AppleseedScatterObj::GetClassName(TSTR& s)
+{
+    s = L"appleseedScatterObj";
+}
+
+SClass_ID AppleseedScatterObj::SuperClassID()
+{
+    return GEOMOBJECT_CLASS_ID;
+}
+
+Class_ID AppleseedScatterObj::ClassID()
+{
+    return get_class_id();
+}
+
+void AppleseedScatterObj::BeginEditParams(IObjParam* ip, ULONG flags, Animatable* prev)
+{
+    g_appleseed_scatterobj_classdesc.BeginEditParams(ip, this, flags, prev);
+}
+
+void AppleseedScatterObj::EndEditParams(IObjParam* ip, ULONG flags, Animatable* next)
+{
+    g_appleseed_scatterobj_classdesc.EndEditParams(ip, this, flags, next);
+}
+
+int AppleseedScatterObj::NumSubs()
+{
+    return NumRefs();
+}
+
+Animatable* AppleseedScatterObj::SubAnim(int i)
+{
+    return GetReference(i);
+}
+
+TSTR AppleseedScatterObj::SubAnimName(int i)
+{
+    return i == ParamBlockRefScatterObj ? L"Parameters" : L"";
+}
+
+int AppleseedScatterObj::SubNumToRefNum(int subNum)
+{
+    return subNum;
+}
+
+int AppleseedScatterObj::NumParamBlocks()
+{
+    return 1;
+}
+
+IParamBlock2* AppleseedScatterObj::GetParamBlock(int i)
+{
+    return i == ParamBlockRefScatterObj ? m_pblock : nullptr;
+}
+
+IParamBlock2* AppleseedScatterObj::GetParamBlockByID(BlockID id)
+{
+    return id == m_pblock->ID() ? m_pblock : nullptr;
+}
+
+int AppleseedScatterObj::NumRefs()
+{
+    return 1;
+}
+
+RefTargetHandle AppleseedScatterObj::GetReference(int i)
+{
+    return i == ParamBlockRefScatterObj ? m_pblock : nullptr;
+}
+
+void AppleseedScatterObj::SetReference(int i, RefTargetHandle rtarg)
+{
+    if (i == ParamBlockRefScatterObj)
+    {
+        if (IParamBlock2* pblock = dynamic_cast<IParamBlock2*>(rtarg))
+            m_pblock = pblock;
+    }
+}
+
+RefResult AppleseedScatterObj::NotifyRefChanged(
+    const Interval&     changeInt,
+    RefTargetHandle     hTarget,
+    PartID&             partID,
+    RefMessage          message,
+    BOOL                propagate)
+{
+    // Changes to the surface node and to the density map are propagated by the parameter block.
+    if (hTarget == m_pblock && message == REFMSG_CHANGE)
+        m_preview_valid = false;
+
+    return REF_SUCCEED;
+}
+
+RefTargetHandle AppleseedScatterObj::Clone(RemapDir& remap)
+{
+    AppleseedScatterObj* clone = new AppleseedScatterObj();
+    clone->ReplaceReference(ParamBlockRefScatterObj, remap.CloneRef(m_pblock));
+    BaseClone(this, clone, remap);
+    return clone;
+}
+
+CreateMouseCallBack* AppleseedScatterObj::GetCreateMouseCallBack()
+{
+    return &g_create_callback;
+}
+
+const MCHAR* AppleseedScatterObj::GetObjectName()
+{
+    return L"appleseed Scatter";
+}
+
+bool AppleseedScatterObj::RequiresSupportForLegacyDisplayMode() const
+{
+    return true;
+}
+
+int AppleseedScatterObj::Display(TimeValue t, INode* inode, ViewExp* vpt, int flags)
+{
+    GraphicsWindow* gw = vpt->getGW();
+    const DWORD limits = gw->getRndLimits();
+
+    gw->setRndLimits(GW_WIREFRAME | GW_EDGES_ONLY | (limits & GW_Z_BUFFER));
+
+    if (inode->Selected())
+        gw->setColor(LINE_COLOR, GetSelColor());
+    else gw->setColor(LINE_COLOR, Color(inode->GetWireColor()));
+
+    draw(t, inode, gw);
+
+    gw->setRndLimits(limits);
+
+    return 0;
+}
+
+int AppleseedScatterObj::HitTest(TimeValue t, INode* inode, int type, int crossing, int flags, IPoint2* p, ViewExp* vpt)
+{
+    HitRegion hit_region;
+    MakeHitRegion(hit_region, type, crossing, 4, p);
+
+    GraphicsWindow* gw = vpt->getGW();
+    const DWORD limits = gw->getRndLimits();
+
+    gw->setRndLimits((limits | GW_PICK) & ~GW_ILLUM);
+    gw->setHitRegion(&hit_region);
+    gw->clearHitCode();
+
+    draw(t, inode, gw);
+
+    gw->setRndLimits(limits);
+
+    return gw->checkHitCode();
+}
+
+void AppleseedScatterObj::GetWorldBoundBox(TimeValue t, INode* inode, ViewExp* vpt, Box3& box)
+{
+    GetLocalBoundBox(t, inode, vpt, box);
+    box = box * inode->GetObjectTM(t);
+
+    // Instances are displayed in world space.
+    update_preview(t);
+    if (!m_preview_bbox.IsEmpty())
+        box += m_preview_bbox;
+}
+
+void AppleseedScatterObj::GetLocalBoundBox(TimeValue t, INode* inode, ViewExp* vpt, Box3& box)
+{
+    const Point3 half_size(IconHalfSize, IconHalfSize, IconHalfSize);
+    box = Box3(-half_size, half_size);
+}
+
+ObjectState AppleseedScatterObj::Eval(TimeValue t)
+{
+    return ObjectState(this);
+}
+
+Interval AppleseedScatterObj::ObjectValidity(TimeValue t)
+{
+    // Instances depend on the parameters, on the surface (its shape and where it is),
+    // on the source nodes and on the density map.
+    Interval validity = FOREVER;
+    m_pblock->GetValidity(t, validity);
+
+    if (INode* surface_node = m_pblock->GetINode(ParamIdSurfaceNode, t))
+    {
+        validity &= surface_node->EvalWorldState(t).Validity(t);
+        surface_node->GetObjTMAfterWSM(t, &validity);
+    }
+
+    for (int i = 0, e = get_source_node_count(t); i < e; ++i)
+    {
+        if (INode* source_node = get_source_node(t, i))
+        {
+            validity &= source_node->EvalWorldState(t).Validity(t);
+            source_node->GetObjTMAfterWSM(t, &validity);
+        }
+    }
+
+    if (Texmap* density_map = m_pblock->GetTexmap(ParamIdDensityMap, t))
+        validity &= density_map->Validity(t);
+
+    return validity;
+}
+
+void AppleseedScatterObj::InitNodeName(TSTR& s)
+{
+    s = L"appleseedScatter";
+}
+
+int AppleseedScatterObj::CanConvertToType(Class_ID obtype)
+{
+    return obtype == get_class_id() ? TRUE : FALSE;
+}
+
+void AppleseedScatterObj::GetDeformBBox(TimeValue t, Box3& box, Matrix3* tm, BOOL useSel)
+{
+    GetLocalBoundBox(t, nullptr, nullptr, box);
+
+    if (tm != nullptr)
+        box = box * *tm;
+}
+
+Mesh* AppleseedScatterObj::GetRenderMesh(TimeValue t, INode* inode, View& view, BOOL& needDelete)
+{
+    // Instances are only generated when rendering with appleseed.
+    needDelete = FALSE;
+    return &m_render_mesh;
+}
+
+int AppleseedScatterObj::get_source_node_count(const TimeValue t) const
+{
+    return m_pblock->Count(ParamIdSourceNodes);
+}
+
+INode* AppleseedScatterObj::get_source_node(const TimeValue t, const int index) const
+{
+    return m_pblock->GetINode(ParamIdSourceNodes, t, index);
+}
+
+std::vector<AppleseedScatterObj::Instance> AppleseedScatterObj::generate_instances(
+    const TimeValue     t,
+    const size_t        max_count)
+{
+    const size_t source_count = static_cast<size_t>(get_source_node_count(t));
+    const size_t count = std::min(static_cast<size_t>(m_pblock->GetInt(ParamIdCount, t)), max_count);
+    INode* surface_node = m_pblock->GetINode(ParamIdSurfaceNode, t);
+
+    if (source_count == 0 || count == 0 || surface_node == nullptr)
+        return {};
+
+    ScatterSurface surface;
+    if (!get_scatter_surface(surface_node, t, surface))
+        return {};
+
+    // Texmaps cannot be evaluated concurrently: bake the density map upfront.
+    Texmap* density_map = m_pblock->GetTexmap(ParamIdDensityMap, t);
+    const std::vector<float> density =
+        density_map != nullptr && !surface.m_tex_faces.empty()
+            ? bake_density_map(density_map, t)
+            : std::vector<float>();
+
+    const std::uint32_t seed = static_cast<std::uint32_t>(m_pblock->GetInt(ParamIdSeed, t));
+    const float scale_min = m_pblock->GetFloat(ParamIdScaleMin, t);
+    const float scale_max = m_pblock->GetFloat(ParamIdScaleMax, t);
+    const bool align_to_normal = m_pblock->GetInt(ParamIdAlignToNormal, t) != 0;
+    const bool random_rotation = m_pblock->GetInt(ParamIdRandomRotation, t) != 0;
+    const float total_area = surface.m_face_cdf.back();
+
+    // Instances rejected by the density map keep an invalid source index and are removed afterward.
+    std::vector<Instance> instances(count);
+
+    const auto generate_instance = [&](const size_t instance_index)
+    {
+        InstanceRandomGenerator rng(seed, instance_index);
+        Instance& instance = instances[instance_index];
+        instance.m_source_index = source_count;
+
+        for (int attempt = 0; attempt < MaxDensityAttempts; ++attempt)
+        {
+            // Pick a face proportionally to its area.
+            const float r = rng.next() * total_area;
+            const size_t face_index =
+                std::min(
+                    static_cast<size_t>(std::upper_bound(surface.m_face_cdf.begin(), surface.m_face_cdf.end(), r) - surface.m_face_cdf.begin()),
+                    surface.m_face_cdf.size() - 1);
+
+            // Pick a point uniformly on the face.
+            const float sqrt_r1 = std::sqrt(rng.next());
+            const float r2 = rng.next();
+            const float b0 = 1.0f - sqrt_r1;
+            const float b1 = sqrt_r1 * (1.0f - r2);
+            const float b2 = sqrt_r1 * r2;
+
+            const float density_sample = rng.next();
+            if (!density.empty())
+            {
+                const DWORD* tex_face = &surface.m_tex_faces[face_index * 3];
+                const Point3 uv =
+                    b0 * surface.m_tex_coords[tex_face[0]] +
+                    b1 * surface.m_tex_coords[tex_face[1]] +
+                    b2 * surface.m_tex_coords[tex_face[2]];
+                if (density_sample >= lookup_density(density, uv))
+                    continue;
+            }
+
+            const DWORD* face = &surface.m_faces[face_index * 3];
+            const Point3& v0 = surface.m_vertices[face[0]];
+            const Point3& v1 = surface.m_vertices[face[1]];
+            const Point3& v2 = surface.m_vertices[face[2]];
+            const Point3 position = b0 * v0 + b1 * v1 + b2 * v2;
+            const Point3 up = align_to_normal ? Normalize((v1 - v0) ^ (v2 - v0)) : Point3(0.0f, 0.0f, 1.0f);
+
+            instance.m_source_index = std::min(static_cast<size_t>(rng.next() * source_count), source_count - 1);
+
+            const float angle = random_rotation ? rng.next() * TWOPI : 0.0f;
+            const float scale = scale_min + rng.next() * (scale_max - scale_min);
+            instance.m_transform = make_instance_transform(position, up, angle, scale);
+
+            break;
+        }
+    };
+
+    const size_t batch_count = (count + InstanceBatchSize - 1) / InstanceBatchSize;
+    std::atomic<size_t> next_batch_index(0);
+    const auto generate_batches = [&]()
+    {
+        while (true)
+        {
+            const size_t batch_index = next_batch_index++;
+            if (batch_index >= batch_count)
+                break;
+
+            const size_t begin = batch_index * InstanceBatchSize;
+            const size_t end = std::min(begin + InstanceBatchSize, count);
+
+            for (size_t i = begin; i < end; ++i)
+                generate_instance(i);
+        }
+    };
+
+    const size_t thread_count =
+        std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1U), batch_count);
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < thread_count; ++i)
+        threads.emplace_back(generate_batches);
+
+    generate_batches();
+
+    for (auto& thread : threads)
+        thread.join();
+
+    instances.erase(
+        std::remove_if(
+            instances.begin(),
+            instances.end(),
+            [source_count](const Instance& instance) { return instance.m_source_index >= source_count; }),
+        instances.end());
+
+    return instances;
+}
+
+void AppleseedScatterObj::update_preview(const TimeValue t)
+{
+    if (m_preview_valid && m_preview_time == t)
+        return;
+
+    m_preview_valid = true;
+    m_preview_time = t;
+    m_preview_points.clear();
+    m_preview_bbox.Init();
+
+    // Instances only depend on their index, so the preview shows the first instances of the render.
+    for (const auto& instance : generate_instances(t, MaxDisplayedInstances))
+    {
+        const Point3 p = instance.m_transform.GetTrans();
+        m_preview_points.push_back(p);
+        m_preview_bbox += p;
+    }
+}
+
+void AppleseedScatterObj::draw(const TimeValue t, INode* inode, GraphicsWindow* gw)
+{
+    // Draw a cross at the position of the scatter node.
+    gw->setTransform(inode->GetObjectTM(t));
+
+    static const Point3 Axes[3] =
+    {
+        Point3(IconHalfSize, 0.0f, 0.0f),
+        Point3(0.0f, IconHalfSize, 0.0f),
+        Point3(0.0f, 0.0f, IconHalfSize)
+    };
+
+    gw->startSegments();
+    for (const auto& axis : Axes)
+    {
+        Point3 segment[2] = { -axis, axis };
+        gw->segment(segment, 1);
+    }
+    gw->endSegments();
+
+    // Draw the position of the instances, in world space.
+    update_preview(t);
+
+    if (!m_preview_points.empty())
+    {
+        gw->setTransform(Matrix3(TRUE));
+        gw->startMarkers();
+        for (auto& p : m_preview_points)
+            gw->marker(&p, POINT_MRKR);
+        gw->endMarkers();
+    }
+}
+
+
+//
+// AppleseedScatterObjClassDesc class implementation.
+//
+
+int AppleseedScatterObjClassDesc::IsPublic()
+{
+    return TRUE;
+}
+
+void* AppleseedScatterObjClassDesc::Create(BOOL loading)
+{
+    return new AppleseedScatterObj();
+}
+
+const MCHAR* AppleseedScatterObjClassDesc::ClassName()
+{
+    // Name that appears in the Create panel.
+    return L"appleseed Scatter";
+}
+
+SClass_ID AppleseedScatterObjClassDesc::SuperClassID()
+{
+    return GEOMOBJECT_CLASS_ID;
+}
+
+Class_ID AppleseedScatterObjClassDesc::ClassID()
+{
+    return AppleseedScatterObj::get_class_id();
+}
+
+const MCHAR* AppleseedScatterObjClassDesc::Category()
+{
+    return L"appleseed";
+}
+
+const MCHAR* AppleseedScatterObjClassDesc::InternalName()
+{
+    // Parsable name used by MAXScript.
+    return L"appleseedScatter";
+}
+
+HINSTANCE AppleseedScatterObjClassDesc::HInstance()
+{
+    return g_module;
+}
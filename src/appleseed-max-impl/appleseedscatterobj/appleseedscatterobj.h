@@ -0,0 +1,164 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2015-2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+// Build options header.
+#include "foundation/core/buildoptions.h"
+
+// 3ds Max headers.
+#include "appleseed-max-common/_beginmaxheaders.h"
+#include <box3.h>
+#include <iparamb2.h>
+#include <matrix3.h>
+#include <maxtypes.h>
+#include <mesh.h>
+#include <object.h>
+#include <point3.h>
+#include <ref.h>
+#include <strbasic.h>
+#include <strclass.h>
+#include "appleseed-max-common/_endmaxheaders.h"
+
+// Standard headers.
+#include <cstddef>
+#include <vector>
+
+// Forward declarations.
+class GraphicsWindow;
+
+//
+// An object scattering instances of a set of source nodes over the surface of another node.
+// Instances are not 3ds Max nodes: they are generated at render time and exported as
+// assembly instances of one shared assembly per source node.
+//
+
+class AppleseedScatterObj
+  : public GeomObject
+{
+  public:
+    struct Instance
+    {
+        size_t      m_source_index;     // index of the source node
+        Matrix3     m_transform;        // world space transform of the instance
+    };
+
+    static Class_ID get_class_id();
+
+    // Constructor.
+    AppleseedScatterObj();
+
+    // Animatable methods.
+    void DeleteThis() override;
+    void GetClassName(TSTR& s) override;
+    SClass_ID SuperClassID() override;
+    Class_ID ClassID() override;
+    void BeginEditParams(IObjParam* ip, ULONG flags, Animatable* prev = nullptr) override;
+    void EndEditParams(IObjParam* ip, ULONG flags, Animatable* next = nullptr) override;
+    int NumSubs() override;
+    Animatable* SubAnim(int i) override;
+    TSTR SubAnimName(int i) override;
+    int SubNumToRefNum(int subNum) override;
+    int NumParamBlocks() override;
+    IParamBlock2* GetParamBlock(int i) override;
+    IParamBlock2* GetParamBlockByID(BlockID id) override;
+
+    // ReferenceMaker methods.
+    int NumRefs() override;
+    RefTargetHandle GetReference(int i) override;
+    void SetReference(int i, RefTargetHandle rtarg) override;
+    RefResult NotifyRefChanged(
+        const Interval&     changeInt,
+        RefTargetHandle     hTarget,
+        PartID&             partID,
+        RefMessage          message,
+        BOOL                propagate) override;
+
+    // ReferenceTarget methods.
+    RefTargetHandle Clone(RemapDir& remap) override;
+
+    // BaseObject methods.
+    CreateMouseCallBack* GetCreateMouseCallBack() override;
+    const MCHAR* GetObjectName() override;
+    bool RequiresSupportForLegacyDisplayMode() const override;
+    int Display(TimeValue t, INode* inode, ViewExp* vpt, int flags) override;
+    int HitTest(TimeValue t, INode* inode, int type, int crossing, int flags, IPoint2* p, ViewExp* vpt) override;
+    void GetWorldBoundBox(TimeValue t, INode* inode, ViewExp* vpt, Box3& box) override;
+    void GetLocalBoundBox(TimeValue t, INode* inode, ViewExp* vpt, Box3& box) override;
+
+    // Object methods.
+    ObjectState Eval(TimeValue t) override;
+    Interval ObjectValidity(TimeValue t) override;
+    void InitNodeName(TSTR& s) override;
+    int CanConvertToType(Class_ID obtype) override;
+    void GetDeformBBox(TimeValue t, Box3& box, Matrix3* tm = nullptr, BOOL useSel = FALSE) override;
+
+    // GeomObject methods.
+    Mesh* GetRenderMesh(TimeValue t, INode* inode, View& view, BOOL& needDelete) override;
+
+    // Access the source nodes. Source nodes may be null if they were deleted.
+    int get_source_node_count(const TimeValue t) const;
+    INode* get_source_node(const TimeValue t, const int index) const;
+
+    // Generate at most `max_count` instances. Instances are generated in parallel and are
+    // fully determined by the parameters of the object, the surface node and the density map.
+    std::vector<Instance> generate_instances(const TimeValue t, const size_t max_count);
+
+  private:
+    IParamBlock2*           m_pblock;
+    Mesh                    m_render_mesh;          // empty mesh returned to other renderers
+    bool                    m_preview_valid;
+    TimeValue               m_preview_time;
+    std::vector<Point3>     m_preview_points;       // world space positions of the first instances
+    Box3                    m_preview_bbox;         // world space bounding box of the preview points
+
+    void update_preview(const TimeValue t);
+
+    void draw(const TimeValue t, INode* inode, GraphicsWindow* gw);
+};
+
+
+//
+// AppleseedScatterObj class descriptor.
+//
+
+class AppleseedScatterObjClassDesc
+  : public ClassDesc2
+{
+  public:
+    int IsPublic() override;
+    void* Create(BOOL loading) override;
+    const MCHAR* ClassName() override;
+    SClass_ID SuperClassID() override;
+    Class_ID ClassID() override;
+    const MCHAR* Category() override;
+    const MCHAR* InternalName() override;
+    HINSTANCE HInstance() override;
+};
+
+extern AppleseedScatterObjClassDesc g_appleseed_scatterobj_classdesc;
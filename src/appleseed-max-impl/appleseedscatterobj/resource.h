@@ -0,0 +1,58 @@
+//{{NO_DEPENDENCIES}}
+// Microsoft Visual C++ generated include file.
+// Used by appleseedscatterobj.rc
+//
+#define IDD_FORMVIEW_PARAMS                         16000
+#define IDS_FORMVIEW_PARAMS_TITLE                   16001
+
+#define IDC_STATIC_SOURCES                          16010
+#define IDC_LIST_SOURCES                            16011
+#define IDC_BUTTON_ADD_SOURCE                       16012
+#define IDC_BUTTON_REMOVE_SOURCE                    16013
+#define IDS_SOURCES                                 16014
+
+#define IDC_STATIC_SURFACE                          16020
+#define IDC_BUTTON_SURFACE                          16021
+#define IDS_SURFACE                                 16022
+#define IDS_PICK_SURFACE                            16023
+
+#define IDC_STATIC_COUNT                            16030
+#define IDC_EDIT_COUNT                              16031
+#define IDC_SPINNER_COUNT                           16032
+#define IDS_COUNT                                   16033
+
+#define IDC_STATIC_SEED                             16040
+#define IDC_EDIT_SEED                               16041
+#define IDC_SPINNER_SEED                            16042
+#define IDS_SEED                                    16043
+
+#define IDC_STATIC_DENSITY_MAP                      16050
+#define IDC_BUTTON_DENSITY_MAP                      16051
+#define IDS_DENSITY_MAP                             16052
+
+#define IDC_STATIC_SCALE_MIN                        16060
+#define IDC_EDIT_SCALE_MIN                          16061
+#define IDC_SPINNER_SCALE_MIN                       16062
+#define IDS_SCALE_MIN                               16063
+
+#define IDC_STATIC_SCALE_MAX                        16070
+#define IDC_EDIT_SCALE_MAX                          16071
+#define IDC_SPINNER_SCALE_MAX                       16072
+#define IDS_SCALE_MAX                               16073
+
+#define IDC_CHECK_ALIGN_TO_NORMAL                   16080
+#define IDS_ALIGN_TO_NORMAL                         16081
+
+#define IDC_CHECK_RANDOM_ROTATION                   16090
+#define IDS_RANDOM_ROTATION                         16091
+
+// Next default values for new objects
+// 
+#ifdef APSTUDIO_INVOKED
+#ifndef APSTUDIO_READONLY_SYMBOLS
+#define _APS_NEXT_RESOURCE_VALUE        104
+#define _APS_NEXT_COMMAND_VALUE         40001
+#define _APS_NEXT_CONTROL_VALUE         1006
+#define _APS_NEXT_SYMED_VALUE           101
+#endif
+#endif
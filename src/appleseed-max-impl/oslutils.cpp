@@ -33,6 +33,7 @@
 #include "appleseedoslplugin/oslshadermetadata.h"
 #include "appleseedoslplugin/osltexture.h"
 #include "builtinmapsupport.h"
+#include "textureconverter.h"
 #include "utilities.h"
 
 // appleseed-max-common headers.
@@ -238,7 +239,7 @@ std::string fmt_osl_expr(Texmap* texmap)
     if (is_bitmap_texture(texmap))
     {
         const auto texture_filepath = wide_to_utf8(static_cast<BitmapTex*>(texmap)->GetMap().GetFullFilePath());
-        return fmt_osl_expr(texture_filepath);
+        return fmt_osl_expr(get_converted_texture_filepath(texture_filepath));
     }
     else return fmt_osl_expr(std::string());
 }
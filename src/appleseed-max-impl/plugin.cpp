@@ -36,13 +36,19 @@
 #include "appleseedobjpropsmod/appleseedobjpropsmod.h"
 #include "appleseedoslplugin/oslshaderregistry.h"
 #include "appleseedplasticmtl/appleseedplasticmtl.h"
+#include "appleseedproxyobj/appleseedproxyobj.h"
 #include "appleseedrenderelement/appleseedrenderelement.h"
 #include "appleseedrenderer/appleseedrenderer.h"
+#include "appleseedrenderer/backgroundwriter.h"
+#include "appleseedrenderer/materialpreviewcache.h"
+#include "appleseedrenderer/projectbuilder.h"
+#include "appleseedscatterobj/appleseedscatterobj.h"
 #include "appleseedsssmtl/appleseedsssmtl.h"
 #include "appleseedvolumemtl/appleseedvolumemtl.h"
 #include "logtarget.h"
 #include "main.h"
 #include "osloutputselectormap/osloutputselector.h"
+#include "textureconverter.h"
 #include "utilities.h"
 #include "version.h"
 
@@ -91,7 +97,7 @@ extern "C"
     __declspec(dllexport)
     int LibNumberClasses()
     {
-        return 13 + g_shader_registry.get_size();
+        return 15 + g_shader_registry.get_size();
     }
 
     __declspec(dllexport)
@@ -112,11 +118,13 @@ extern "C"
           case 10: return &g_appleseed_outputselector_classdesc;
           case 11: return &g_appleseed_renderelement_classdesc;
           case 12: return &g_appleseed_volumemtl_classdesc;
+          case 13: return &g_appleseed_proxyobj_classdesc;
+          case 14: return &g_appleseed_scatterobj_classdesc;
 
           // Make sure to update LibNumberClasses() if you add classes here.
 
           default:
-            return g_shader_registry.get_class_descriptor(i - 13);
+            return g_shader_registry.get_class_descriptor(i - 15);
         }
     }
 
@@ -173,4 +181,22 @@ extern "C"
 
         return TRUE;
     }
+
+    __declspec(dllexport)
+    int LibShutdown()
+    {
+        // Let pending image and project writes complete before the plug-in is unloaded.
+        g_background_writer.stop();
+
+        // Don't let the texture conversion thread outlive the plug-in.
+        stop_texture_conversion();
+
+        // Preview scenes hold appleseed entities that must be destroyed before appleseed is unloaded.
+        g_material_preview_cache.clear();
+
+        // Don't hold references to 3ds Max maps past the lifetime of the reference system.
+        clear_environment_map_caches();
+
+        return TRUE;
+    }
 }
@@ -0,0 +1,346 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2015-2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+// Interface header.
+#include "textureconverter.h"
+
+// appleseed-max headers.
+#include "utilities.h"
+
+// Build options header.
+#include "foundation/core/buildoptions.h"
+
+// appleseed.renderer headers.
+#include "renderer/api/log.h"
+
+// appleseed.foundation headers.
+#include "foundation/platform/windows.h"
+#include "foundation/utility/siphash.h"
+#include "foundation/utility/string.h"
+
+// Boost headers.
+#include "boost/filesystem.hpp"
+#include "boost/thread/locks.hpp"
+#include "boost/thread/mutex.hpp"
+
+// Standard headers.
+#include <cstdint>
+#include <ctime>
+#include <deque>
+#include <map>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace asf = foundation;
+namespace bf = boost::filesystem;
+
+namespace
+{
+    boost::mutex                        g_mutex;
+    bf::path                            g_directory;
+
+    // Map a source texture file to the file that is actually rendered.
+    std::map<std::string, std::string>  g_converted_filepaths;
+
+    // Texture files waiting for conversion, in order of first use, and texture files
+    // that are either waiting for conversion or being converted.
+    std::deque<std::string>             g_conversion_queue;
+    std::set<std::string>               g_pending_filepaths;
+
+    // Thread converting the queued texture files, and the maketx process it is waiting for.
+    std::thread                         g_conversion_thread;
+    bool                                g_conversion_thread_running = false;
+    bool                                g_stopping = false;
+    HANDLE                              g_maketx_process = nullptr;
+
+    // Name of the converted file: the cache key covers the source path, size and
+    // modification time so that an edited texture gets converted again.
+    std::string make_converted_filename(const bf::path& source_path)
+    {
+        const std::uint64_t file_size = bf::file_size(source_path);
+        const std::time_t last_write_time = bf::last_write_time(source_path);
+
+        const std::string key =
+            asf::format(
+                "{0}|{1}|{2}",
+                asf::lower_case(wide_to_utf8(source_path.generic_wstring())),
+                file_size,
+                static_cast<std::int64_t>(last_write_time));
+
+        const std::uint64_t hash = asf::siphash24(key.c_str(), key.size());
+
+        return asf::format("{0}_{1}.exr", wide_to_utf8(source_path.stem().wstring()), hash);
+    }
+
+    // Convert a texture file using the maketx utility shipped with the plugin.
+    bool run_maketx(const bf::path& source_path, const bf::path& output_path)
+    {
+        const std::wstring maketx_path = utf8_to_wide(get_root_path()) + L"\\maketx.exe";
+
+        std::wstring command_line;
+        command_line += L"\"" + maketx_path + L"\"";
+        command_line += L" \"" + source_path.wstring() + L"\"";
+        command_line += L" -o \"" + output_path.wstring() + L"\"";
+        command_line += L" --oiio --format exr -d half --tile 64 64";
+
+        // CreateProcess() may modify the command line buffer.
+        std::vector<wchar_t> command_line_buffer(command_line.begin(), command_line.end());
+        command_line_buffer.push_back(L'\0');
+
+        STARTUPINFO startup_info = {};
+        startup_info.cb = sizeof(startup_info);
+
+        PROCESS_INFORMATION process_info = {};
+
+        if (!CreateProcess(
+                maketx_path.c_str(),
+                command_line_buffer.data(),
+                nullptr,                    // process security attributes
+                nullptr,                    // primary thread security attributes
+                FALSE,                      // don't inherit handles
+                CREATE_NO_WINDOW | BELOW_NORMAL_PRIORITY_CLASS,
+                nullptr,                    // use parent's environment
+                nullptr,                    // use parent's current directory
+                &startup_info,
+                &process_info))
+        {
+            RENDERER_LOG_WARNING("failed to launch %s.", wide_to_utf8(maketx_path).c_str());
+            return false;
+        }
+
+        // Let stop_texture_conversion() terminate the process.
+        {
+            boost::mutex::scoped_lock lock(g_mutex);
+
+            if (g_stopping)
+                TerminateProcess(process_info.hProcess, 1);
+            else g_maketx_process = process_info.hProcess;
+        }
+
+        WaitForSingleObject(process_info.hProcess, INFINITE);
+
+        {
+            boost::mutex::scoped_lock lock(g_mutex);
+            g_maketx_process = nullptr;
+        }
+
+        DWORD exit_code = 1;
+        GetExitCodeProcess(process_info.hProcess, &exit_code);
+
+        CloseHandle(process_info.hThread);
+        CloseHandle(process_info.hProcess);
+
+        return exit_code == 0;
+    }
+
+    std::string convert_texture(const std::string& filepath, const bf::path& directory)
+    {
+        const bf::path source_path(utf8_to_wide(filepath));
+        const bf::path converted_path = directory / utf8_to_wide(make_converted_filename(source_path));
+
+        // Convert to a temporary file first so that an interrupted conversion
+        // or another 3ds Max session never sees a partially written file.
+        bf::create_directories(directory);
+        bf::path temp_path = converted_path;
+        temp_path.replace_extension(L".tmp.exr");
+
+        RENDERER_LOG_INFO("converting texture %s...", filepath.c_str());
+
+        if (!run_maketx(source_path, temp_path))
+        {
+            RENDERER_LOG_WARNING("failed to convert texture %s, using it as is.", filepath.c_str());
+            bf::remove(temp_path);
+            return filepath;
+        }
+
+        bf::rename(temp_path, converted_path);
+
+        const std::string converted_filepath = wide_to_utf8(converted_path.wstring());
+        RENDERER_LOG_INFO("converted texture %s to %s.", filepath.c_str(), converted_filepath.c_str());
+
+        return converted_filepath;
+    }
+
+    // Convert queued texture files one at a time until the queue is empty.
+    void conversion_thread()
+    {
+        while (true)
+        {
+            std::string filepath;
+            bf::path directory;
+
+            {
+                boost::mutex::scoped_lock lock(g_mutex);
+
+                if (g_conversion_queue.empty() || g_stopping)
+                {
+                    g_conversion_thread_running = false;
+                    return;
+                }
+
+                filepath = g_conversion_queue.front();
+                g_conversion_queue.pop_front();
+                directory = g_directory;
+            }
+
+            // The lock is not held while maketx runs.
+            std::string converted_filepath;
+
+            try
+            {
+                converted_filepath = convert_texture(filepath, directory);
+            }
+            catch (const bf::filesystem_error& e)
+            {
+                RENDERER_LOG_WARNING(
+                    "failed to convert texture %s, using it as is, error = %s.",
+                    filepath.c_str(),
+                    e.what());
+                converted_filepath = filepath;
+            }
+
+            {
+                boost::mutex::scoped_lock lock(g_mutex);
+
+                g_pending_filepaths.erase(filepath);
+
+                // Failed conversions are remembered too so that they are not retried for every map.
+                // Results for a conversion directory that is no longer in use are dropped.
+                if (directory == g_directory)
+                    g_converted_filepaths.insert(std::make_pair(filepath, converted_filepath));
+            }
+        }
+    }
+}
+
+void set_texture_conversion_directory(const std::wstring& directory)
+{
+    boost::mutex::scoped_lock lock(g_mutex);
+
+    const bf::path new_directory(directory);
+    if (new_directory != g_directory)
+    {
+        g_directory = new_directory;
+        g_converted_filepaths.clear();
+        g_conversion_queue.clear();
+        g_pending_filepaths.clear();
+    }
+}
+
+std::string get_converted_texture_filepath(const std::string& filepath)
+{
+    bf::path directory;
+
+    {
+        boost::mutex::scoped_lock lock(g_mutex);
+
+        if (g_directory.empty() || filepath.empty())
+            return filepath;
+
+        const auto it = g_converted_filepaths.find(filepath);
+        if (it != g_converted_filepaths.end())
+            return it->second;
+
+        // Already queued: render the source file in the meantime.
+        if (g_pending_filepaths.count(filepath) > 0)
+            return filepath;
+
+        directory = g_directory;
+    }
+
+    // Reuse the file converted during a previous session.
+    try
+    {
+        const bf::path source_path(utf8_to_wide(filepath));
+        if (!bf::exists(source_path))
+            return filepath;
+
+        const bf::path converted_path = directory / utf8_to_wide(make_converted_filename(source_path));
+        if (bf::exists(converted_path))
+        {
+            const std::string converted_filepath = wide_to_utf8(converted_path.wstring());
+
+            boost::mutex::scoped_lock lock(g_mutex);
+            if (directory == g_directory)
+                g_converted_filepaths.insert(std::make_pair(filepath, converted_filepath));
+
+            return converted_filepath;
+        }
+    }
+    catch (const bf::filesystem_error& e)
+    {
+        RENDERER_LOG_WARNING(
+            "failed to look up converted texture for %s, using it as is, error = %s.",
+            filepath.c_str(),
+            e.what());
+        return filepath;
+    }
+
+    // Convert the file in the background and render the source file until the converted file
+    // is ready. Later renders pick up the converted file.
+    boost::mutex::scoped_lock lock(g_mutex);
+
+    if (directory != g_directory || !g_pending_filepaths.insert(filepath).second)
+        return filepath;
+
+    g_conversion_queue.push_back(filepath);
+
+    if (!g_conversion_thread_running && !g_stopping)
+    {
+        // The thread ends by itself once the queue is empty. A thread that ended that way
+        // no longer needs the lock, so it can be joined while holding it.
+        if (g_conversion_thread.joinable())
+            g_conversion_thread.join();
+
+        g_conversion_thread_running = true;
+        g_conversion_thread = std::thread(conversion_thread);
+    }
+
+    return filepath;
+}
+
+void stop_texture_conversion()
+{
+    {
+        boost::mutex::scoped_lock lock(g_mutex);
+
+        g_stopping = true;
+        g_conversion_queue.clear();
+        g_pending_filepaths.clear();
+
+        if (g_maketx_process != nullptr)
+            TerminateProcess(g_maketx_process, 1);
+    }
+
+    if (g_conversion_thread.joinable())
+        g_conversion_thread.join();
+
+    boost::mutex::scoped_lock lock(g_mutex);
+    g_stopping = false;
+}
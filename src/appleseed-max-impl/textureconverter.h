@@ -0,0 +1,50 @@
+
+//
+// This source file is part of appleseed.
+// Visit https://appleseedhq.net/ for additional information and resources.
+//
+// This software is released under the MIT license.
+//
+// Copyright (c) 2015-2018 Francois Beaune, The appleseedhq Organization
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+// Build options header.
+#include "foundation/core/buildoptions.h"
+
+// Standard headers.
+#include <string>
+
+// Set the directory in which bitmap textures are converted to tiled, mipmapped, half-float
+// OpenEXR files before rendering. An empty path disables texture conversion.
+void set_texture_conversion_directory(const std::wstring& directory);
+
+// Return the path to the file that should be rendered in place of a given texture file.
+// When texture conversion is enabled, the converted file from a previous session is reused
+// if the source file did not change since. Otherwise the texture file is queued for conversion
+// in a background thread and `filepath` is returned until the converted file is ready.
+// If texture conversion is disabled or if the conversion failed, `filepath` is returned.
+std::string get_converted_texture_filepath(const std::string& filepath);
+
+// Cancel pending conversions, terminate the conversion in progress if any and wait for the
+// conversion thread to end. Must be called before the plug-in is unloaded.
+void stop_texture_conversion();
@@ -31,6 +31,7 @@
 
 // appleseed-max headers.
 #include "osloutputselectormap/osloutputselector.h"
+#include "textureconverter.h"
 
 // Build options header.
 #include "foundation/core/buildoptions.h"
@@ -60,15 +61,24 @@
 #include <interval.h>
 #include <iparamb2.h>
 #include <iparamm2.h>
+#include <object.h>
 #include <ipoint2.h>
 #include <paramtype.h>
 #include <plugapi.h>
 #include <point3.h>
+#include <ref.h>
+#include <render.h>
 #include <stdmat.h>
 #include "appleseed-max-common/_endmaxheaders.h"
 
 // Standard headers.
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
 
 namespace asf = foundation;
 namespace asr = renderer;
@@ -286,29 +296,187 @@ asf::auto_release_ptr<asf::Image> render_bitmap_to_image(
 
     const asf::CanvasProperties& props = image->properties();
 
-    for (size_t ty = 0; ty < props.m_tile_count_y; ++ty)
+    // Pixels are read straight into the tiles, one tile row at a time.
+    static_assert(
+        sizeof(BMM_Color_fl) == 4 * sizeof(float),
+        "BMM_Color_fl is expected to be made of four single precision floating point values");
+
+    // Reading from the bitmap doesn't modify it, so tiles are converted in parallel.
+    std::atomic<size_t> next_tile_index(0);
+    const auto convert_tiles = [&]()
     {
-        for (size_t tx = 0; tx < props.m_tile_count_x; ++tx)
+        while (true)
         {
+            const size_t tile_index = next_tile_index++;
+            if (tile_index >= props.m_tile_count)
+                break;
+
+            const size_t tx = tile_index % props.m_tile_count_x;
+            const size_t ty = tile_index / props.m_tile_count_x;
             asf::Tile& tile = image->tile(tx, ty);
 
+            const int ix = static_cast<int>(tx * props.m_tile_width);
+            const int row_width = static_cast<int>(tile.get_width());
+
             for (size_t y = 0, ye = tile.get_height(); y < ye; ++y)
             {
-                for (size_t x = 0, xe = tile.get_width(); x < xe; ++x)
-                {
-                    const int ix = static_cast<int>(tx * props.m_tile_width + x);
-                    const int iy = static_cast<int>(ty * props.m_tile_height + y);
+                const int iy = static_cast<int>(ty * props.m_tile_height + y);
+                bitmap->GetLinearPixels(ix, iy, row_width, reinterpret_cast<BMM_Color_fl*>(tile.pixel(0, y)));
+            }
+        }
+    };
+
+    const size_t thread_count =
+        std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1U), props.m_tile_count);
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < thread_count; ++i)
+        threads.emplace_back(convert_tiles);
+
+    convert_tiles();
+
+    for (auto& thread : threads)
+        thread.join();
+
+    return image;
+}
+
+void get_view_params_from_view_node(
+    ViewParams&             view_params,
+    INode*                  view_node,
+    const TimeValue         time)
+{
+    const ObjectState& os = view_node->EvalWorldState(time);
+    switch (os.obj->SuperClassID())
+    {
+      case CAMERA_CLASS_ID:
+        {
+            CameraObject* cam = static_cast<CameraObject*>(os.obj);
+
+            Interval validity_interval;
+            validity_interval.SetInfinite();
+
+            Matrix3 cam_to_world = view_node->GetObjTMAfterWSM(time, &validity_interval);
+            cam_to_world.NoScale();
+
+            view_params.affineTM = Inverse(cam_to_world);
+
+            CameraState cam_state;
+            cam->EvalCameraState(time, validity_interval, &cam_state);
 
-                    BMM_Color_fl c;
-                    bitmap->GetLinearPixels(ix, iy, 1, &c);
+            view_params.projType = PROJ_PERSPECTIVE;
+            view_params.fov = cam_state.fov;
 
-                    tile.set_pixel(x, y, &c.r, 4);
-                }
+            if (cam_state.manualClip)
+            {
+                view_params.hither = cam_state.hither;
+                view_params.yon = cam_state.yon;
             }
+            else
+            {
+                view_params.hither = 0.001f;
+                view_params.yon = 1.0e38f;
+            }
+        }
+        break;
+
+      case LIGHT_CLASS_ID:
+        {
+            DbgAssert(!"Not implemented yet.");
         }
+        break;
+
+      default:
+        DbgAssert(!"Unexpected super class ID for camera.");
     }
+}
 
-    return image;
+namespace
+{
+    class RenderBeginProc
+      : public RefEnumProc
+    {
+      public:
+        explicit RenderBeginProc(const TimeValue time)
+          : m_time(time)
+        {
+        }
+
+        int proc(ReferenceMaker* rm) override
+        {
+            rm->RenderBegin(m_time);
+            return REF_ENUM_CONTINUE;
+        }
+
+      private:
+        const TimeValue m_time;
+    };
+
+    class RenderEndProc
+      : public RefEnumProc
+    {
+      public:
+        explicit RenderEndProc(const TimeValue time)
+          : m_time(time)
+        {
+        }
+
+        int proc(ReferenceMaker* rm) override
+        {
+            rm->RenderEnd(m_time);
+            return REF_ENUM_CONTINUE;
+        }
+
+      private:
+        const TimeValue m_time;
+    };
+}
+
+void render_begin(
+    std::vector<INode*>&    nodes,
+    const TimeValue         time)
+{
+    RenderBeginProc proc(time);
+    proc.BeginEnumeration();
+
+    for (auto node : nodes)
+        node->EnumRefHierarchy(proc);
+
+    proc.EndEnumeration();
+}
+
+void render_end(
+    std::vector<INode*>&    nodes,
+    const TimeValue         time)
+{
+    RenderEndProc proc(time);
+    proc.BeginEnumeration();
+
+    for (auto node : nodes)
+        node->EnumRefHierarchy(proc);
+
+    proc.EndEnumeration();
+}
+
+namespace
+{
+    thread_local const std::set<std::string>* g_reserved_names = nullptr;
+}
+
+ScopedNameReservation::ScopedNameReservation(const std::set<std::string>& names)
+  : m_previous_names(g_reserved_names)
+{
+    g_reserved_names = &names;
+}
+
+ScopedNameReservation::~ScopedNameReservation()
+{
+    g_reserved_names = m_previous_names;
+}
+
+bool is_reserved_name(const std::string& name)
+{
+    return g_reserved_names != nullptr && g_reserved_names->count(name) > 0;
 }
 
 void insert_color(asr::BaseGroup& base_group, const Color& color, const char* name)
@@ -360,8 +528,9 @@ std::string insert_bitmap_texture_and_instance(
 {
     // todo: it can happen that `filepath` is empty here; report an error.
     const std::string filepath = wide_to_utf8(bitmap_tex->GetMap().GetFullFilePath());
-    texture_params.insert("filename", filepath);
+    texture_params.insert("filename", get_converted_texture_filepath(filepath));
 
+    // The color space is determined from the source file, not from the converted one.
     if (!texture_params.strings().exist("color_space"))
     {
         if (is_linear_texture(bitmap_tex))
@@ -369,7 +538,17 @@ std::string insert_bitmap_texture_and_instance(
         else texture_params.insert("color_space", "srgb");
     }
 
-    const std::string texture_name = wide_to_utf8(bitmap_tex->GetName());
+    // Textures are keyed by file path and color space rather than by map name, such that
+    // a file referenced by many maps is loaded only once and unrelated files referenced by
+    // maps that happen to share the same name don't collide.
+    const std::string texture_key =
+        asf::lower_case(filepath) + "|" + texture_params.get<std::string>("color_space");
+    const std::string texture_name =
+        asf::format(
+            "{0}_{1}",
+            filepath.substr(filepath.find_last_of("\\/") + 1),
+            asf::siphash24(texture_key.c_str(), texture_key.size()));
+
     if (base_group.textures().get_by_name(texture_name.c_str()) == nullptr)
     {
         base_group.textures().insert(
@@ -379,7 +558,12 @@ std::string insert_bitmap_texture_and_instance(
                 asf::SearchPaths()));
     }
 
-    const std::string texture_instance_name = texture_name + "_inst";
+    // Texture instances with specific parameters can't be shared.
+    const std::string texture_instance_name =
+        texture_instance_params.empty()
+            ? texture_name + "_inst"
+            : make_unique_prefixed_name(base_group.texture_instances(), texture_name + "_inst_");
+
     if (base_group.texture_instances().get_by_name(texture_instance_name.c_str()) == nullptr)
     {
         base_group.texture_instances().insert(
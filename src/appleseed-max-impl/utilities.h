@@ -57,7 +57,9 @@
 
 // Standard headers.
 #include <cstddef>
+#include <set>
 #include <string>
+#include <vector>
 
 // Forward declarations.
 namespace renderer  { class BaseGroup; }
@@ -66,6 +68,7 @@ class BitmapTex;
 class Color;
 class IParamMap2;
 class Texmap;
+class ViewParams;
 
 
 //
@@ -86,6 +89,7 @@ bool is_supported_procedural_texture(Texmap* map, const bool use_max_procedural_
 bool is_linear_texture(BitmapTex* bitmap_tex);
 
 // Render a Max bitmap to a tiled 32-bit floating point RGBA appleseed image.
+// Tiles are converted in parallel, one row of pixels at a time.
 foundation::auto_release_ptr<foundation::Image> render_bitmap_to_image(
     Bitmap*                     bitmap,
     const size_t                image_width,
@@ -94,15 +98,56 @@ foundation::auto_release_ptr<foundation::Image> render_bitmap_to_image(
     const size_t                tile_height);
 
 
+//
+// Scene evaluation functions.
+//
+
+// Compute the view parameters of a camera node at a given time.
+void get_view_params_from_view_node(
+    ViewParams&                 view_params,
+    INode*                      view_node,
+    const TimeValue             time);
+
+// Call RenderBegin() or RenderEnd() on a set of nodes and on everything they reference.
+void render_begin(
+    std::vector<INode*>&        nodes,
+    const TimeValue             time);
+void render_end(
+    std::vector<INode*>&        nodes,
+    const TimeValue             time);
+
+
 //
 // Project construction functions.
 //
 
+// Reserve entity names on the calling thread for the lifetime of this object: names made
+// unique by make_unique_name() avoid them. Used to build entities on the side that are
+// later moved into a base group holding these names.
+class ScopedNameReservation
+{
+  public:
+    explicit ScopedNameReservation(const std::set<std::string>& names);
+    ~ScopedNameReservation();
+
+  private:
+    const std::set<std::string>* m_previous_names;
+};
+
+// Return true if a name is reserved on the calling thread.
+bool is_reserved_name(const std::string& name);
+
 template <typename EntityContainer>
 std::string make_unique_name(
     const EntityContainer&      entities,
     const std::string&          name);
 
+// Return a name made of a prefix and a number that is neither taken nor reserved.
+template <typename EntityContainer>
+std::string make_unique_prefixed_name(
+    const EntityContainer&      entities,
+    const std::string&          prefix);
+
 void insert_color(
     renderer::BaseGroup&        base_group,
     const Color&                color,
@@ -153,9 +198,26 @@ std::string make_unique_name(
     const std::string&          name)
 {
     return
-        entities.get_by_name(name.c_str()) == nullptr
+        entities.get_by_name(name.c_str()) == nullptr && !is_reserved_name(name)
             ? name
-            : asr::make_unique_name(name + "_", entities);
+            : make_unique_prefixed_name(entities, name + "_");
+}
+
+template <typename EntityContainer>
+std::string make_unique_prefixed_name(
+    const EntityContainer&      entities,
+    const std::string&          prefix)
+{
+    const std::string name = asr::make_unique_name(prefix, entities);
+    if (!is_reserved_name(name))
+        return name;
+
+    for (size_t i = 1; ; ++i)
+    {
+        const std::string candidate = prefix + foundation::to_string(i);
+        if (entities.get_by_name(candidate.c_str()) == nullptr && !is_reserved_name(candidate))
+            return candidate;
+    }
 }
 
 template <typename T>